@@ -0,0 +1,468 @@
+"""
+SCR control-flow graph (decode once, cache, reuse)
+
+scr_decode.walk re-decodes every reachable instruction from raw bytes each
+time an analysis runs. This module runs it once per script and keeps the
+result as flat typed arrays (a Program), together with the basic blocks and
+procedures built on top of it, in a content-addressed cache. scr_xref, the
+`disasm` and `find` commands below and anything else that needs decoded
+SCR reads the arrays instead.
+
+Program (one row per reachable instruction, sorted by offset):
+- insns   off, len, op (0x100+N for FF N), flags (FALLS, CALL), the CSR
+          start of its sites and of its targets
+- sites   every dispatched opcode inside the instruction, nested ones
+          included (scr_decode.Site): off, end (operand span), op, CSR
+          start of its args; args are i64 with NO_ARG for runtime values
+- blocks  maximal straight-line runs of instructions; one CSR over insns
+- edges   per block: (kind, destination block)
+            FALL   next instruction          COND  0x01 else-target
+            JUMP   0x03/0x08/0x0A/0x33       CASE  0x02 case / default
+            CALL   0x32 block (returns)      SPAWN 0x9D/0xA1/0xA8 target
+          CALL and SPAWN are recorded on the block holding the
+          instruction and don't end it.
+- procs   MAIN (header +8), SUBPROC (`0B 04 <id16> 00 00` prologue,
+          with the ID16), SLOT (spawn targets) and BLOCK (0x32 targets),
+          each with its nesting depth (0x32 calls from a root) and the
+          blocks reachable from its entry without leaving it
+- subproc every raw `0B 04 <id16>` motif (scr_decode.subproc_prologues)
+- errors  offsets where decoding stopped, with the message
+
+Cache: `<dir>/<blake2b(script)>-<code>.scfg`, where `code` hashes this
+module, scr_decode.py and scr_vm.py, so an operand-signature fix
+invalidates every entry. A file is "SCFG" u32 version, the arrays back to
+back (u8 typecode, 3 pad, u32 count, little-endian items padded to 4
+bytes), then u32 length + the error messages as JSON.
+"""
+from __future__ import annotations
+
+import argparse
+import bisect
+import hashlib
+import json
+import os
+import struct
+import sys
+import time
+from array import array
+from collections import deque
+from typing import Dict, Iterator, List, Optional, Tuple
+
+from scr_decode import SLOT_TARGET_OPS, find_entries, subproc_prologues, walk
+from scr_vm import op_name
+
+MAGIC = b"SCFG"
+VERSION = 1
+NO_ARG = -(1 << 63)
+NO_BLOCK = 0xFFFFFFFF
+
+# insn flags
+FALLS, CALL = 1, 2
+
+EDGE_KINDS = ("fall", "jump", "cond", "case", "call", "spawn")
+FALL, JUMP, COND, CASE, CALL_EDGE, SPAWN = range(6)
+
+PROC_KINDS = ("main", "subproc", "slot", "block")
+P_MAIN, P_SUBPROC, P_SLOT, P_BLOCK = range(4)
+
+_JUMP_OPS = (0x03, 0x08, 0x0A, 0x33)
+
+# name -> typecode, in file order
+_ARRAYS = (
+    ("ins_off", "I"), ("ins_len", "I"), ("ins_op", "H"), ("ins_flags", "B"),
+    ("ins_site0", "I"), ("ins_tgt0", "I"), ("tgt", "I"),
+    ("site_off", "I"), ("site_end", "I"), ("site_op", "H"), ("site_arg0", "I"), ("arg", "q"),
+    ("blk_ins0", "I"), ("edge0", "I"), ("edge_kind", "B"), ("edge_dst", "I"),
+    ("proc_entry", "I"), ("proc_kind", "B"), ("proc_id", "i"), ("proc_depth", "H"),
+    ("proc_blk0", "I"), ("proc_blk", "I"),
+    ("sp_off", "I"), ("sp_id", "H"),
+    ("err_off", "I"),
+)
+
+
+class Program:
+    """Decoded SCR script as typed arrays (see module docstring)."""
+
+    def __init__(self) -> None:
+        for name, tc in _ARRAYS:
+            setattr(self, name, array(tc))
+        self.errors: List[str] = []
+
+    # -- instructions ------------------------------------------------------
+
+    def __len__(self) -> int:
+        return len(self.ins_off)
+
+    def insn_at(self, off: int) -> Optional[int]:
+        """Index of the instruction starting at `off`, or None."""
+        i = bisect.bisect_left(self.ins_off, off)
+        return i if i < len(self.ins_off) and self.ins_off[i] == off else None
+
+    def targets(self, i: int) -> array:
+        return self.tgt[self.ins_tgt0[i]:self.ins_tgt0[i + 1]]
+
+    def sites(self, i: int) -> Iterator[Tuple[int, int, int, List[Optional[int]]]]:
+        """(off, end, op, args) of every opcode inside instruction `i`."""
+        for s in range(self.ins_site0[i], self.ins_site0[i + 1]):
+            yield self.site(s)
+
+    def site(self, s: int) -> Tuple[int, int, int, List[Optional[int]]]:
+        args = [None if a == NO_ARG else a
+                for a in self.arg[self.site_arg0[s]:self.site_arg0[s + 1]]]
+        return self.site_off[s], self.site_end[s], self.site_op[s], args
+
+    def all_sites(self) -> Iterator[Tuple[int, int, int, List[Optional[int]]]]:
+        for s in range(len(self.site_off)):
+            yield self.site(s)
+
+    # -- blocks / procs ----------------------------------------------------
+
+    @property
+    def block_count(self) -> int:
+        return len(self.blk_ins0) - 1
+
+    def block_of(self, i: int) -> int:
+        """Block holding instruction index `i`."""
+        return bisect.bisect_right(self.blk_ins0, i) - 1
+
+    def block_insns(self, b: int) -> range:
+        return range(self.blk_ins0[b], self.blk_ins0[b + 1])
+
+    def edges(self, b: int) -> List[Tuple[int, int]]:
+        """(kind, destination block or NO_BLOCK) for block `b`."""
+        lo, hi = self.edge0[b], self.edge0[b + 1]
+        return list(zip(self.edge_kind[lo:hi], self.edge_dst[lo:hi]))
+
+    def proc_blocks(self, p: int) -> array:
+        return self.proc_blk[self.proc_blk0[p]:self.proc_blk0[p + 1]]
+
+    def proc_name(self, p: int) -> str:
+        kind = PROC_KINDS[self.proc_kind[p]]
+        if self.proc_kind[p] == P_SUBPROC:
+            return f"subproc_{self.proc_id[p]:04X}"
+        return f"{kind}_{self.proc_entry[p]:X}"
+
+    # -- persistence -------------------------------------------------------
+
+    def to_bytes(self) -> bytes:
+        out = [MAGIC, struct.pack("<I", VERSION)]
+        for name, tc in _ARRAYS:
+            a = getattr(self, name)
+            if sys.byteorder != "little":
+                a = array(tc, a)
+                a.byteswap()
+            raw = a.tobytes()
+            out.append(struct.pack("<c3xI", tc.encode(), len(a)) + raw + bytes(-len(raw) % 4))
+        msgs = json.dumps(self.errors).encode()
+        out.append(struct.pack("<I", len(msgs)) + msgs)
+        return b"".join(out)
+
+    @classmethod
+    def from_bytes(cls, data: bytes) -> "Program":
+        if data[:4] != MAGIC or struct.unpack_from("<I", data, 4)[0] != VERSION:
+            raise ValueError("not an SCR CFG cache file")
+        prog = cls()
+        p = 8
+        for name, tc in _ARRAYS:
+            code, count = struct.unpack_from("<c3xI", data, p)
+            if code.decode() != tc:
+                raise ValueError(f"array {name}: typecode {code!r}, expected {tc!r}")
+            p += 8
+            a = getattr(prog, name)
+            a.frombytes(data[p:p + count * a.itemsize])
+            if sys.byteorder != "little":
+                a.byteswap()
+            p += count * a.itemsize
+            p += -(count * a.itemsize) % 4
+        (n,) = struct.unpack_from("<I", data, p)
+        prog.errors = json.loads(data[p + 4:p + 4 + n])
+        return prog
+
+
+# ---------------------------------------------------------------------------
+# Build
+# ---------------------------------------------------------------------------
+
+def _roots(buf) -> List[Tuple[int, int, int]]:
+    """(entry, kind, id) for scr_decode.find_entries."""
+    return [(e, P_MAIN if i < 0 else P_SUBPROC, i) for e, i in find_entries(buf)]
+
+
+def _insn_edges(ins) -> List[Tuple[int, int]]:
+    """(kind, target offset) for the control transfers of one Insn."""
+    op = ins.op
+    if op == 0x01:
+        return [(COND, t) for t in ins.targets]
+    if op == 0x02:
+        return [(CASE, t) for t in ins.targets]
+    if op in _JUMP_OPS:
+        return [(JUMP, t) for t in ins.targets]
+    if ins.call:
+        return [(CALL_EDGE, t) for t in ins.targets]
+    if op in SLOT_TARGET_OPS:
+        return [(SPAWN, t) for t in ins.targets]
+    return []
+
+
+def analyze(buf: bytes | bytearray | memoryview) -> Program:
+    """Decode every reachable instruction of one script and build its CFG."""
+    roots = _roots(buf)
+    res = walk(buf, [e for e, _k, _i in roots])
+    insns = sorted(res.insns.values(), key=lambda ins: ins.off)
+    prog = Program()
+
+    # Instructions and their sites.
+    for ins in insns:
+        prog.ins_off.append(ins.off)
+        prog.ins_len.append(ins.end - ins.off)
+        prog.ins_op.append(ins.op)
+        prog.ins_flags.append((FALLS if ins.falls else 0) | (CALL if ins.call else 0))
+        prog.ins_site0.append(len(prog.site_off))
+        prog.ins_tgt0.append(len(prog.tgt))
+        prog.tgt.extend(t & 0xFFFFFFFF for t in ins.targets)
+        for site in ins.sites:
+            prog.site_off.append(site.off)
+            prog.site_end.append(site.end)
+            prog.site_op.append(site.op)
+            prog.site_arg0.append(len(prog.arg))
+            prog.arg.extend(NO_ARG if a is None else a for a in site.args)
+    prog.ins_site0.append(len(prog.site_off))
+    prog.ins_tgt0.append(len(prog.tgt))
+    prog.site_arg0.append(len(prog.arg))
+
+    # Basic blocks: split at every entry and transfer target, after every
+    # branch, and wherever the instruction stream isn't contiguous.
+    edges_of = [_insn_edges(ins) for ins in insns]
+    leaders = {e for e, _k, _i in roots}
+    for ins, es in zip(insns, edges_of):
+        leaders.update(t for _k, t in es)
+        if any(k in (COND, CASE, JUMP) for k, _t in es) or not ins.falls:
+            leaders.add(ins.end)
+    for i, ins in enumerate(insns):
+        if i == 0 or ins.off in leaders or insns[i - 1].end != ins.off:
+            prog.blk_ins0.append(i)
+    prog.blk_ins0.append(len(insns))
+
+    def block_at(off: int) -> int:
+        i = prog.insn_at(off)
+        return NO_BLOCK if i is None else prog.block_of(i)
+
+    for b in range(prog.block_count):
+        prog.edge0.append(len(prog.edge_kind))
+        lo, hi = prog.blk_ins0[b], prog.blk_ins0[b + 1]
+        for i in range(lo, hi):
+            for kind, t in edges_of[i]:
+                prog.edge_kind.append(kind)
+                prog.edge_dst.append(block_at(t))
+        last = insns[hi - 1]
+        if last.falls:
+            nxt = block_at(last.end)
+            if nxt != NO_BLOCK:
+                prog.edge_kind.append(FALL)
+                prog.edge_dst.append(nxt)
+    prog.edge0.append(len(prog.edge_kind))
+
+    # Procedures: roots, then spawn and call targets.
+    procs: Dict[int, Tuple[int, int]] = {}
+    for entry, kind, ident in roots:
+        procs.setdefault(entry, (kind, ident))
+    # Targets outside the script (bad literals) start no procedure.
+    for k, t in ((k, t) for es in edges_of for k, t in es):
+        if k == SPAWN and 0 <= t < len(buf):
+            procs.setdefault(t, (P_SLOT, -1))
+    for k, t in ((k, t) for es in edges_of for k, t in es):
+        if k == CALL_EDGE and 0 <= t < len(buf):
+            procs.setdefault(t, (P_BLOCK, -1))
+    entries = sorted(procs)
+    index = {e: n for n, e in enumerate(entries)}
+    depth = [0 if procs[e][0] != P_BLOCK else 0xFFFF for e in entries]
+    members: List[List[int]] = []
+    calls: List[List[int]] = []
+    for e in entries:
+        start = block_at(e)
+        seen = set()
+        callees = set()
+        todo = [start] if start != NO_BLOCK else []
+        while todo:
+            b = todo.pop()
+            if b in seen:
+                continue
+            seen.add(b)
+            for kind, dst in prog.edges(b):
+                if dst == NO_BLOCK:
+                    continue
+                if kind == CALL_EDGE:
+                    callees.add(index[prog.ins_off[prog.blk_ins0[dst]]])
+                elif kind != SPAWN:
+                    todo.append(dst)
+        members.append(sorted(seen))
+        calls.append(sorted(callees))
+    # Nesting depth: 0x32 calls away from the nearest root.
+    q = deque(n for n, d in enumerate(depth) if d == 0)
+    while q:
+        n = q.popleft()
+        for c in calls[n]:
+            if depth[c] > depth[n] + 1:
+                depth[c] = depth[n] + 1
+                q.append(c)
+    for n, e in enumerate(entries):
+        kind, ident = procs[e]
+        prog.proc_entry.append(e)
+        prog.proc_kind.append(kind)
+        prog.proc_id.append(ident)
+        prog.proc_depth.append(depth[n])
+        prog.proc_blk0.append(len(prog.proc_blk))
+        prog.proc_blk.extend(members[n])
+    prog.proc_blk0.append(len(prog.proc_blk))
+
+    for off, id16 in subproc_prologues(buf):
+        prog.sp_off.append(off)
+        prog.sp_id.append(id16)
+    for off in sorted(res.errors):
+        prog.err_off.append(off)
+        prog.errors.append(res.errors[off])
+    return prog
+
+
+# ---------------------------------------------------------------------------
+# Cache
+# ---------------------------------------------------------------------------
+
+_HERE = os.path.dirname(os.path.abspath(__file__))
+_code_digest: Optional[str] = None
+
+
+def code_digest() -> str:
+    """Hash of the decoder sources; part of every cache key."""
+    global _code_digest
+    if _code_digest is None:
+        h = hashlib.blake2b(digest_size=8)
+        for name in ("scr_cfg.py", "scr_decode.py", "scr_vm.py"):
+            with open(os.path.join(_HERE, name), "rb") as f:
+                h.update(f.read())
+        _code_digest = h.hexdigest()
+    return _code_digest
+
+
+def load_program(path: str, cache_dir: Optional[str] = None) -> Program:
+    """Program for the script at `path`, from `cache_dir` when present
+    (and stored there after a fresh decode)."""
+    with open(path, "rb") as f:
+        buf = f.read()
+    if cache_dir is None:
+        return analyze(buf)
+    key = f"{hashlib.blake2b(buf, digest_size=16).hexdigest()}-{code_digest()}"
+    cpath = os.path.join(cache_dir, key + ".scfg")
+    try:
+        with open(cpath, "rb") as f:
+            return Program.from_bytes(f.read())
+    except (OSError, ValueError, struct.error):
+        pass
+    prog = analyze(buf)
+    os.makedirs(cache_dir, exist_ok=True)
+    tmp = f"{cpath}.{os.getpid()}.tmp"
+    with open(tmp, "wb") as f:
+        f.write(prog.to_bytes())
+    os.replace(tmp, cpath)
+    return prog
+
+
+# ---------------------------------------------------------------------------
+# CLI
+# ---------------------------------------------------------------------------
+
+def _fmt_args(args: List[Optional[int]]) -> str:
+    return ", ".join("?" if a is None else f"0x{a:X}" for a in args)
+
+
+def disasm(prog: Program, procs: Optional[List[int]] = None) -> Iterator[str]:
+    """Listing of the given procedures (all by default), block by block."""
+    for p in (range(len(prog.proc_entry)) if procs is None else procs):
+        yield (f"{prog.proc_name(p)}:  ; entry 0x{prog.proc_entry[p]:X}, "
+               f"depth {prog.proc_depth[p]}, {len(prog.proc_blocks(p))} blocks")
+        for b in prog.proc_blocks(p):
+            yield f"  block {b}:"
+            for i in prog.block_insns(b):
+                off, op = prog.ins_off[i], prog.ins_op[i]
+                sites = list(prog.sites(i))
+                line = f"    {off:08x}  {op_name(op):>5}  len={prog.ins_len[i]}"
+                if sites and sites[0][0] == off:
+                    line += f"  ({_fmt_args(sites.pop(0)[3])})"
+                tg = prog.targets(i)
+                if tg:
+                    line += "  -> " + ", ".join(f"0x{t:X}" for t in tg)
+                yield line
+                for s_off, s_end, s_op, args in sites:
+                    yield f"      {s_off:08x}  {op_name(s_op):>5}  [{s_off:X}..{s_end:X})  ({_fmt_args(args)})"
+            edges = ", ".join(f"{EDGE_KINDS[k]} {'?' if d == NO_BLOCK else d}"
+                              for k, d in prog.edges(b))
+            if edges:
+                yield f"    ; {edges}"
+
+
+def _inputs(items: List[str]) -> List[str]:
+    out: List[str] = []
+    for p in items:
+        if os.path.isdir(p):
+            out.extend(os.path.join(p, n) for n in sorted(os.listdir(p), key=lambda n: (len(n), n))
+                       if n.endswith(".out"))
+        else:
+            out.append(p)
+    return out
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    ap = argparse.ArgumentParser(description="Build, cache and query SCR control-flow graphs")
+    ap.add_argument("--cache", default="scr_cfg_cache", help="Cache directory ('' disables)")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    b = sub.add_parser("build", help="Decode scrN.out files (or directories) into the cache")
+    b.add_argument("inputs", nargs="+")
+    d = sub.add_parser("disasm", help="Print procedures, blocks and edges of one script")
+    d.add_argument("file")
+    d.add_argument("--entry", type=lambda s: int(s, 0), action="append",
+                   help="Only the procedure at this entry offset (repeatable)")
+    d.add_argument("--subproc", type=lambda s: int(s, 0), action="append",
+                   help="Only this SUBPROC ID16 (repeatable)")
+    f = sub.add_parser("find", help="List every site of an opcode")
+    f.add_argument("inputs", nargs="+")
+    f.add_argument("--op", type=lambda s: int(s, 0), required=True, help="Opcode (0x100+N for FF N)")
+    args = ap.parse_args(argv)
+    cache = args.cache or None
+
+    if args.cmd == "disasm":
+        prog = load_program(args.file, cache)
+        procs = None
+        if args.entry or args.subproc:
+            procs = [p for p in range(len(prog.proc_entry))
+                     if prog.proc_entry[p] in (args.entry or ())
+                     or (prog.proc_kind[p] == P_SUBPROC and prog.proc_id[p] in (args.subproc or ()))]
+        for line in disasm(prog, procs):
+            print(line)
+        for off, msg in zip(prog.err_off, prog.errors):
+            print(f"; decode stopped at 0x{off:X}: {msg}")
+        return 0
+
+    paths = _inputs(args.inputs)
+    t0 = time.perf_counter()
+    totals = [0, 0, 0, 0]
+    for p in paths:
+        prog = load_program(p, cache)
+        if args.cmd == "find":
+            name = os.path.basename(p)
+            for s_off, s_end, s_op, a in prog.all_sites():
+                if s_op == args.op:
+                    print(f"{name}:{s_off:08x}  {op_name(s_op):>5}  {_fmt_args(a)}")
+            continue
+        totals[0] += len(prog)
+        totals[1] += prog.block_count
+        totals[2] += len(prog.proc_entry)
+        totals[3] += len(prog.err_off)
+    dt = time.perf_counter() - t0
+    if args.cmd == "build":
+        print(f"{len(paths)} scripts: {totals[0]} insns, {totals[1]} blocks, {totals[2]} procs, "
+              f"{totals[3]} decode stops, {dt:.2f}s")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,290 @@
+"""
+SCR static decoder (no execution)
+
+Decodes structural instructions (FUN_0025bc68) and their expression
+operands (FUN_0025c258) without running anything, using the operand
+signatures in scr_vm.OPERANDS. Every opcode met along the way, including
+the ones nested inside expressions, is reported as a Site together with its
+operand values where they are compile-time constants.
+
+Traversal is recursive descent from entry points, following the same edges
+the VM would take:
+- 0x01 if/else, 0x02 switch, 0x03/0x08/0x0A jump, 0x32 block call, 0x33
+  dialogue + jump, 0x04 block end.
+- 0x9D / 0xA1 / 0xA8 targets (slot, coroutine and lead scripts) are queued
+  as new entries.
+
+Entry points:
+- header main script: u32 at +8 (FUN_0025b778),
+- subproc prologues: `0B 04 <id16> 00 00` followed by the script; the
+  scheduler's debug print reads the ID from *(entry-4).
+"""
+from __future__ import annotations
+
+import struct
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Tuple
+
+from scr_vm import MASK, OPERANDS, _cdiv, header_main_entry
+
+# Operand value: int when constant, None when computed at runtime.
+Arg = Optional[int]
+
+# Folded expression ops (both operands constant).
+_BINARY = {
+    0x1B: lambda a, b: a | b, 0x21: lambda a, b: a | b,
+    0x1C: lambda a, b: a + b, 0x1D: lambda a, b: a - b,
+    0x1F: lambda a, b: a ^ b, 0x20: lambda a, b: a & b,
+    0x23: lambda a, b: a * b,
+}
+_UNARY = {0x18: lambda a: int(a == 0), 0x19: lambda a: ~a, 0x1E: lambda a: -a}
+
+SLOT_TARGET_OPS = (0x9D, 0xA1, 0xA8)
+
+
+class DecodeError(Exception):
+    def __init__(self, msg: str, off: int):
+        super().__init__(f"{msg} at 0x{off:X}")
+        self.off = off
+
+
+@dataclass
+class Site:
+    off: int
+    op: int
+    args: List[Arg]
+    end: int = 0                 # first byte after the operands
+
+
+@dataclass
+class Insn:
+    off: int
+    op: int                      # structural byte, 0x100+N for FF N
+    end: int
+    sites: List[Site] = field(default_factory=list)   # this op first, then nested ones
+    targets: List[int] = field(default_factory=list)  # jump / call targets
+    falls: bool = True           # execution continues at `end`
+    call: bool = False           # 0x32: target returns to `end`
+
+
+class Decoder:
+    def __init__(self, buf: bytes | bytearray | memoryview):
+        self.buf = buf
+        self.n = len(buf)
+        self._sites: List[Site] = []
+
+    def _need(self, pc: int, size: int) -> None:
+        if pc + size > self.n:
+            raise DecodeError("truncated", pc)
+
+    def _rel(self, cell: int) -> int:
+        self._need(cell, 4)
+        (rel,) = struct.unpack_from("<i", self.buf, cell)
+        return cell + rel
+
+    def expr(self, pc: int) -> Tuple[int, Arg]:
+        """Skip one expression starting at `pc`; returns (end, constant or None)."""
+        buf = self.buf
+        stack: List[Arg] = []
+        while True:
+            self._need(pc, 1)
+            op = buf[pc]
+            if op > 0x31:
+                pc, _ = self.op(pc)
+                stack.append(None)
+                continue
+            if op == 0x0B:
+                if not stack:
+                    return pc + 1, 0
+                top = stack[-1]
+                return pc + 1, None if top is None else top & MASK
+            if op == 0x0C:
+                self._need(pc, 2)
+                stack.append(buf[pc + 1])
+                pc += 2
+            elif op == 0x0D:
+                self._need(pc, 3)
+                stack.append(buf[pc + 1] | buf[pc + 2] << 8)
+                pc += 3
+            elif op in (0x0E, 0x0F):
+                self._need(pc, 5)
+                v = struct.unpack_from("<I" if op == 0x0E else "<i", buf, pc + 1)[0]
+                stack.append(v if op == 0x0E else v * 100)
+                pc += 5
+            elif op in (0x10, 0x11):
+                self._need(pc, 3)
+                v = struct.unpack_from("<h", buf, pc + 1)[0]
+                stack.append(v * 1000 if op == 0x10 else _cdiv(v * 0xF570, 0x168))
+                pc += 3
+            elif op in (0x30, 0x31):
+                pc += 1
+                for _ in range(3 if op == 0x30 else 4):
+                    pc, _ = self.expr(pc)
+                stack.append(None)
+            elif op in _UNARY:
+                if stack and stack[-1] is not None:
+                    stack[-1] = _UNARY[op](stack[-1]) & MASK
+                pc += 1
+            else:
+                if len(stack) >= 2:
+                    b = stack.pop()
+                    a = stack[-1]
+                    fn = _BINARY.get(op)
+                    stack[-1] = fn(a, b) & MASK if fn and a is not None and b is not None else None
+                elif stack:
+                    stack.pop()
+                pc += 1
+
+    def op(self, pc: int) -> Tuple[int, List[Arg]]:
+        """Decode one dispatched opcode (0x32..0xFE or FF N) and its operands."""
+        buf = self.buf
+        start = pc
+        if buf[pc] == 0xFF:
+            self._need(pc, 2)
+            op = 0x100 + buf[pc + 1]
+            pc += 2
+        else:
+            op = buf[pc]
+            pc += 1
+        sig = OPERANDS.get(op)
+        if sig is None:
+            raise DecodeError(f"no operand signature for {op:X}", start)
+        site = Site(start, op, [])
+        self._sites.append(site)
+        for c in sig:
+            if c == "e":
+                pc, v = self.expr(pc)
+            elif c == "b":
+                self._need(pc, 1)
+                v = buf[pc]
+                pc += 1
+            elif c == "h":
+                self._need(pc, 2)
+                v = buf[pc] | buf[pc + 1] << 8
+                pc += 2
+            elif c == "w":
+                self._need(pc, 4)
+                (v,) = struct.unpack_from("<I", buf, pc)
+                pc += 4
+            elif c == "J":
+                v = self._rel(pc)
+                pc += 4
+            else:  # "L"
+                self._need(pc, 1)
+                count = buf[pc]
+                self._need(pc, 1 + 4 * count)
+                v = count
+                pc += 1 + 4 * count
+            site.args.append(v)
+        site.end = pc
+        return pc, site.args
+
+    def insn(self, pc: int) -> Insn:
+        """Decode the structural instruction at `pc`."""
+        self._need(pc, 1)
+        buf = self.buf
+        op = buf[pc]
+        self._sites = []
+        ins = Insn(pc, op, pc + 1)
+        if op < 0x0B:
+            if op == 0x04:
+                ins.falls = False
+            elif op == 0x01:
+                cell, _ = self.expr(pc + 1)
+                ins.targets.append(self._rel(cell))
+                ins.end = cell + 4
+            elif op == 0x02:
+                p, _ = self.expr(pc + 1)
+                self._need(p, 1)
+                count = buf[p]
+                p += 1
+                p += -p & 3
+                self._need(p, 8 * count + 4)
+                for i in range(count):
+                    ins.targets.append(self._rel(p + 8 * i + 4))
+                p += 8 * count
+                ins.targets.append(self._rel(p))
+                ins.end = p + 4
+                ins.falls = False
+            elif op in (0x03, 0x08, 0x0A):
+                ins.targets.append(self._rel(pc + 1))
+                ins.end = pc + 5
+                ins.falls = False
+            elif op in (0x07, 0x09):
+                ins.end = pc + 5
+        elif op == 0x32:
+            ins.targets.append(self._rel(pc + 1))
+            ins.end = pc + 5
+            ins.call = True
+        elif op > 0x31:
+            ins.end, args = self.op(pc)
+            ins.op = self._sites[0].op
+            if ins.op == 0x33:
+                ins.targets.append(args[0])
+                ins.falls = False
+            elif ins.op in SLOT_TARGET_OPS and args[-1] is not None:
+                ins.targets.append(args[-1])
+        else:
+            raise DecodeError(f"expression byte {op:02X} at structural level", pc)
+        ins.sites = self._sites
+        self._sites = []
+        return ins
+
+
+# ---------------------------------------------------------------------------
+# Entry discovery and traversal
+# ---------------------------------------------------------------------------
+
+def subproc_prologues(buf: bytes | bytearray | memoryview) -> List[Tuple[int, int]]:
+    """(offset of the 0B, id16) for every raw `0B 04 <id16>` motif."""
+    data = bytes(buf)
+    out = []
+    i = data.find(b"\x0b\x04")
+    while 0 <= i <= len(data) - 4:
+        out.append((i, data[i + 2] | data[i + 3] << 8))
+        i = data.find(b"\x0b\x04", i + 1)
+    return out
+
+
+def find_entries(buf: bytes | bytearray | memoryview) -> List[Tuple[int, int]]:
+    """(entry, id16) for the header main script (id16 -1) and the script
+    after each `0B 04 <id16> 00 00` prologue."""
+    out = []
+    main = header_main_entry(buf)
+    if main is not None:
+        out.append((main, -1))
+    for off, id16 in subproc_prologues(buf):
+        entry = off + 6
+        if entry < len(buf) and buf[off + 4] == 0 and buf[off + 5] == 0:
+            out.append((entry, id16))
+    return out
+
+
+@dataclass
+class Walk:
+    insns: Dict[int, Insn] = field(default_factory=dict)
+    errors: Dict[int, str] = field(default_factory=dict)   # offset -> message
+
+
+def walk(buf: bytes | bytearray | memoryview, entries: List[int]) -> Walk:
+    """Recursive-descent decode of every instruction reachable from `entries`."""
+    dec = Decoder(buf)
+    res = Walk()
+    n = len(buf)
+    work = [e for e in entries if 0 <= e < n]
+    while work:
+        pc = work.pop()
+        while pc not in res.insns and pc not in res.errors:
+            try:
+                ins = dec.insn(pc)
+            except (DecodeError, IndexError) as ex:
+                res.errors[pc] = str(ex).split(" at 0x")[0]
+                break
+            res.insns[pc] = ins
+            work.extend(t for t in ins.targets if 0 <= t < n)
+            if not ins.falls:
+                break
+            pc = ins.end
+            if pc >= n:
+                break
+    return res
@@ -0,0 +1,479 @@
+"""
+SCR dialogue streams: extract to editable tables, re-encode, relocate
+
+Dialogue text lives inline in the bytecode. Structural opcode 0x33 is
+`33 <s32 rel>`: FUN_00237b38(cell + 4) starts the dialogue stream right
+after the jump cell, and the jump skips over it (scr_vm._op_dialogue_jump).
+So every reachable 0x33 in scr_cfg's Program gives one stream, spanning
+[cell + 4, jump target).
+
+Stream grammar (FUN_00237ca0, analyzed/dialogue_stream_recursive_parser.c):
+- bytes > 0x1E are text, consumed in 2-byte units (char, 0x00 for ASCII)
+- 0x00 / 0x01 end the stream
+- 0x13 speaker block: nested stream up to its own 0x00, which is consumed
+  (FUN_00239760, text_op_13)
+- 0x15 page: `15 a b n`, then n + 1 lines (the decompiled loop is
+  `while (n-- != 0xFF)`), each 2-byte units up to a single 0x00 byte
+- 0x16 voice: `16 channel wait <u32 id>` (text_op_16)
+- any other control advances by its entry in the PTR_DAT_0031c518 length
+  table (FUN_00238e50). The table isn't in the repo; OP_LENGTH holds the
+  lengths confirmed by the analyzed text_ops handlers, and a dump of the
+  table (`--length-table`, bytes from 0x0031C518) or `--op-length OP=LEN`
+  fills in the rest. A stream that reaches an unknown control is kept as
+  raw bytes and passed through unchanged.
+
+Table (one JSON file per script, `<name>.json`): streams with off/end and
+a token list; bytes after the terminator (up to the jump target) are kept
+as `tail`. Tokens:
+    {"text": "..."}                    {"ctl": "0C", "args": "05"}
+    {"voice": id, "channel": c, "wait": w}
+    {"page": [a, b], "lines": ["...", ...]}
+    {"speaker": [tokens]}              {"end": 0}
+Text: ASCII units (c, 00) are written as the character; every other unit,
+and `{` / `}`, as `{LLTT}` (the two bytes in hex).
+
+Rebuild re-encodes each stream and checks that it parses back to the same
+tokens. A stream that still fits its span is written in place, zero-padded
+up to the jump target, so nothing else moves. A longer one is zero-padded
+(into its tail) to grow by a multiple of 4 bytes, since 0x02 case tables
+are 4-byte aligned and would decode differently after an odd shift. It
+shifts the rest of the script, and every offset into it is moved with it:
+- relative cells of 0x01 / 0x02 / 0x03 / 0x08 / 0x0A / 0x32 / 0x33
+- 0x9D / 0xA1 / 0xA8 inline u32 targets
+- the 11 header dwords and the pointer table [header[5], header[6]) up to
+  its 0 sentinel (docs/scr_file_reverse_engineering_summary.md)
+- the footer chain FUN_00228e28 relocates: the list offset at
+  header[7] + 0x3C and the list's entries up to their 0 sentinel
+  (script_header_loader.c)
+Only reachable code is known, so a script with decode stops gets a warning.
+The result is a decompressed scrN.out; pack it with
+tools/resource_extract/v2/lz_encode.py / repack.py.
+"""
+from __future__ import annotations
+
+import argparse
+import bisect
+import json
+import os
+import re
+import struct
+import sys
+import time
+from typing import Dict, List, Optional, Sequence, Tuple
+
+from scr_cfg import Program, _inputs, load_program
+from scr_decode import SLOT_TARGET_OPS
+
+CONTROL_MAX = 0x1E
+HEADER_WORDS = 11
+
+# Control opcode -> total length in bytes (opcode included), from the
+# analyzed/text_ops handlers. None = not known yet.
+OP_LENGTH: List[Optional[int]] = [None] * (CONTROL_MAX + 1)
+OP_LENGTH[0x02] = 1   # terminate stream, no operands
+OP_LENGTH[0x07] = 1   # advance glyph timers
+OP_LENGTH[0x0C] = 2   # shifted parameter
+OP_LENGTH[0x17] = 1   # wait for audio load
+OP_LENGTH[0x18] = 1   # 0x18 / 0x19: second byte only read for 0x19
+OP_LENGTH[0x19] = 2
+OP_LENGTH[0x1A] = 1   # wait for audio idle
+OP_LENGTH[0x1B] = 3   # 0x1B / 0x1C: u16 flag id
+OP_LENGTH[0x1C] = 3
+OP_LENGTH[0x1D] = 2   # icon id
+
+_REL_OPS = (0x03, 0x08, 0x0A, 0x32, 0x33)
+
+
+class DialogueError(Exception):
+    def __init__(self, msg: str, off: int):
+        super().__init__(f"{msg} at 0x{off:X}")
+        self.off = off
+
+
+# ---------------------------------------------------------------------------
+# Text units
+# ---------------------------------------------------------------------------
+
+_ESC = re.compile(r"\{([0-9A-Fa-f]{4})\}")
+
+
+def decode_units(data: bytes) -> str:
+    out = []
+    for i in range(0, len(data), 2):
+        c, t = data[i], data[i + 1]
+        if t == 0 and 0x20 <= c < 0x7F and c not in (0x7B, 0x7D):
+            out.append(chr(c))
+        else:
+            out.append(f"{{{c:02X}{t:02X}}}")
+    return "".join(out)
+
+
+def encode_units(text: str) -> bytes:
+    out = bytearray()
+    i = 0
+    while i < len(text):
+        m = _ESC.match(text, i)
+        if m:
+            out += bytes.fromhex(m.group(1))
+            i = m.end()
+            continue
+        c = ord(text[i])
+        if not 0x20 <= c < 0x7F or text[i] in "{}":
+            raise ValueError(f"character {text[i]!r} has no encoding; write it as {{LLTT}}")
+        out += bytes((c, 0))
+        i += 1
+    return bytes(out)
+
+
+# ---------------------------------------------------------------------------
+# Stream parse / encode
+# ---------------------------------------------------------------------------
+
+def _units(buf, p: int, end: int, stop) -> int:
+    """End of the 2-byte units from `p` while stop(lead byte) is false."""
+    while p < end and not stop(buf[p]):
+        if p + 2 > end:
+            raise DialogueError("text unit runs past the stream", p)
+        p += 2
+    return p
+
+
+def parse_stream(buf, p: int, end: int,
+                 lengths: Sequence[Optional[int]] = OP_LENGTH) -> Tuple[List[dict], int]:
+    """Tokens of the stream at `p` up to and including its terminator, and
+    the offset after it (FUN_00237ca0 grammar)."""
+    tokens: List[dict] = []
+    while True:
+        if p >= end:
+            raise DialogueError("no terminator before the end of the stream", p)
+        b = buf[p]
+        if b > CONTROL_MAX:
+            q = _units(buf, p, end, lambda c: c <= CONTROL_MAX)
+            tokens.append({"text": decode_units(bytes(buf[p:q]))})
+            p = q
+        elif b < 2:
+            tokens.append({"end": b})
+            return tokens, p + 1
+        elif b == 0x13:
+            sub, p = parse_stream(buf, p + 1, end, lengths)
+            tokens.append({"speaker": sub})
+        elif b == 0x15:
+            if p + 4 > end:
+                raise DialogueError("truncated page header", p)
+            p1, p2, n = buf[p + 1], buf[p + 2], buf[p + 3]
+            p += 4
+            lines = []
+            for _ in range(n + 1):
+                q = _units(buf, p, end, lambda c: c == 0)
+                if q >= end:
+                    raise DialogueError("unterminated page line", p)
+                lines.append(decode_units(bytes(buf[p:q])))
+                p = q + 1
+            tokens.append({"page": [p1, p2], "lines": lines})
+        elif b == 0x16:
+            if p + 7 > end:
+                raise DialogueError("truncated voice control", p)
+            (vid,) = struct.unpack_from("<I", buf, p + 3)
+            tokens.append({"voice": vid, "channel": buf[p + 1], "wait": buf[p + 2]})
+            p += 7
+        else:
+            n = lengths[b]
+            if not n:
+                raise DialogueError(f"no length for control {b:02X}", p)
+            if p + n > end:
+                raise DialogueError(f"truncated control {b:02X}", p)
+            tokens.append({"ctl": f"{b:02X}", "args": bytes(buf[p + 1:p + n]).hex().upper()})
+            p += n
+
+
+def encode_stream(tokens: List[dict]) -> bytes:
+    out = bytearray()
+    for t in tokens:
+        if "text" in t:
+            out += encode_units(t["text"])
+        elif "end" in t:
+            out.append(t["end"])
+        elif "speaker" in t:
+            out.append(0x13)
+            out += encode_stream(t["speaker"])
+        elif "page" in t:
+            lines = t["lines"]
+            if not 1 <= len(lines) <= 0x100:
+                raise ValueError(f"page needs 1..256 lines, has {len(lines)}")
+            out += bytes((0x15, t["page"][0], t["page"][1], len(lines) - 1))
+            for line in lines:
+                out += encode_units(line) + b"\x00"
+        elif "voice" in t:
+            out += bytes((0x16, t["channel"], t["wait"])) + struct.pack("<I", t["voice"])
+        elif "ctl" in t:
+            out.append(int(t["ctl"], 16))
+            out += bytes.fromhex(t["args"])
+        else:
+            raise ValueError(f"unknown token {t!r}")
+    return bytes(out)
+
+
+# ---------------------------------------------------------------------------
+# Extract
+# ---------------------------------------------------------------------------
+
+def stream_spans(prog: Program) -> List[Tuple[int, int]]:
+    """[start, end) of the stream behind every reachable 0x33."""
+    out = []
+    for i in range(len(prog)):
+        if prog.ins_op[i] == 0x33:
+            start = prog.ins_off[i] + 5
+            end = prog.targets(i)[0]
+            if end > start:
+                out.append((start, end))
+    return out
+
+
+def extract(buf, prog: Program,
+            lengths: Sequence[Optional[int]] = OP_LENGTH) -> List[dict]:
+    """One entry per dialogue stream: off, end and tokens + tail, or raw +
+    error when the stream can't be parsed."""
+    streams = []
+    for start, end in stream_spans(prog):
+        s: dict = {"off": start, "end": end}
+        try:
+            tokens, p = parse_stream(buf, start, end, lengths)
+            s["tokens"] = tokens
+            s["tail"] = bytes(buf[p:end]).hex().upper()
+        except DialogueError as ex:
+            s["raw"] = bytes(buf[start:end]).hex().upper()
+            s["error"] = str(ex)
+        streams.append(s)
+    return streams
+
+
+def stream_bytes(s: dict, lengths: Sequence[Optional[int]] = OP_LENGTH) -> bytes:
+    """Encoded stream (tokens + tail, or raw), checked to parse back to the
+    same tokens."""
+    if "raw" in s:
+        return bytes.fromhex(s["raw"])
+    body = encode_stream(s["tokens"])
+    tokens, p = parse_stream(body, 0, len(body), lengths)
+    if p != len(body) or tokens != s["tokens"]:
+        raise ValueError(f"stream 0x{s['off']:X}: tokens don't round-trip "
+                         "(text before a control must be whole units; one `end` last)")
+    return body + bytes.fromhex(s.get("tail", ""))
+
+
+# ---------------------------------------------------------------------------
+# Rebuild
+# ---------------------------------------------------------------------------
+
+class _Shift:
+    """Old offset -> new offset after replacing spans [start, end) with
+    `size` bytes each; offsets inside a span keep their distance from its
+    start."""
+
+    def __init__(self, edits: List[Tuple[int, int, int]]):
+        self.starts = [s for s, _e, _n in edits]
+        self.edits = edits
+        self.delta = []
+        d = 0
+        for s, e, n in edits:
+            d += n - (e - s)
+            self.delta.append(d)
+
+    def __call__(self, x: int) -> int:
+        k = bisect.bisect_right(self.starts, x) - 1
+        if k < 0:
+            return x
+        s, e, n = self.edits[k]
+        before = self.delta[k - 1] if k else 0
+        if x < e:
+            return x + before
+        return x + self.delta[k]
+
+
+def _relocations(old, prog: Program) -> List[Tuple[str, int, int, int]]:
+    """(kind, cell, base, target) for every offset stored in the script:
+    kind "rel" (s32 target - base) or "abs" (u32 target)."""
+    out = []
+    n = len(old)
+    for i in range(len(prog)):
+        op, off = prog.ins_op[i], prog.ins_off[i]
+        end = off + prog.ins_len[i]
+        tg = prog.targets(i)
+        if op == 0x01:
+            out.append(("rel", end - 4, end - 4, tg[0]))
+        elif op == 0x02:
+            cases = len(tg) - 1
+            for k in range(cases):
+                cell = end - 8 * cases + 8 * k
+                out.append(("rel", cell, cell, tg[k]))
+            out.append(("rel", end - 4, end - 4, tg[-1]))
+        elif op in _REL_OPS:
+            out.append(("rel", off + 1, off + 1, tg[0]))
+    for s_off, s_end, s_op, args in prog.all_sites():
+        if s_op not in SLOT_TARGET_OPS or not args or args[-1] is None:
+            continue
+        # Inline u32 operand, always last ("ew" / "w").
+        if 0 < args[-1] < n:
+            out.append(("abs", s_end - 4, 0, args[-1]))
+    if n >= HEADER_WORDS * 4:
+        header = struct.unpack_from(f"<{HEADER_WORDS}I", old, 0)
+        for k, v in enumerate(header):
+            if 0 < v <= n:
+                out.append(("abs", 4 * k, 0, v))
+        lo, hi = header[5], header[6]
+        if HEADER_WORDS * 4 <= lo < hi <= n:
+            for cell in range(lo, hi - 3, 4):
+                (v,) = struct.unpack_from("<I", old, cell)
+                if v == 0:
+                    break
+                if v <= n:
+                    out.append(("abs", cell, 0, v))
+        link = header[7] + 0x3C
+        if header[7] and link + 4 <= n:
+            (lst,) = struct.unpack_from("<I", old, link)
+            if HEADER_WORDS * 4 <= lst < n:
+                out.append(("abs", link, 0, lst))
+                for cell in range(lst, n - 3, 4):
+                    (v,) = struct.unpack_from("<I", old, cell)
+                    if v == 0:
+                        break
+                    if v <= n:
+                        out.append(("abs", cell, 0, v))
+    return out
+
+
+def rebuild(old: bytes, prog: Program, streams: List[dict],
+            lengths: Sequence[Optional[int]] = OP_LENGTH) -> Tuple[bytes, Dict[str, int]]:
+    """Script with every stream of `streams` re-encoded; returns the new
+    bytes and counts of changed / in-place / grown streams."""
+    out = bytearray(old)
+    grow: List[Tuple[int, int, bytes]] = []
+    stats = {"changed": 0, "in_place": 0, "grown": 0}
+    spans = set(stream_spans(prog))
+    for s in streams:
+        start, end = s["off"], s["end"]
+        if (start, end) not in spans:
+            raise DialogueError("table stream is not a 0x33 stream of this script", start)
+        body = stream_bytes(s, lengths)
+        if body == old[start:end]:
+            continue
+        stats["changed"] += 1
+        if len(body) <= end - start:
+            out[start:end] = body + bytes(end - start - len(body))
+            stats["in_place"] += 1
+        else:
+            # Keep later code 4-byte aligned (0x02 case tables).
+            body += bytes(-(len(body) - (end - start)) % 4)
+            grow.append((start, end, body))
+            stats["grown"] += 1
+    if not grow:
+        return bytes(out), stats
+
+    grow.sort()
+    shift = _Shift([(s, e, len(b)) for s, e, b in grow])
+    relocs = _relocations(old, prog)
+    new = bytearray()
+    pos = 0
+    for s, e, body in grow:
+        new += out[pos:s] + body
+        pos = e
+    new += out[pos:]
+    for kind, cell, base, target in relocs:
+        c, t = shift(cell), shift(target)
+        if kind == "rel":
+            struct.pack_into("<i", new, c, t - shift(base))
+        else:
+            struct.pack_into("<I", new, c, t)
+    return bytes(new), stats
+
+
+# ---------------------------------------------------------------------------
+# CLI
+# ---------------------------------------------------------------------------
+
+def _lengths(args) -> List[Optional[int]]:
+    lengths = list(OP_LENGTH)
+    if args.length_table:
+        with open(args.length_table, "rb") as f:
+            table = f.read(CONTROL_MAX + 1)
+        for op, v in enumerate(table):
+            v = v - 0x100 if v > 0x7F else v
+            if v > 0:
+                lengths[op] = v
+    for item in args.op_length or ():
+        op, _, n = item.partition("=")
+        lengths[int(op, 16) & 0xFF] = int(n, 0)
+    return lengths
+
+
+def _table_path(tables: str, script: str) -> str:
+    return os.path.join(tables, os.path.basename(script) + ".json")
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    ap = argparse.ArgumentParser(description="Extract / reinsert SCR dialogue streams")
+    ap.add_argument("--length-table", help="Dump of the PTR_DAT_0031c518 length table (raw bytes)")
+    ap.add_argument("--op-length", action="append", metavar="OP=LEN",
+                    help="Control opcode length in bytes, opcode in hex (repeatable)")
+    ap.add_argument("--cache", default=None, help="scr_cfg cache directory for decoded scripts")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    x = sub.add_parser("extract", help="Write one dialogue table per scrN.out")
+    x.add_argument("inputs", nargs="+")
+    x.add_argument("-o", "--out", default="dialogue")
+    r = sub.add_parser("rebuild", help="Re-encode edited tables into new scrN.out files")
+    r.add_argument("inputs", nargs="+")
+    r.add_argument("--tables", default="dialogue", help="Directory of <name>.json tables")
+    r.add_argument("-o", "--out", required=True, help="Output directory")
+    args = ap.parse_args(argv)
+    lengths = _lengths(args)
+    paths = _inputs(args.inputs)
+    os.makedirs(args.out, exist_ok=True)
+    t0 = time.perf_counter()
+
+    if args.cmd == "extract":
+        totals = [0, 0, 0]
+        for p in paths:
+            with open(p, "rb") as f:
+                buf = f.read()
+            prog = load_program(p, args.cache)
+            streams = extract(buf, prog, lengths)
+            totals[0] += len(streams)
+            totals[1] += sum("raw" in s for s in streams)
+            totals[2] += len(prog.err_off)
+            with open(_table_path(args.out, p), "w", encoding="utf-8") as f:
+                json.dump({"script": os.path.basename(p), "size": len(buf), "streams": streams},
+                          f, ensure_ascii=False, indent=1)
+        print(f"{args.out}: {len(paths)} scripts, {totals[0]} streams, {totals[1]} raw, "
+              f"{totals[2]} decode stops, {time.perf_counter() - t0:.2f}s")
+        return 0
+
+    failed = 0
+    for p in paths:
+        name = os.path.basename(p)
+        with open(p, "rb") as f:
+            buf = f.read()
+        try:
+            with open(_table_path(args.tables, p), encoding="utf-8") as f:
+                table = json.load(f)
+        except FileNotFoundError:
+            continue
+        prog = load_program(p, args.cache)
+        try:
+            new, st = rebuild(buf, prog, table["streams"], lengths)
+        except (DialogueError, ValueError) as ex:
+            print(f"{name}: {ex}", file=sys.stderr)
+            failed += 1
+            continue
+        if st["grown"] and prog.err_off:
+            print(f"{name}: warning: {len(prog.err_off)} decode stops; offsets in "
+                  "undecoded code were not moved", file=sys.stderr)
+        with open(os.path.join(args.out, name), "wb") as f:
+            f.write(new)
+        if st["changed"]:
+            print(f"{name}: {st['changed']} streams changed ({st['in_place']} in place, "
+                  f"{st['grown']} grown), {len(new) - len(buf):+d} bytes")
+    print(f"{len(paths)} scripts, {failed} failed, {time.perf_counter() - t0:.2f}s")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,829 @@
+"""
+SCR host VM (source-validated core, modelled engine state)
+
+Executes decompressed scrN.out buffers on the host: the structural
+interpreter (FUN_0025bc68), the expression evaluator (FUN_0025c258 +
+FUN_0025bf70) and the per-frame slot scheduler (FUN_0025b778), against a
+simulated work memory, flag buckets, subproc slot table and entity pool.
+Intended for regression replays and opcode coverage over whole SCR dumps,
+not for rendering anything.
+
+Dispatch:
+- One flat table of 0x200 handlers indexed by the opcode value (0x32..0xFE
+  standard, 0x100+N for `FF N`), mirroring PTR_LAB_0031e228 /
+  PTR_LAB_0031e538. Looked up once per instruction; no per-op branching.
+- Opcodes whose effect matters for control flow or script-visible state
+  have real handlers (work/flag ALU, flag bits, slots, coroutines, timed
+  waits, registers, entity select/spawn, script memory, dialogue start).
+- Every other opcode with a known operand signature (OPERANDS, derived from
+  analyzed/ops/*.c) consumes its operands exactly like the game and returns
+  0. Nested expressions are still evaluated, so their side effects happen.
+- Opcodes with no signature (variable-length or unanalyzed) raise
+  VMUnsupported.
+
+Operand signature grammar (OPERANDS):
+  e  one expression (FUN_0025c258, ends at 0x0B)
+  b  inline u8         h  inline u16 LE     w  inline u32 LE (FUN_0025c1d0)
+  J  inline s32 relative jump, taken (0x33)
+  L  u8 count, then count x w (0x4D)
+  "" no operands; None = unsupported
+
+Notes:
+- pbGpffffbd60 and DAT_00355cd0 are the same IP (GP-relative alias), so the
+  VM keeps a single `pc`. Jumps (FUN_0025c220) are relative to the address
+  of the s32 cell.
+- Values are u32; comparisons, division and modulo use signed views with C
+  truncation. Division by zero (trap(7) in the game) raises VMError.
+- Unmodelled handlers return 0, so a script polling one in a 0x01 condition
+  can spin; the per-run step budget turns that into VMBudget.
+"""
+from __future__ import annotations
+
+import argparse
+import os
+import re
+import struct
+import sys
+import time
+from collections import Counter
+from dataclasses import dataclass, field
+from typing import Callable, Dict, List, Optional, Tuple
+
+MASK = 0xFFFFFFFF
+
+WORK_WORDS = 0x80          # iGpffffb0f0, "script work over" beyond 0x7F
+FLAG_BYTES = 0x900         # DAT_00342b70
+FLAG_MAX_BIT = 0x47F8
+SLOT_COUNT = 0x41          # iGpffffbd84 table
+SLOT_RUN = 0x3E            # FUN_0025b778 runs slots 0..0x3D
+SLOT_LEAD = 0x40           # set by 0xA8
+COROUTINES = 4             # DAT_00571e40
+POOL_SIZE = 0x100          # DAT_0058beb0, stride 0xEC
+POOL_SPAWN_FIRST = 10      # FUN_00265dc0(10, 0xF6)
+POOL_TAGGED_FIRST = 20     # 0x5A scans from DAT_0058d120
+FRAME_DELTA_Q5 = 32        # iGpffffb64c for one tick (0x42/0x44/0x8F)
+DEFAULT_BUDGET = 200_000
+
+
+class VMError(Exception):
+    def __init__(self, msg: str, pc: int):
+        super().__init__(f"{msg} at 0x{pc:X}")
+        self.pc = pc
+
+
+class VMUnsupported(VMError):
+    def __init__(self, op: int, pc: int):
+        super().__init__(f"unsupported opcode {op_name(op)}", pc)
+        self.op = op
+
+
+class VMBudget(VMError):
+    pass
+
+
+def op_name(op: int) -> str:
+    return f"FF {op - 0x100:02X}" if op >= 0x100 else f"{op:02X}"
+
+
+def _s32(v: int) -> int:
+    v &= MASK
+    return v - 0x100000000 if v & 0x80000000 else v
+
+
+def _cdiv(a: int, b: int) -> int:
+    q = abs(a) // abs(b)
+    return q if (a < 0) == (b < 0) else -q
+
+
+def _cmod(a: int, b: int) -> int:
+    return a - b * _cdiv(a, b)
+
+
+# ---------------------------------------------------------------------------
+# Operand signatures (analyzed/ops/*.c, analyzed/opcode_dispatch_tables.md)
+# ---------------------------------------------------------------------------
+
+_STD = {
+    0x32: "", 0x33: "J", 0x34: "", 0x35: "",
+    0x36: "e", 0x37: "eeb", 0x38: "e", 0x39: "eeb",
+    0x3A: "", 0x3B: "", 0x3C: "e", 0x3D: "e", 0x3E: "e", 0x3F: "e", 0x40: "e",
+    0x41: None, 0x42: "e", 0x43: None, 0x44: "e",
+    0x45: "e", 0x46: "6e", 0x47: "3e", 0x48: "3e", 0x49: "e", 0x4A: "b6e", 0x4B: "",
+    0x4C: "e", 0x4D: "L", 0x4E: "ewe", 0x4F: "",
+    0x50: "ew", 0x51: "b", 0x52: "e", 0x53: "ee", 0x54: "4e", 0x55: "4e", 0x56: "ee",
+    0x57: "3e", 0x58: "e", 0x59: "", 0x5A: "e", 0x5B: "eb", 0x5C: "e", 0x5D: "3e",
+    0x5E: "ee", 0x5F: "ee",
+    0x60: "3e", 0x61: "eb", 0x62: "e", 0x63: "6e", 0x64: "e", 0x65: "hw5e", 0x66: "ew",
+    0x67: "6e", 0x68: "3e", 0x69: "3e", 0x6A: "3e", 0x6B: "", 0x6C: "ee", 0x6D: "b",
+    0x6E: "4e", 0x6F: "4e",
+    0x70: "e", 0x71: "e", 0x72: "3e", 0x73: "ee", 0x74: "ee", 0x75: "ee", 0x76: "ee",
+    0x77: "3e", 0x78: "3e", 0x79: "3e", 0x7A: "3e", 0x7B: "3e", 0x7C: "3e",
+    0x7D: "ebe", 0x7E: "ebe", 0x7F: "eb",
+    0x80: "eb", 0x81: "ebee", 0x82: "ebee", 0x83: "ee", 0x84: "e", 0x85: "ee", 0x86: "",
+    0x87: "ee", 0x88: "", 0x89: "ee", 0x8A: "5e", 0x8B: "7e", 0x8C: "6e", 0x8D: "",
+    0x8E: "e", 0x8F: "",
+    0x90: "4e", 0x91: "e", 0x92: "e", 0x93: "e", 0x94: "ee", 0x95: "", 0x96: "3e",
+    0x97: "6e", 0x98: "6e", 0x99: "3e", 0x9A: "8e", 0x9B: "e", 0x9C: "eb", 0x9D: "ew",
+    0x9E: "e", 0x9F: "b",
+    0xA0: "", 0xA1: "ew", 0xA2: "e", 0xA3: "e", 0xA4: "eb", 0xA5: "ebe", 0xA6: "eb",
+    0xA7: "ee", 0xA8: "w", 0xA9: "eeb", 0xAA: "", 0xAB: "b3e", 0xAC: "4e", 0xAD: "e",
+    0xAE: "ee", 0xAF: "e",
+    0xB0: "e", 0xB1: "ee", 0xB2: "3e", 0xB3: "5e", 0xB4: "eebe", 0xB5: "3e", 0xB6: "ee",
+    0xB7: "3e", 0xB8: "e", 0xB9: "3e", 0xBA: "3e", 0xBB: "ee", 0xBC: "e", 0xBD: "4e",
+    0xBE: "ee", 0xBF: "4e",
+    0xC0: "4e", 0xC1: "8e", 0xC2: "ee", 0xC3: "4e", 0xC4: "ee", 0xC5: "4e", 0xC6: "ee",
+    0xC7: "e", 0xC8: "e", 0xC9: "6e", 0xCA: "e", 0xCB: "e", 0xCC: "e", 0xCD: "e",
+    0xCE: "e", 0xCF: "ew",
+    0xD0: "e", 0xD1: "ewe", 0xD2: "eb", 0xD3: "ebe", 0xD4: "", 0xD5: "e", 0xD6: "e",
+    0xD7: "ee", 0xD8: "we", 0xD9: "ew", 0xDA: "e", 0xDB: "", 0xDC: "e", 0xDD: "ee",
+    0xDE: "ee", 0xDF: "",
+    0xE0: "", 0xE1: "", 0xE2: "e", 0xE3: "e", 0xE4: "4e", 0xE5: "be", 0xE6: "3e",
+    0xE7: "", 0xE8: "e", 0xE9: "", 0xEA: "", 0xEB: "e", 0xEC: "e", 0xED: "",
+    0xEE: "4e", 0xEF: "3e",
+    0xF0: "ee", 0xF1: "ee", 0xF2: "ee", 0xF3: "e", 0xF4: "ee", 0xF5: "",
+}
+
+_EXT = {
+    0x00: "b", 0x01: "3e", 0x02: "8e", 0x03: "ee", 0x04: "7e", 0x05: "3e", 0x06: "8e",
+    0x07: "3e", 0x08: "8e", 0x09: "6e", 0x0A: "8e", 0x0B: "10e", 0x0C: "11e",
+    0x0D: "9e", 0x0E: "10e", 0x0F: "14e",
+    0x10: "3e", 0x11: "3e", 0x12: "e", 0x13: "e", 0x14: "11e", 0x15: "e", 0x16: "3e",
+    0x17: "ee", 0x18: "ee", 0x19: "3e", 0x1A: "ee", 0x1B: "ee", 0x1C: "4e", 0x1D: "3e",
+    0x1E: "3e", 0x1F: "ee",
+    0x20: "e", 0x21: "e", 0x22: "4e", 0x23: "3e", 0x24: "3e", 0x25: "he", 0x26: "hee",
+    0x27: "heee", 0x28: "heeee", 0x29: "ee", 0x2A: "3e", 0x2B: "3e", 0x2C: "e",
+    0x2D: "e", 0x2E: "ee", 0x2F: "ee",
+    0x30: "e", 0x31: "e", 0x32: "ew", 0x33: "ew", 0x34: "", 0x35: "e", 0x36: "ee",
+    0x37: "e", 0x38: "8e", 0x39: "e", 0x3A: "e", 0x3B: "e", 0x3C: "e", 0x3D: "ee",
+    0x3E: "", 0x3F: "3e",
+    0x40: "5e", 0x41: "6e", 0x42: "e", 0x43: "3e", 0x44: "ee", 0x45: "5e", 0x46: "e",
+    0x47: "e", 0x48: "", 0x49: "e", 0x4A: "ee",
+}
+
+
+def _expand(sig: Optional[str]) -> Optional[str]:
+    """'b6e' -> 'beeeeee'."""
+    if sig is None:
+        return None
+    return re.sub(r"(\d+)(\D)", lambda m: m.group(2) * int(m.group(1)), sig)
+
+
+OPERANDS: Dict[int, Optional[str]] = {op: _expand(s) for op, s in _STD.items()}
+OPERANDS.update({0x100 + n: _expand(s) for n, s in _EXT.items()})
+
+
+# ---------------------------------------------------------------------------
+# Simulated engine state
+# ---------------------------------------------------------------------------
+
+@dataclass
+class Entity:
+    index: int
+    type_id: int
+    tag: int = 0                      # +0x4C, matched by 0x5A
+    regs: Dict[int, int] = field(default_factory=dict)  # FUN_0025c548 / FUN_0025c8f8
+
+
+@dataclass
+class RunStats:
+    runs: int = 0
+    steps: int = 0
+    ops: Counter = field(default_factory=Counter)
+    errors: Counter = field(default_factory=Counter)
+
+
+class ScrVM:
+    def __init__(self, buf: bytes | bytearray, code_base: int = 0,
+                 budget: int = DEFAULT_BUDGET, frame_delta: int = FRAME_DELTA_Q5):
+        # Scripts may write their own data (0xD3), so execute from a private copy.
+        self.buf = bytearray(buf)
+        self.code_base = code_base        # iGpffffb0e8, as an offset into buf
+        self.budget = budget
+        self.frame_delta = frame_delta
+        self.pc = 0
+        self.op = 0                       # DAT_00355cd8 / sGpffffbd68
+        self.stats = RunStats()
+
+        self.work = [0] * WORK_WORDS
+        self.flags = bytearray(FLAG_BYTES)
+        self.slots: List[Optional[int]] = [None] * SLOT_COUNT
+        self.current_slot = -1            # uGpffffbd88 / DAT_00355cf8
+        self.coroutines: List[Tuple[Optional[int], int]] = [(None, 0)] * COROUTINES
+        self.timer_q5 = 0                 # iGpffffbd78
+        self.short_355064 = 0
+        self.entities: Dict[int, Entity] = {}
+        self.selected: Optional[int] = None   # DAT_00355044 as a pool index
+        self.dialogue_starts: List[int] = []  # FUN_00237b38 call sites (0x33)
+
+        self.table: List[Optional[Callable[[], int]]] = [None] * 0x200
+        for op, sig in OPERANDS.items():
+            if sig is not None:
+                self.table[op] = self._generic(sig)
+        for op, fn in self._handlers().items():
+            self.table[op] = fn
+
+    # -- stream primitives --------------------------------------------------
+
+    def _u8(self) -> int:
+        v = self.buf[self.pc]
+        self.pc += 1
+        return v
+
+    def _u16(self) -> int:
+        (v,) = struct.unpack_from("<H", self.buf, self.pc)
+        self.pc += 2
+        return v
+
+    def _u32(self) -> int:
+        (v,) = struct.unpack_from("<I", self.buf, self.pc)
+        self.pc += 4
+        return v
+
+    def _jump(self) -> None:
+        """FUN_0025c220: pc += s32 at pc."""
+        (rel,) = struct.unpack_from("<i", self.buf, self.pc)
+        self.pc += rel
+
+    def _generic(self, sig: str) -> Callable[[], int]:
+        ev, u8, u16, u32 = self.eval, self._u8, self._u16, self._u32
+        readers = {"e": ev, "b": u8, "h": u16, "w": u32, "J": self._jump, "L": self._op_id_list}
+        steps = [readers[c] for c in sig]
+
+        def handler() -> int:
+            for step in steps:
+                step()
+            return 0
+        return handler
+
+    # -- dispatch -----------------------------------------------------------
+
+    def call(self, op: int) -> int:
+        self.op = op
+        self.stats.ops[op] += 1
+        fn = self.table[op]
+        if fn is None:
+            raise VMUnsupported(op, self.pc)
+        return fn() & MASK
+
+    def eval(self) -> int:
+        """FUN_0025c258: evaluate one expression up to and including 0x0B."""
+        buf = self.buf
+        stack = [0]
+        while True:
+            pc = self.pc
+            op = buf[pc]
+            if op > 0x31:
+                if op == 0xFF:
+                    self.pc = pc + 2
+                    stack.append(self.call(0x100 + buf[pc + 1]))
+                else:
+                    self.pc = pc + 1
+                    stack.append(self.call(op))
+                continue
+            # FUN_0025bf70 immediates
+            if op == 0x0C:
+                stack.append(buf[pc + 1])
+                self.pc = pc + 2
+                continue
+            if op == 0x0D:
+                stack.append(buf[pc + 1] | buf[pc + 2] << 8)
+                self.pc = pc + 3
+                continue
+            if op == 0x0E:
+                stack.append(struct.unpack_from("<I", buf, pc + 1)[0])
+                self.pc = pc + 5
+                continue
+            if op == 0x0F:
+                stack.append(struct.unpack_from("<i", buf, pc + 1)[0] * 100 & MASK)
+                self.pc = pc + 5
+                continue
+            if op == 0x10:
+                stack.append(struct.unpack_from("<h", buf, pc + 1)[0] * 1000 & MASK)
+                self.pc = pc + 3
+                continue
+            if op == 0x11:
+                v = struct.unpack_from("<h", buf, pc + 1)[0]
+                stack.append(_cdiv(v * 0xF570, 0x168) & MASK)
+                self.pc = pc + 3
+                continue
+            if op >= 0x30:
+                self.pc = pc + 1
+                packed = 0
+                for i in range(3 if op == 0x30 else 4):
+                    packed |= (self.eval() & 0xFF) << (8 * i)
+                stack.append(packed)
+                continue
+
+            self.pc = pc + 1
+            if op == 0x0B:
+                return stack[-1]
+            top = stack[-1]
+            # Unary: replace top, no pop.
+            if op == 0x18:
+                stack[-1] = int(top == 0)
+                continue
+            if op == 0x19:
+                stack[-1] = ~top & MASK
+                continue
+            if op == 0x1E:
+                stack[-1] = -top & MASK
+                continue
+            if len(stack) < 2:
+                raise VMError("expression stack underflow", pc)
+            older = stack[-2]
+            if op == 0x12:
+                r = int(older == top)
+            elif op == 0x13:
+                r = int(older != top)
+            elif op == 0x14:
+                r = int(_s32(older) < _s32(top))
+            elif op == 0x15:
+                r = int(_s32(top) < _s32(older))
+            elif op == 0x16:
+                r = int(_s32(top) >= _s32(older))
+            elif op == 0x17:
+                r = int(_s32(older) >= _s32(top))
+            elif op == 0x1A:
+                r = int(older != 0 and top != 0)
+            elif op in (0x1B, 0x21):
+                r = older | top
+            elif op == 0x1C:
+                r = (older + top) & MASK
+            elif op == 0x1D:
+                r = (older - top) & MASK
+            elif op == 0x1F:
+                r = older ^ top
+            elif op == 0x20:
+                r = older & top
+            elif op == 0x23:
+                r = (older * top) & MASK
+            elif op in (0x22, 0x24):
+                if top == 0:
+                    raise VMError("division by zero", pc)
+                f = _cdiv if op == 0x22 else _cmod
+                r = f(_s32(older), _s32(top)) & MASK
+            else:
+                # No case in the switch: the value is dropped.
+                stack.pop()
+                continue
+            stack[-2] = r
+            stack.pop()
+
+    def run(self, entry: int) -> None:
+        """FUN_0025bc68: run one structural script from `entry` to its base 0x04."""
+        buf = self.buf
+        end = len(buf)
+        returns: List[int] = []
+        self.pc = entry
+        self.stats.runs += 1
+        steps = self.budget
+        try:
+            while True:
+                pc = self.pc
+                if not 0 <= pc < end:
+                    raise VMError("pc out of buffer", pc)
+                steps -= 1
+                if steps < 0:
+                    raise VMBudget("step budget exhausted", pc)
+                op = buf[pc]
+                if op < 0x0B:
+                    self.pc = pc + 1
+                    if op == 0x04:
+                        if not returns:
+                            break
+                        self.pc = returns.pop()
+                    else:
+                        self._structural_low(op)
+                elif op == 0xFF:
+                    self.pc = pc + 2
+                    self.call(0x100 + buf[pc + 1])
+                elif op == 0x32:
+                    if len(returns) >= 32:
+                        raise VMError("block nesting overflow", pc)
+                    returns.append(pc + 5)
+                    self.pc = pc + 1
+                    self._jump()
+                elif op > 0x31:
+                    self.pc = pc + 1
+                    self.call(op)
+                else:
+                    raise VMError(f"expression byte {op:02X} at structural level", pc)
+        finally:
+            self.stats.steps += self.budget - steps
+
+    def _structural_low(self, op: int) -> None:
+        """PTR_LAB_0031e1f8 entries (pc already past the opcode)."""
+        if op in (0x00, 0x05, 0x06):
+            return
+        if op == 0x01:
+            if self.eval() == 0:
+                self._jump()
+            else:
+                self.pc += 4
+        elif op == 0x02:
+            v = self.eval()
+            count = self._u8()
+            self.pc += -self.pc & 3
+            for _ in range(count):
+                key, _target = struct.unpack_from("<Ii", self.buf, self.pc)
+                if key == v:
+                    self.pc += 4
+                    break
+                self.pc += 8
+            self._jump()
+        elif op in (0x03, 0x08, 0x0A):
+            self._jump()
+        else:  # 0x07, 0x09
+            self.pc += 4
+
+    def run_frame(self, main_entry: Optional[int]) -> None:
+        """FUN_0025b778: main scene script, then live slots 0..0x3D."""
+        if main_entry is not None:
+            self.run(main_entry)
+        for i in range(SLOT_RUN):
+            entry = self.slots[i]
+            if entry is not None:
+                self.current_slot = i
+                self.run(entry)
+        self.current_slot = -1
+        # Slot 0x40 is handed to FUN_0025bc68(0) in the build we have, which
+        # returns immediately; it is recorded but not run.
+
+    # -- modelled handlers --------------------------------------------------
+
+    def _handlers(self) -> Dict[int, Callable[[], int]]:
+        h: Dict[int, Callable[[], int]] = {
+            0x33: self._op_dialogue_jump,
+            0x36: self._op_read_work, 0x38: self._op_read_flag_byte,
+            0x37: self._op_alu, 0x39: self._op_alu,
+            0x42: self._op_timed, 0x44: self._op_timed,
+            0x4D: self._op_id_list,
+            0x52: self._op_spawn, 0x58: self._op_select_index, 0x59: self._op_selected_index,
+            0x5A: self._op_select_tag, 0x5C: self._op_destroy,
+            0x76: self._op_reg_read,
+            0x8F: lambda: self.frame_delta,
+            0x9D: self._op_slot_set, 0x9E: self._op_slot_clear, 0x9F: self._op_slot_live,
+            0xA0: self._op_slot_free, 0xA8: self._op_slot_lead,
+            0xA1: self._op_co_set, 0xA2: self._op_co_clear, 0xA3: self._op_co_aux,
+            0xD2: self._op_mem_read, 0xD3: self._op_mem_write,
+            0xE7: lambda: self.short_355064, 0xE8: self._op_set_short,
+        }
+        for op in range(0x3D, 0x41):
+            h[op] = self._op_flag_bit
+        for op in range(0x77, 0x7D):
+            h[op] = self._op_reg_rmw
+        return h
+
+    def _op_dialogue_jump(self) -> int:
+        # FUN_00237b38(ip + 4) starts the dialogue stream, then the jump skips it.
+        self.dialogue_starts.append(self.pc + 4)
+        self._jump()
+        return 0
+
+    def _op_read_work(self) -> int:
+        idx = _s32(self.eval())
+        if not 0 <= idx < WORK_WORDS:
+            raise VMError(f"script work over ({idx})", self.pc)
+        return self.work[idx]
+
+    def _flag_byte_index(self, idx: int) -> int:
+        idx = _s32(idx)
+        if idx > FLAG_MAX_BIT or idx & 7 or idx < 0:
+            raise VMError(f"scenario flag work error ({idx})", self.pc)
+        return idx >> 3
+
+    def _op_read_flag_byte(self) -> int:
+        return self.flags[self._flag_byte_index(self.eval())]
+
+    def _op_alu(self) -> int:
+        op = self.op
+        idx = self.eval()
+        rhs = self.eval()
+        if op == 0x37:
+            i = _s32(idx)
+            if not 0 <= i < WORK_WORDS:
+                raise VMError(f"script work over ({i})", self.pc)
+            cur = self.work[i]
+        else:
+            i = self._flag_byte_index(idx)
+            cur = self.flags[i]
+        sel = self._u8()
+        if sel == 0x25:
+            cur = rhs
+        elif sel == 0x26:
+            cur = cur * rhs
+        elif sel in (0x27, 0x28):
+            if rhs == 0:
+                raise VMError("division by zero", self.pc)
+            f = _cdiv if sel == 0x27 else _cmod
+            cur = f(_s32(cur), _s32(rhs))
+        elif sel == 0x29:
+            cur = cur + rhs
+        elif sel == 0x2A:
+            cur = cur - rhs
+        elif sel == 0x2B:
+            cur = cur & rhs
+        elif sel == 0x2C:
+            cur = cur ^ rhs
+        elif sel == 0x2D:
+            cur = cur | rhs
+        elif sel == 0x2E:
+            cur = cur + 1
+        elif sel == 0x2F:
+            cur = cur - 1
+        else:
+            raise VMError(f"script work error (selector {sel:02X})", self.pc)
+        cur &= MASK
+        if op == 0x37:
+            self.work[i] = cur
+        else:
+            self.flags[i] = cur & 0xFF
+        return cur
+
+    def _op_flag_bit(self) -> int:
+        op = self.op
+        fid = _s32(self.eval())
+        if not 0 <= fid < FLAG_BYTES * 8:
+            raise VMError(f"flag id out of range ({fid})", self.pc)
+        i, bit = fid >> 3, 1 << (fid & 7)
+        prev = int(self.flags[i] & bit != 0)
+        if op == 0x3E:
+            self.flags[i] &= ~bit & 0xFF
+        elif op == 0x3F:
+            self.flags[i] |= bit
+        elif op == 0x40:
+            self.flags[i] ^= bit
+        return prev
+
+    def _op_timed(self) -> int:
+        target = _s32(self.eval()) << 5
+        if self.timer_q5 < target:
+            self.timer_q5 += self.frame_delta
+            return 0
+        return 1
+
+    def _op_id_list(self) -> int:
+        for _ in range(self._u8()):
+            self._u32()
+        return 0
+
+    def _op_spawn(self) -> int:
+        type_id = self.eval()
+        if type_id == 0x55:
+            return 0
+        for i in range(POOL_SPAWN_FIRST, POOL_SIZE):
+            if i not in self.entities:
+                self.entities[i] = Entity(i, type_id)
+                self.selected = i
+                return 1
+        return 0
+
+    def _select(self, selector: int) -> None:
+        # FUN_0025d6c0 / 0x5C: pool index below 0x100, otherwise keep the current one.
+        if selector < POOL_SIZE:
+            self.selected = selector
+
+    def _op_select_index(self) -> int:
+        self._select(self.eval())
+        return 0
+
+    def _op_selected_index(self) -> int:
+        return POOL_SIZE if self.selected is None else self.selected
+
+    def _op_select_tag(self) -> int:
+        tag = self.eval()
+        for i in range(POOL_TAGGED_FIRST, POOL_SIZE):
+            ent = self.entities.get(i)
+            if ent is not None and ent.tag == tag:
+                self.selected = i
+                return 1
+        return 0
+
+    def _op_destroy(self) -> int:
+        idx = self.eval()
+        target = idx if idx < POOL_SIZE else self.selected
+        if target is not None:
+            self.entities.pop(target, None)
+        return 0
+
+    def _regs(self) -> Dict[int, int]:
+        if self.selected is None:
+            return {}
+        ent = self.entities.get(self.selected)
+        if ent is None:
+            ent = self.entities[self.selected] = Entity(self.selected, 0)
+        return ent.regs
+
+    def _op_reg_read(self) -> int:
+        sel = self.eval()
+        var = self.eval()
+        self._select(sel)
+        return self._regs().get(var, 0)
+
+    def _op_reg_rmw(self) -> int:
+        op = self.op
+        sel, var, v = self.eval(), self.eval(), self.eval()
+        self._select(sel)
+        regs = self._regs()
+        cur = regs.get(var, 0)
+        if op == 0x78:
+            v = cur & v
+        elif op == 0x79:
+            v = cur | v
+        elif op == 0x7A:
+            v = cur ^ v
+        elif op == 0x7B:
+            v = (cur + v) & MASK
+        elif op == 0x7C:
+            v = (cur - v) & MASK
+        regs[var] = v
+        return v
+
+    def _op_slot_set(self) -> int:
+        idx = _s32(self.eval())
+        w = self._u32()
+        # (unsigned)index < 0x40: 0x9D can't set the lead slot (0xA8 does).
+        if not 0 <= idx < SLOT_LEAD:
+            raise VMError(f"slot index out of range ({idx})", self.pc)
+        self.slots[idx] = self.code_base + w
+        return 0
+
+    def _op_slot_clear(self) -> int:
+        idx = _s32(self.eval())
+        if idx < 0:
+            idx = self.current_slot
+        if not 0 <= idx <= SLOT_LEAD:
+            raise VMError(f"slot index out of range ({idx})", self.pc)
+        self.slots[idx] = None
+        return 0
+
+    def _op_slot_live(self) -> int:
+        idx = self._u8()
+        if idx >= SLOT_COUNT:
+            raise VMError(f"slot index out of range ({idx})", self.pc)
+        return int(self.slots[idx] is not None)
+
+    def _op_slot_free(self) -> int:
+        for i in range(SLOT_RUN):
+            if self.slots[i] is None:
+                return i
+        return MASK
+
+    def _op_slot_lead(self) -> int:
+        self.slots[SLOT_LEAD] = self.code_base + self._u32()
+        return 0
+
+    def _op_co_set(self) -> int:
+        i = self.eval() & 3
+        self.coroutines[i] = (self.code_base + self._u32(), 0)
+        return 0
+
+    def _op_co_clear(self) -> int:
+        self.coroutines[self.eval() & 3] = (None, 0)
+        return 0
+
+    def _op_co_aux(self) -> int:
+        return self.coroutines[self.eval() & 3][1]
+
+    def _mem_span(self, off: int, length: int) -> int:
+        if not 1 <= length <= 4:
+            raise VMError(f"script memory length {length}", self.pc)
+        addr = self.code_base + _s32(off)
+        if not 0 <= addr <= len(self.buf) - length:
+            raise VMError(f"script memory access 0x{addr:X}", self.pc)
+        return addr
+
+    def _op_mem_read(self) -> int:
+        off = self.eval()
+        length = self._u8()
+        addr = self._mem_span(off, length)
+        return int.from_bytes(self.buf[addr:addr + length], "little")
+
+    def _op_mem_write(self) -> int:
+        off = self.eval()
+        length = self._u8()
+        value = self.eval()
+        addr = self._mem_span(off, length)
+        self.buf[addr:addr + length] = (value & MASK).to_bytes(4, "little")[:length]
+        return 0
+
+    def _op_set_short(self) -> int:
+        self.short_355064 = self.eval() & 0xFFFF
+        return 0
+
+
+# ---------------------------------------------------------------------------
+# Entry discovery
+# ---------------------------------------------------------------------------
+
+def header_main_entry(buf: bytes | bytearray) -> Optional[int]:
+    """FUN_0025b778 runs `base + *(u32 *)(base + 8)` as the main scene script."""
+    if len(buf) < 0x2C:
+        return None
+    (off,) = struct.unpack_from("<I", buf, 8)
+    return off if off < len(buf) else None
+
+
+def block_entries(buf: bytes | bytearray) -> List[int]:
+    """Offsets of 0x32 bytes whose s32 jump lands inside the buffer (candidate block calls)."""
+    out = []
+    n = len(buf)
+    for m in re.finditer(b"\x32", buf):
+        pc = m.start()
+        if pc + 5 > n:
+            break
+        (rel,) = struct.unpack_from("<i", buf, pc + 1)
+        tgt = pc + 1 + rel
+        if rel != 0 and 0 <= tgt < n:
+            out.append(pc)
+    return out
+
+
+# ---------------------------------------------------------------------------
+# CLI
+# ---------------------------------------------------------------------------
+
+def _replay(path: str, entries: List[int], frames: int, budget: int,
+            use_header: bool, use_blocks: bool) -> Tuple[RunStats, Counter, Counter]:
+    with open(path, "rb") as f:
+        data = f.read()
+    starts = list(entries)
+    if use_header:
+        e = header_main_entry(data)
+        if e is not None:
+            starts.append(e)
+    if use_blocks:
+        starts.extend(block_entries(data))
+    total = RunStats()
+    unsupported: Counter = Counter()
+    errors: Counter = Counter()
+    for entry in starts:
+        vm = ScrVM(data, budget=budget)
+        try:
+            vm.run(entry)
+            for _ in range(frames):
+                vm.run_frame(None)
+        except VMUnsupported as ex:
+            unsupported[op_name(ex.op)] += 1
+        except (VMError, IndexError, struct.error) as ex:
+            msg = str(ex).split(" at 0x")[0] if isinstance(ex, VMError) else type(ex).__name__
+            errors[msg] += 1
+        total.runs += vm.stats.runs
+        total.steps += vm.stats.steps
+        total.ops.update(vm.stats.ops)
+    return total, unsupported, errors
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    ap = argparse.ArgumentParser(description="Replay SCR scripts on the host VM and report opcode coverage")
+    ap.add_argument("inputs", nargs="+", help="Decompressed scrN.out files or directories of them")
+    ap.add_argument("--entry", type=lambda s: int(s, 0), action="append", default=[],
+                    help="Structural entry offset (repeatable)")
+    ap.add_argument("--header", action="store_true", help="Also run the header main script (u32 at +8)")
+    ap.add_argument("--blocks", action="store_true", help="Also run every plausible 0x32 block site")
+    ap.add_argument("--frames", type=int, default=0, help="Scheduler frames to run after each entry (slots set via 0x9D)")
+    ap.add_argument("--budget", type=int, default=DEFAULT_BUDGET, help="Structural steps per run")
+    ap.add_argument("--top", type=int, default=20, help="Rows to print per table")
+    args = ap.parse_args(argv)
+
+    paths: List[str] = []
+    for p in args.inputs:
+        if os.path.isdir(p):
+            paths.extend(os.path.join(p, n) for n in sorted(os.listdir(p)) if n.endswith(".out"))
+        else:
+            paths.append(p)
+    if not (args.entry or args.header or args.blocks):
+        args.header = True
+
+    total = RunStats()
+    unsupported: Counter = Counter()
+    errors: Counter = Counter()
+    t0 = time.perf_counter()
+    for p in paths:
+        stats, unsup, errs = _replay(p, args.entry, args.frames, args.budget, args.header, args.blocks)
+        total.runs += stats.runs
+        total.steps += stats.steps
+        total.ops.update(stats.ops)
+        unsupported.update(unsup)
+        errors.update(errs)
+    dt = time.perf_counter() - t0
+
+    rate = total.runs / dt if dt > 0 else 0.0
+    print(f"files={len(paths)} runs={total.runs} steps={total.steps} time={dt:.2f}s ({rate:.0f} runs/s)")
+    known = sum(1 for s in OPERANDS.values() if s is not None)
+    print(f"opcodes hit: {len(total.ops)} / {known} with signatures")
+    for op, n in total.ops.most_common(args.top):
+        print(f"  {op_name(op):>5}  {n}")
+    if unsupported:
+        print("unsupported:")
+        for name, n in unsupported.most_common(args.top):
+            print(f"  {name:>5}  {n}")
+    if errors:
+        print("errors:")
+        for msg, n in errors.most_common(args.top):
+            print(f"  {n:6d}  {msg}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,261 @@
+"""
+SCR cross-reference index (build once, query from an mmap)
+
+One pass over every decompressed scrN.out builds an inverted index of:
+- op        opcode (0x100+N for FF N) -> every site, nested ones included
+- subproc   ID16 -> `0B 04 <id16>` prologue sites (same motif as
+            scan_subproc_tags.py RAW hits)
+- work      work-memory word (iGpffffb0f0[idx]) -> 0x36 readers, 0x37 writers
+- flag      flag bit id -> 0x3D readers, 0x3E/0x3F/0x40 writers
+- flagbyte  flag bit id of a whole bucket byte -> 0x38 readers, 0x39 writers
+- reg       entity register id (FUN_0025c548 / FUN_0025c8f8) -> 0x76
+            readers, 0x77..0x7C writers
+
+Instruction sites come from scr_decode.walk (recursive descent from the
+header main script and subproc prologues), so only reachable, correctly
+aligned opcodes are indexed. They are read from scr_cfg's decoded-script
+cache (`build --cache DIR`), so a rebuild only decodes changed scripts.
+State keys are only known when the index expression is a constant; the
+rest are filed under key DYNAMIC.
+
+File layout (little-endian unless noted):
+    0x00  magic "SXR1", u32 script count, u32 record count,
+          u32 names offset, u32 records offset
+    names    per script: u16 byte length + UTF-8 file name
+    records  16 bytes each, sorted:
+             u8 namespace, u32 key (big-endian, so the first 5 bytes sort
+             as raw bytes), u8 access, u16 script, u32 offset, u16 opcode,
+             u16 reserved
+
+A query is a binary search over the first 5 bytes of each record, done
+directly on the mapping, so nothing is loaded up front.
+"""
+from __future__ import annotations
+
+import argparse
+import mmap
+import os
+import struct
+import sys
+import time
+from dataclasses import dataclass
+from typing import Dict, Iterator, List, Optional, Tuple
+
+from scr_cfg import Program, load_program
+from scr_vm import op_name
+
+MAGIC = b"SXR1"
+HEADER = struct.Struct("<4sIIII")
+REC_SIZE = 16
+DYNAMIC = 0xFFFFFFFF
+
+NAMESPACES = ("op", "subproc", "work", "flag", "flagbyte", "reg")
+NS = {name: i for i, name in enumerate(NAMESPACES)}
+ACCESS = ("site", "read", "write", "rmw")
+SITE, READ, WRITE, RMW = range(4)
+
+# opcode -> (namespace, operand index holding the key, access)
+_STATE_OPS: Dict[int, Tuple[int, int, int]] = {
+    0x36: (NS["work"], 0, READ), 0x37: (NS["work"], 0, WRITE),
+    0x38: (NS["flagbyte"], 0, READ), 0x39: (NS["flagbyte"], 0, WRITE),
+    0x3D: (NS["flag"], 0, READ), 0x3E: (NS["flag"], 0, WRITE),
+    0x3F: (NS["flag"], 0, WRITE), 0x40: (NS["flag"], 0, RMW),
+    0x76: (NS["reg"], 1, READ), 0x77: (NS["reg"], 1, WRITE),
+}
+for _op in range(0x78, 0x7D):
+    _STATE_OPS[_op] = (NS["reg"], 1, RMW)
+
+
+def _pack(ns: int, key: int, access: int, script: int, off: int, op: int) -> bytes:
+    # Big-endian namespace+key prefix keeps byte order == sort order.
+    return struct.pack(">BI", ns, key) + struct.pack("<BHIHH", access, script, off, op, 0)
+
+
+@dataclass
+class Ref:
+    namespace: str
+    key: int
+    access: str
+    script: str
+    off: int
+    op: int
+
+    def __str__(self) -> str:
+        key = "dyn" if self.key == DYNAMIC else str(self.key)
+        return (f"{self.script}:{self.off:08x}  {op_name(self.op):>5}  "
+                f"{self.namespace}[{key}] {self.access}")
+
+
+# ---------------------------------------------------------------------------
+# Build
+# ---------------------------------------------------------------------------
+
+def index_script(prog: Program, script: int) -> List[bytes]:
+    """Records for one decoded script (scr_cfg.Program)."""
+    recs: List[bytes] = []
+    for off, id16 in zip(prog.sp_off, prog.sp_id):
+        recs.append(_pack(NS["subproc"], id16, SITE, script, off, 0x04))
+    for off, _end, op, args in prog.all_sites():
+        recs.append(_pack(NS["op"], op, SITE, script, off, op))
+        state = _STATE_OPS.get(op)
+        if state is None:
+            continue
+        ns, argi, access = state
+        key = args[argi]
+        if op == 0x37 or op == 0x39:
+            access = WRITE if args[2] == 0x25 else RMW
+        recs.append(_pack(ns, DYNAMIC if key is None else key, access,
+                          script, off, op))
+    return recs
+
+
+def build(paths: List[str], out_path: str, cache_dir: Optional[str] = None) -> Tuple[int, int]:
+    """Index `paths`; decoded scripts come from (and go to) the scr_cfg
+    cache in `cache_dir` when given."""
+    names: List[str] = []
+    recs: List[bytes] = []
+    errors = 0
+    for i, p in enumerate(paths):
+        prog = load_program(p, cache_dir)
+        recs.extend(index_script(prog, i))
+        errors += len(prog.err_off)
+        names.append(os.path.basename(p))
+    recs.sort()
+
+    name_blob = b"".join(struct.pack("<H", len(n.encode())) + n.encode() for n in names)
+    names_off = HEADER.size
+    recs_off = (names_off + len(name_blob) + 15) & ~15
+    tmp = out_path + ".tmp"
+    with open(tmp, "wb") as f:
+        f.write(HEADER.pack(MAGIC, len(names), len(recs), names_off, recs_off))
+        f.write(name_blob)
+        f.write(bytes(recs_off - names_off - len(name_blob)))
+        f.write(b"".join(recs))
+    os.replace(tmp, out_path)
+    return len(recs), errors
+
+
+# ---------------------------------------------------------------------------
+# Query
+# ---------------------------------------------------------------------------
+
+class XrefIndex:
+    def __init__(self, path: str):
+        with open(path, "rb") as f:
+            self._mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, nscripts, self.count, names_off, self._recs = HEADER.unpack_from(self._mm, 0)
+        if magic != MAGIC:
+            raise ValueError(f"{path}: not an SCR xref index")
+        self.scripts: List[str] = []
+        p = names_off
+        for _ in range(nscripts):
+            (n,) = struct.unpack_from("<H", self._mm, p)
+            self.scripts.append(self._mm[p + 2:p + 2 + n].decode())
+            p += 2 + n
+
+    def _prefix(self, i: int) -> bytes:
+        o = self._recs + i * REC_SIZE
+        return self._mm[o:o + 5]
+
+    def _bound(self, prefix: bytes) -> int:
+        lo, hi = 0, self.count
+        while lo < hi:
+            mid = (lo + hi) // 2
+            if self._prefix(mid) < prefix:
+                lo = mid + 1
+            else:
+                hi = mid
+        return lo
+
+    def lookup(self, namespace: str, key: int) -> Iterator[Ref]:
+        ns = NS[namespace]
+        prefix = struct.pack(">BI", ns, key)
+        i = self._bound(prefix)
+        while i < self.count and self._prefix(i) == prefix:
+            o = self._recs + i * REC_SIZE
+            access, script, off, op, _ = struct.unpack_from("<BHIHH", self._mm, o + 5)
+            yield Ref(namespace, key, ACCESS[access], self.scripts[script], off, op)
+            i += 1
+
+    def writers(self, namespace: str, key: int) -> List[Ref]:
+        return [r for r in self.lookup(namespace, key) if r.access in ("write", "rmw")]
+
+    def readers(self, namespace: str, key: int) -> List[Ref]:
+        return [r for r in self.lookup(namespace, key) if r.access in ("read", "rmw")]
+
+    def flag_refs(self, flag: int) -> List[Ref]:
+        """Bit-level references plus whole-byte 0x38/0x39 access to its bucket."""
+        return list(self.lookup("flag", flag)) + list(self.lookup("flagbyte", flag & ~7))
+
+
+# ---------------------------------------------------------------------------
+# CLI
+# ---------------------------------------------------------------------------
+
+def _inputs(items: List[str]) -> List[str]:
+    out: List[str] = []
+    for p in items:
+        if os.path.isdir(p):
+            out.extend(os.path.join(p, n) for n in sorted(os.listdir(p), key=lambda n: (len(n), n))
+                       if n.endswith(".out"))
+        else:
+            out.append(p)
+    return out
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    ap = argparse.ArgumentParser(description="Build or query the SCR cross-reference index")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    b = sub.add_parser("build", help="Index scrN.out files (or directories of them)")
+    b.add_argument("inputs", nargs="+")
+    b.add_argument("-o", "--out", default="scr.xref")
+    b.add_argument("--cache", default=None, help="scr_cfg cache directory for decoded scripts")
+    q = sub.add_parser("query", help="Look up references")
+    q.add_argument("index")
+    num = lambda s: int(s, 0)
+    q.add_argument("--op", type=num, help="Opcode (0x100+N for FF N)")
+    q.add_argument("--subproc", type=num, help="SUBPROC ID16")
+    q.add_argument("--work", type=num, help="Work-memory index")
+    q.add_argument("--flag", type=num, help="Flag bit id (includes 0x38/0x39 bucket access)")
+    q.add_argument("--reg", type=num, help="Entity register id")
+    q.add_argument("--dynamic", choices=("work", "flag", "flagbyte", "reg"),
+                   help="List accesses whose index is computed at runtime")
+    q.add_argument("--writers", action="store_true", help="Only writes (incl. read-modify-write)")
+    q.add_argument("--readers", action="store_true", help="Only reads (incl. read-modify-write)")
+    args = ap.parse_args(argv)
+
+    if args.cmd == "build":
+        paths = _inputs(args.inputs)
+        t0 = time.perf_counter()
+        n, errors = build(paths, args.out, args.cache)
+        print(f"{args.out}: {len(paths)} scripts, {n} records, {errors} decode stops, "
+              f"{time.perf_counter() - t0:.2f}s")
+        return 0
+
+    idx = XrefIndex(args.index)
+    t0 = time.perf_counter()
+    if args.flag is not None:
+        refs = idx.flag_refs(args.flag)
+    elif args.dynamic:
+        refs = list(idx.lookup(args.dynamic, DYNAMIC))
+    else:
+        for ns in ("op", "subproc", "work", "reg"):
+            key = getattr(args, ns)
+            if key is not None:
+                refs = list(idx.lookup(ns, key))
+                break
+        else:
+            raise SystemExit("Provide one of --op/--subproc/--work/--flag/--reg/--dynamic")
+    dt = time.perf_counter() - t0
+    if args.writers:
+        refs = [r for r in refs if r.access in ("write", "rmw")]
+    if args.readers:
+        refs = [r for r in refs if r.access in ("read", "rmw")]
+    for r in refs:
+        print(r)
+    print(f"{len(refs)} refs ({dt * 1e6:.0f} us)", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
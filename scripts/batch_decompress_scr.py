@@ -11,23 +11,28 @@ Usage:
   python scripts/batch_decompress_scr.py            # decode any missing .out files
   python scripts/batch_decompress_scr.py --force    # re-decode all
 
-Relies on the implementation in `orphen_lz_headerless_decoder.py`.
+Uses the block-level decoder in `tools/resource_extract/v2/lz.py` when the
+repo root is importable, falling back to `orphen_lz_headerless_decoder.py`
+(same output, byte-at-a-time).
 """
 
 from __future__ import annotations
 
 import argparse
-import io
 import sys
 from pathlib import Path
 
-from orphen_lz_headerless_decoder import decode_stream  # type: ignore
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent))
+try:
+    from tools.resource_extract.v2.lz import decode_bytes  # type: ignore
+except ImportError:
+    from orphen_lz_headerless_decoder import decode_bytes  # type: ignore
 
 
 def decompress_file(src_path: Path, dst_path: Path) -> None:
-    with src_path.open('rb') as f_in, dst_path.open('wb') as f_out:
-        data = f_in.read()
-        decode_stream(io.BytesIO(data), f_out, decompressed_size=None, multi=False)
+    data = src_path.read_bytes()
+    out = decode_bytes(data, decompressed_size=None, multi=False)
+    dst_path.write_bytes(out)
 
 
 def main(argv: list[str]) -> int:
@@ -1,71 +1,43 @@
 #!/usr/bin/env python3
 """
-Find a byte sequence in files and directories.
+Find byte sequences in files and directories.
 
 Usage:
   python scripts/find_bytes.py --hex "20 2f 50 53 43 33 1d 00 db 00 d4 af 01 00 ec c8 01 00 44 00" --paths FILE_OR_DIR ...
+  python scripts/find_bytes.py --hex PSM2 --hex "0B 04 ?? ??" --jobs 0 --paths FILE_OR_DIR ...
 
-Outputs JSON lines with: {"path": str, "offset": int}
+`--hex` may repeat and accepts `??` / nibble `?` wildcards and the names in
+tools/resource_extract/v2/bytescan.MAGICS; all patterns are found in one
+pass per file (see bytescan.py).
+
+Outputs JSON lines with: {"path": str, "offset": int, "pattern": str}
 """
 from __future__ import annotations
 import argparse
-import binascii
 import json
-import mmap
-import os
 import sys
-from typing import Iterable, Iterator, List
-
-
-def parse_hex_bytes(s: str) -> bytes:
-    s = s.strip().replace(" ", "").replace("_", "").replace("-", "")
-    if len(s) % 2 != 0:
-        raise ValueError("hex string must have even length (spaces are allowed)")
-    return binascii.unhexlify(s)
+from pathlib import Path
 
-
-def iter_files(paths: List[str]) -> Iterator[str]:
-    for p in paths:
-        if not os.path.exists(p):
-            continue
-        if os.path.isfile(p):
-            yield p
-        else:
-            for root, _dirs, files in os.walk(p):
-                for f in files:
-                    yield os.path.join(root, f)
-
-
-def find_in_file(path: str, needle: bytes) -> Iterator[int]:
-    try:
-        with open(path, "rb") as f:
-            with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mm:
-                start = 0
-                while True:
-                    idx = mm.find(needle, start)
-                    if idx == -1:
-                        break
-                    yield idx
-                    start = idx + 1
-    except (OSError, ValueError):
-        # Skip unreadable or special files
-        return
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent))
+from tools.resource_extract.v2.bytescan import scan_paths  # noqa: E402
 
 
 def main() -> None:
-    ap = argparse.ArgumentParser(description="Find a hex byte sequence in files")
-    ap.add_argument("--hex", required=True, help="hex bytes, spaces allowed")
+    ap = argparse.ArgumentParser(description="Find hex byte patterns in files")
+    ap.add_argument("--hex", action="append", required=True,
+                    help="hex bytes, spaces and ?? wildcards allowed (repeatable)")
     ap.add_argument("--paths", nargs="+", required=True, help="files/directories to scan")
+    ap.add_argument("--jobs", type=int, default=1, help="worker processes (0 = all cores)")
     args = ap.parse_args()
 
-    needle = parse_hex_bytes(args.hex)
     any_found = False
-
-    for path in iter_files(args.paths):
-        for off in find_in_file(path, needle):
+    try:
+        for path, off, name in scan_paths(args.paths, args.hex, jobs=args.jobs):
             any_found = True
-            print(json.dumps({"path": path, "offset": off}))
+            print(json.dumps({"path": path, "offset": off, "pattern": name}))
             sys.stdout.flush()
+    except ValueError as e:
+        ap.error(str(e))
 
     if not any_found:
         # Non-zero exit indicates no matches (useful for scripts)
@@ -32,17 +32,46 @@ Packed register types (FLG=0):
     0x0=PRIM 0x1=RGBAQ 0x2=ST 0x3=UV 0x4=XYZF2 0x5=XYZ2
     0x6=TEX0_1 0x7=TEX0_2 0x8=CLAMP_1 0x9=CLAMP_2 0xA=FOG
     0xC=XYZF3 0xD=XYZ3 0xE=A+D 0xF=NOP
+
+Streaming / parallel decode:
+    The dump is read through a fixed-size buffer (zstd frames are decoded
+    as they are consumed, by the `zstandard` module or else the `zstd`
+    CLI), so memory no longer scales with the dump. Transfers are grouped
+    into batches cut at VSync packets and each batch is parsed on its own,
+    optionally over a process pool (`--jobs`).
+
+    A batch does not know the GS state left by the batches before it, so
+    it starts from placeholders: a vertex that latches a register the
+    batch has not written yet gets a fixup, and a draw whose split
+    decision compared against a placeholder is flagged. `extract_drawcalls`
+    merges batches in dump order, resolving both against the state the
+    previous batches ended with, so the draws come out exactly as a
+    sequential walk produces them.
+
+    Draw calls hold their vertices as typed columns (DrawCall.x/.y/.z,
+    .s/.t/.q, .u/.v, .rgba). A PACKED GIFTAG whose registers only latch
+    vertex state (no PRIM / TEX0 / A+D) is decoded as a whole: each
+    register slot's values are strided slices of the block viewed as
+    u16/u32/f32 arrays, and the latch order inside the loop decides
+    whether a kick sees the current or the previous loop's value.
 """
 
 from __future__ import annotations
-import struct, sys
+import contextlib, os, struct, subprocess, sys
+from array import array
+from collections import deque
+from concurrent.futures import ProcessPoolExecutor
 from dataclasses import dataclass, field
 from pathlib import Path
-from typing import List, Optional, Tuple
+from typing import BinaryIO, Dict, Iterator, List, Tuple
 
 
 GS_PRIV_REG_SIZE = 0x2000  # GSPrivRegSet size; standard 8KB priv reg block
 
+# Dump bytes read per refill, and transfer bytes per parse batch.
+READ_CHUNK = 1 << 22
+BATCH_BYTES = 1 << 22
+
 
 # Packed register types
 REG_PRIM    = 0x0
@@ -72,6 +101,22 @@ ADDR_PRMODE = 0x1A
 ADDR_TEX1_1 = 0x14
 ADDR_TEX1_2 = 0x15
 
+# Packed registers that change draw state; any of them in a GIFTAG sends
+# it down the per-register path.
+_STATEFUL_REGS = frozenset((REG_PRIM, REG_TEX0_1, REG_TEX0_2, REG_AD))
+_KICK_REGS = frozenset((REG_XYZF2, REG_XYZ2))
+
+# GS state carried between transfers, with the value a fresh dump starts at.
+STATE_DEFAULTS = {
+    'prim': 0, 'fst': False,
+    'tex0_1': 0, 'tex0_2': 0, 'tex1_1': 0, 'tex1_2': 0,
+    's': 0.0, 't': 0.0, 'q': 1.0, 'u': 0, 'v': 0, 'rgba': 0,
+}
+# Vertex columns: typecode, and the state key each latched column reads.
+_COLUMNS = {'x': 'H', 'y': 'H', 'z': 'I', 's': 'f', 't': 'f', 'q': 'f',
+            'u': 'H', 'v': 'H', 'rgba': 'I'}
+_LATCHED = ('s', 't', 'q', 'u', 'v', 'rgba')
+
 
 @dataclass
 class Vertex:
@@ -89,16 +134,43 @@ class Vertex:
     rgba: int = 0
 
 
+def _new_columns() -> Dict[str, array]:
+    return {k: array(tc) for k, tc in _COLUMNS.items()}
+
+
 @dataclass
 class DrawCall:
-    """One coherent batch of vertices with a single PRIM/TEX0 state."""
+    """One coherent batch of vertices with a single PRIM/TEX0 state.
+
+    Vertices are stored column-wise, one typed array per field."""
     prim: int = 0
     fst: bool = False  # PRIM.FST: 0 = use ST/Q, 1 = use UV
     tex0_1: int = 0
     tex0_2: int = 0
     tex1_1: int = 0
     tex1_2: int = 0
-    vertices: List[Vertex] = field(default_factory=list)
+    cols: Dict[str, array] = field(default_factory=_new_columns)
+
+    def __getattr__(self, name: str) -> array:
+        cols = self.__dict__.get('cols')
+        if cols is not None and name in cols:
+            return cols[name]
+        raise AttributeError(name)
+
+    @property
+    def count(self) -> int:
+        return len(self.cols['x'])
+
+    def vertex(self, i: int) -> Vertex:
+        return Vertex(**{k: c[i] for k, c in self.cols.items()})
+
+    @property
+    def vertices(self) -> List[Vertex]:
+        return [self.vertex(i) for i in range(self.count)]
+
+    def extend(self, other: 'DrawCall') -> None:
+        for k, c in self.cols.items():
+            c.extend(other.cols[k])
 
     @property
     def prim_type(self) -> int:
@@ -110,68 +182,175 @@ class DrawCall:
         return names[self.prim_type]
 
 
-def _decompress_zst(path: Path) -> bytes:
-    import zstandard
-    dctx = zstandard.ZstdDecompressor()
-    with open(path, 'rb') as f:
-        with dctx.stream_reader(f) as rdr:
-            return rdr.read()
-
-
-def parse_dump(path: Path) -> Tuple[bytes, List[bytes]]:
-    """Return (state_bytes, [transfer_data, ...]) — the initial GS state
-    blob and every Transfer packet's payload, in dump order."""
-    if path.suffix == '.zst':
-        raw = _decompress_zst(path)
-    else:
-        raw = path.read_bytes()
-    p = 0
-    magic = struct.unpack_from('<I', raw, p)[0]
+# ---------------------------------------------------------------------------
+# Streaming dump reader
+# ---------------------------------------------------------------------------
+
+@contextlib.contextmanager
+def _open_dump(path: Path) -> Iterator[BinaryIO]:
+    """Binary stream of the (decompressed) dump. `.zst` files are decoded
+    incrementally with `zstandard` if installed, else via `zstd -dc`."""
+    if path.suffix != '.zst':
+        with open(path, 'rb') as f:
+            yield f
+        return
+    try:
+        import zstandard
+    except ImportError:
+        zstandard = None
+    if zstandard is not None:
+        with open(path, 'rb') as f:
+            with zstandard.ZstdDecompressor().stream_reader(f) as rdr:
+                yield rdr
+        return
+    try:
+        proc = subprocess.Popen(['zstd', '-dcq', str(path)], stdout=subprocess.PIPE)
+    except OSError:
+        raise SystemExit(f"{path}: install the 'zstandard' module or the zstd CLI "
+                         f"to read .zst dumps") from None
+    try:
+        yield proc.stdout
+    finally:
+        proc.stdout.close()
+        proc.wait()
+
+
+class _Reader:
+    """Sequential reads over a stream through one refilled buffer."""
+
+    def __init__(self, f: BinaryIO):
+        self.f = f
+        self.buf = b''
+        self.pos = 0
+        self.offset = 0  # stream offset of buf[0]
+
+    def _fill(self, n: int) -> bool:
+        if len(self.buf) - self.pos >= n:
+            return True
+        parts = [self.buf[self.pos:]]
+        have = len(parts[0])
+        self.offset += self.pos
+        while have < n:
+            chunk = self.f.read(max(READ_CHUNK, n - have))
+            if not chunk:
+                break
+            parts.append(chunk)
+            have += len(chunk)
+        self.buf = b''.join(parts)
+        self.pos = 0
+        return have >= n
+
+    def tell(self) -> int:
+        return self.offset + self.pos
+
+    def at_eof(self) -> bool:
+        return not self._fill(1)
+
+    def read(self, n: int) -> bytes:
+        self._fill(n)
+        out = self.buf[self.pos:self.pos + n]
+        self.pos += len(out)
+        return out
+
+    def skip(self, n: int) -> None:
+        avail = len(self.buf) - self.pos
+        if n <= avail:
+            self.pos += n
+            return
+        self.offset += len(self.buf) + (n - avail)
+        self.buf, self.pos = b'', 0
+        n -= avail
+        while n > 0:
+            chunk = self.f.read(min(n, READ_CHUNK))
+            if not chunk:
+                break
+            n -= len(chunk)
+
+    def u8(self) -> int:
+        b = self.read(1)
+        if not b:
+            raise EOFError
+        return b[0]
+
+    def u32(self) -> int:
+        b = self.read(4)
+        if len(b) < 4:
+            raise EOFError
+        return struct.unpack('<I', b)[0]
+
+
+def _read_header(rdr: _Reader) -> bytes:
+    """Consume the dump header; returns the initial GS state blob."""
+    magic = rdr.u32()
     if magic != 0xFFFFFFFF:
         raise ValueError(f"unexpected magic {magic:#x} (old format unsupported)")
-    p += 4
-    header_size = struct.unpack_from('<I', raw, p)[0]
-    p += 4
+    header_size = rdr.u32()
     # GSDumpHeader (9 u32)
     state_version, state_size, serial_offset, serial_size, crc, \
-        sw, sh, ss_off, ss_size = struct.unpack_from('<9I', raw, p)
-    p += 36
-    serial = raw[p:p + serial_size].decode('ascii', errors='replace')
-    p += serial_size
+        sw, sh, ss_off, ss_size = struct.unpack('<9I', rdr.read(36))
+    serial = rdr.read(serial_size).decode('ascii', errors='replace')
     # screenshot pixels follow (RGBA u32 per pixel)
-    p += ss_size
-    # state
-    state = raw[p:p + state_size]
-    p += state_size
+    rdr.skip(ss_size)
+    state = rdr.read(state_size)
     # GSPrivRegSet
-    p += GS_PRIV_REG_SIZE
+    rdr.skip(GS_PRIV_REG_SIZE)
 
     print(f"[gs] serial={serial} crc={crc:08x} state_size={state_size}", file=sys.stderr)
-    print(f"[gs] screenshot {sw}x{sh}, packets start at offset {p:#x}", file=sys.stderr)
+    print(f"[gs] screenshot {sw}x{sh}, packets start at offset {rdr.tell():#x}", file=sys.stderr)
+    return state
 
-    transfers: List[bytes] = []
-    n_vsync = 0
-    while p < len(raw):
-        t = raw[p]
-        p += 1
+
+def _iter_packets(rdr: _Reader) -> Iterator[Tuple[int, bytes]]:
+    """(type, transfer payload or b'') per packet, in dump order."""
+    while not rdr.at_eof():
+        t = rdr.u8()
         if t == 0:  # Transfer
-            path_id = raw[p]
-            p += 1
-            size = struct.unpack_from('<I', raw, p)[0]
-            p += 4
-            transfers.append(raw[p:p + size])
-            p += size
+            rdr.u8()  # path
+            size = rdr.u32()
+            yield 0, rdr.read(size)
         elif t == 1:  # VSync
-            p += 1  # field
-            n_vsync += 1
+            rdr.skip(1)  # field
+            yield 1, b''
         elif t == 2:  # ReadFIFO
-            p += 4
+            rdr.skip(4)
         elif t == 3:  # Registers
-            p += GS_PRIV_REG_SIZE
+            rdr.skip(GS_PRIV_REG_SIZE)
         else:
-            raise ValueError(f"unknown packet type {t} at offset {p-1:#x}")
+            raise ValueError(f"unknown packet type {t} at offset {rdr.tell()-1:#x}")
+
+
+def iter_batches(path: Path, batch_bytes: int = BATCH_BYTES) -> Iterator[List[bytes]]:
+    """Transfer payloads in dump order, grouped into lists of at least
+    `batch_bytes` (the last one may be smaller), cut at VSync packets."""
+    with _open_dump(path) as f:
+        rdr = _Reader(f)
+        _read_header(rdr)
+        batch: List[bytes] = []
+        size = n_transfers = n_vsync = 0
+        for t, data in _iter_packets(rdr):
+            if t == 0:
+                batch.append(data)
+                size += len(data)
+                n_transfers += 1
+            else:
+                n_vsync += 1
+                if size >= batch_bytes:
+                    yield batch
+                    batch, size = [], 0
+        if batch:
+            yield batch
+    print(f"[gs] {n_transfers} transfers, {n_vsync} vsyncs", file=sys.stderr)
+
 
-    print(f"[gs] {len(transfers)} transfers, {n_vsync} vsyncs", file=sys.stderr)
+def parse_dump(path: Path) -> Tuple[bytes, List[bytes]]:
+    """Return (state_bytes, [transfer_data, ...]) — the initial GS state
+    blob and every Transfer packet's payload, in dump order. This holds
+    the whole packet stream in memory; `extract_drawcalls` streams."""
+    with _open_dump(path) as f:
+        rdr = _Reader(f)
+        state = _read_header(rdr)
+        transfers = [data for t, data in _iter_packets(rdr) if t == 0]
+    print(f"[gs] {len(transfers)} transfers", file=sys.stderr)
     return state, transfers
 
 
@@ -189,158 +368,345 @@ def parse_giftag(qw0: int, qw1: int) -> Tuple[int, bool, int, int, int, List[int
     return nloop, bool(eop), prim if pre else -1, flg, nreg, regs
 
 
-def _extract_vertex_writes(
-    transfer: bytes,
-    state: dict,
-    draws: List[DrawCall],
-    cur: Optional[DrawCall],
-) -> Optional[DrawCall]:
-    """Walk one transfer's GIF stream, accumulating vertex writes into
-    DrawCall objects. ``state`` carries inter-transfer GS state."""
-    p = 0
-    n = len(transfer)
-    while p + 16 <= n:
-        qw0 = struct.unpack_from('<Q', transfer, p)[0]
-        qw1 = struct.unpack_from('<Q', transfer, p + 8)[0]
-        p += 16
-        nloop, eop, prim, flg, nreg, regs = parse_giftag(qw0, qw1)
-
-        if prim >= 0:
-            state['prim'] = prim
-            state['fst'] = bool((prim >> 8) & 1)
-
-        if flg == 0:  # PACKED
-            payload_qw = nloop * nreg
-            for li in range(nloop):
-                # Track partial vertex
-                v = Vertex()
-                v_set = False
-                for ri in range(nreg):
-                    if p + 16 > n:
-                        return cur
-                    lo = struct.unpack_from('<Q', transfer, p)[0]
-                    hi = struct.unpack_from('<Q', transfer, p + 8)[0]
-                    p += 16
-                    r = regs[ri]
-                    if r == REG_PRIM:
-                        state['prim'] = lo & 0x7FF
-                        state['fst'] = bool((lo >> 8) & 1)
-                    elif r == REG_RGBAQ:
-                        # packed: R[0..7], G[32..39], B[64..71], A[96..103]
-                        # Note: PACKED RGBAQ does NOT carry Q in its data;
-                        # RGBAQ.Q is set from the latched ST.Q from the
-                        # most recent packed ST write — which we already
-                        # placed in state['q'].
-                        r_ = lo & 0xFF
-                        g_ = (lo >> 32) & 0xFF
-                        b_ = hi & 0xFF
-                        a_ = (hi >> 32) & 0xFF
-                        state['rgba'] = r_ | (g_ << 8) | (b_ << 16) | (a_ << 24)
-                    elif r == REG_ST:
-                        s_bits = lo & 0xFFFFFFFF
-                        t_bits = (lo >> 32) & 0xFFFFFFFF
-                        q_bits = hi & 0xFFFFFFFF
-                        state['s'] = struct.unpack('<f', struct.pack('<I', s_bits))[0]
-                        state['t'] = struct.unpack('<f', struct.pack('<I', t_bits))[0]
-                        # ST also primes Q
-                        state['q'] = struct.unpack('<f', struct.pack('<I', q_bits))[0]
-                    elif r == REG_UV:
-                        state['u'] = lo & 0x3FFF
-                        state['v'] = (lo >> 16) & 0x3FFF
-                    elif r in (REG_XYZF2, REG_XYZF3, REG_XYZ2, REG_XYZ3):
-                        # packed XYZF: X[0..15], Y[32..47], Z[64..87], F[100..107] (XYZF only)
-                        v.x = lo & 0xFFFF
-                        v.y = (lo >> 32) & 0xFFFF
-                        v.z = hi & 0xFFFFFF
-                        v.s = state.get('s', 0.0)
-                        v.t = state.get('t', 0.0)
-                        v.q = state.get('q', 1.0)
-                        v.u = state.get('u', 0)
-                        v.v = state.get('v', 0)
-                        v.rgba = state.get('rgba', 0)
-                        # Determine kick: XYZ2/XYZF2 kick, XYZ3/XYZF3 don't (no draw)
-                        is_kick = r in (REG_XYZF2, REG_XYZ2)
-                        if is_kick:
-                            if cur is None or cur.prim != state.get('prim', 0):
-                                cur = DrawCall(
-                                    prim=state.get('prim', 0),
-                                    fst=state.get('fst', False),
-                                    tex0_1=state.get('tex0_1', 0),
-                                    tex0_2=state.get('tex0_2', 0),
-                                    tex1_1=state.get('tex1_1', 0),
-                                    tex1_2=state.get('tex1_2', 0),
-                                )
-                                draws.append(cur)
-                            cur.vertices.append(v)
-                            v_set = True
-                    elif r == REG_TEX0_1:
-                        state['tex0_1'] = lo
-                        cur = None  # state changed → flush draw grouping
-                    elif r == REG_TEX0_2:
-                        state['tex0_2'] = lo
-                        cur = None
-                    elif r == REG_AD:
-                        addr = hi & 0xFF
-                        if addr == ADDR_PRIM:
-                            state['prim'] = lo & 0x7FF
-                            state['fst'] = bool((lo >> 8) & 1)
-                        elif addr == ADDR_TEX0_1:
-                            state['tex0_1'] = lo
-                            cur = None
-                        elif addr == ADDR_TEX0_2:
-                            state['tex0_2'] = lo
-                            cur = None
-                        elif addr == ADDR_TEX1_1:
-                            state['tex1_1'] = lo
-                            cur = None
-                        elif addr == ADDR_TEX1_2:
-                            state['tex1_2'] = lo
-                            cur = None
-                        elif addr == ADDR_ST:
-                            state['s'] = struct.unpack('<f', struct.pack('<Q', lo)[:4])[0]
-                            state['t'] = struct.unpack('<f', struct.pack('<Q', lo)[4:])[0]
-                        elif addr == ADDR_UV:
-                            state['u'] = lo & 0x3FFF
-                            state['v'] = (lo >> 16) & 0x3FFF
-                        elif addr == ADDR_XYZ2 or addr == ADDR_XYZF2:
-                            v.x = lo & 0xFFFF
-                            v.y = (lo >> 16) & 0xFFFF
-                            v.z = (lo >> 32) & 0xFFFFFFFF
-                            v.s = state.get('s', 0.0)
-                            v.t = state.get('t', 0.0)
-                            v.q = state.get('q', 1.0)
-                            v.u = state.get('u', 0)
-                            v.v = state.get('v', 0)
-                            v.rgba = state.get('rgba', 0)
-                            if cur is None or cur.prim != state.get('prim', 0):
-                                cur = DrawCall(
-                                    prim=state.get('prim', 0),
-                                    fst=state.get('fst', False),
-                                    tex0_1=state.get('tex0_1', 0),
-                                )
-                                draws.append(cur)
-                            cur.vertices.append(v)
-        elif flg == 1:  # REGLIST: NLOOP*NREG 64-bit values, padded to QW
-            count = nloop * nreg
-            qw_count = (count + 1) // 2
-            p += qw_count * 16
-        else:  # IMAGE (FLG=2/3): NLOOP * 16 raw bytes
-            p += nloop * 16
-
-        if eop:
-            # End of packet — but data may still follow (next GIFTAG)
-            pass
-    return cur
-
-
-def extract_drawcalls(path: Path) -> List[DrawCall]:
-    state, transfers = parse_dump(path)
-    draws: List[DrawCall] = []
-    cur: Optional[DrawCall] = None
-    gs_state: dict = {}
-    for ti, t in enumerate(transfers):
-        cur = _extract_vertex_writes(t, gs_state, draws, cur)
-    return draws
+# ---------------------------------------------------------------------------
+# Batch parser
+# ---------------------------------------------------------------------------
+
+class _Inherit:
+    """Placeholder for a state register a batch reads before writing."""
+    __slots__ = ('key',)
+
+    def __init__(self, key: str):
+        self.key = key
+
+
+# `cur` at the start of a batch: whatever draw the previous batch left open.
+_CARRY = object()
+
+
+@dataclass
+class BatchResult:
+    draws: List[DrawCall]
+    fixups: List[Tuple[int, str, int, int]]   # (draw, column, start, stop)
+    flags: Dict[int, str]                     # draw -> 'carry' | 'maybe'
+    written: dict                             # state registers set in the batch
+    end: str                                  # cur at the end: carry/none/open
+
+
+class _BatchParser:
+    def __init__(self):
+        self.state = {k: _Inherit(k) for k in STATE_DEFAULTS}
+        self.draws: List[DrawCall] = []
+        self.fixups: List[Tuple[int, str, int, int]] = []
+        self.flags: Dict[int, str] = {}
+        self.cur = _CARRY
+
+    # -- draws ---------------------------------------------------------------
+
+    def _draw(self, full: bool = True) -> DrawCall:
+        """The draw a kick lands in, opening a new one when PRIM changed.
+
+        A draw opened against the previous batch's draw ('carry') or by
+        comparing with a PRIM the batch has not seen yet ('maybe') may
+        turn out to continue the draw before it; the merge decides."""
+        st = self.state
+        cur, prim = self.cur, st['prim']
+        flag = None
+        if cur is _CARRY:
+            flag = 'carry'
+        elif cur is not None:
+            if cur.prim is prim:
+                return cur
+            if isinstance(cur.prim, _Inherit) or isinstance(prim, _Inherit):
+                flag = 'maybe'
+            elif cur.prim == prim:
+                return cur
+        if full:
+            d = DrawCall(prim=prim, fst=st['fst'], tex0_1=st['tex0_1'], tex0_2=st['tex0_2'],
+                         tex1_1=st['tex1_1'], tex1_2=st['tex1_2'])
+        else:
+            d = DrawCall(prim=prim, fst=st['fst'], tex0_1=st['tex0_1'])
+        if flag:
+            self.flags[len(self.draws)] = flag
+        self.draws.append(d)
+        self.cur = d
+        return d
+
+    def _latch(self, d: DrawCall, key: str, value) -> None:
+        col = d.cols[key]
+        if isinstance(value, _Inherit):
+            self.fixups.append((len(self.draws) - 1, key, len(col), len(col) + 1))
+            value = 0
+        col.append(value)
+
+    def _kick(self, x: int, y: int, z: int, full: bool = True) -> None:
+        d = self._draw(full)
+        c = d.cols
+        c['x'].append(x)
+        c['y'].append(y)
+        c['z'].append(z)
+        for key in _LATCHED:
+            self._latch(d, key, self.state[key])
+
+    # -- GIF stream ----------------------------------------------------------
+
+    def transfer(self, data: bytes) -> None:
+        p = 0
+        n = len(data)
+        while p + 16 <= n:
+            qw0, qw1 = struct.unpack_from('<QQ', data, p)
+            p += 16
+            nloop, eop, prim, flg, nreg, regs = parse_giftag(qw0, qw1)
+
+            if prim >= 0:
+                self.state['prim'] = prim
+                self.state['fst'] = bool((prim >> 8) & 1)
+
+            if flg == 0:  # PACKED
+                end = p + 16 * nloop * nreg
+                if end <= n and not _STATEFUL_REGS.intersection(regs):
+                    self._packed_block(data[p:end], nloop, regs)
+                    p = end
+                elif not self._packed_regs(data, p, nloop, regs):
+                    return
+                else:
+                    p = end
+            elif flg == 1:  # REGLIST: NLOOP*NREG 64-bit values, padded to QW
+                count = nloop * nreg
+                qw_count = (count + 1) // 2
+                p += qw_count * 16
+            else:  # IMAGE (FLG=2/3): NLOOP * 16 raw bytes
+                p += nloop * 16
+
+    def _packed_regs(self, data: bytes, p: int, nloop: int, regs: List[int]) -> bool:
+        """Per-register PACKED walk; False if the data ran out."""
+        st = self.state
+        n = len(data)
+        for _ in range(nloop):
+            for r in regs:
+                if p + 16 > n:
+                    return False
+                lo, hi = struct.unpack_from('<QQ', data, p)
+                p += 16
+                if r == REG_PRIM:
+                    st['prim'] = lo & 0x7FF
+                    st['fst'] = bool((lo >> 8) & 1)
+                elif r == REG_RGBAQ:
+                    # packed: R[0..7], G[32..39], B[64..71], A[96..103]
+                    # Note: PACKED RGBAQ does NOT carry Q in its data;
+                    # RGBAQ.Q is set from the latched ST.Q from the
+                    # most recent packed ST write — which we already
+                    # placed in state['q'].
+                    st['rgba'] = (lo & 0xFF) | (((lo >> 32) & 0xFF) << 8) \
+                        | ((hi & 0xFF) << 16) | (((hi >> 32) & 0xFF) << 24)
+                elif r == REG_ST:
+                    # ST also primes Q
+                    st['s'], st['t'], st['q'] = struct.unpack_from('<3f', data, p - 16)
+                elif r == REG_UV:
+                    st['u'] = lo & 0x3FFF
+                    st['v'] = (lo >> 16) & 0x3FFF
+                elif r in _KICK_REGS:
+                    # packed XYZF: X[0..15], Y[32..47], Z[64..87], F[100..107] (XYZF only)
+                    # XYZ3/XYZF3 write the position without a kick (no draw).
+                    self._kick(lo & 0xFFFF, (lo >> 32) & 0xFFFF, hi & 0xFFFFFF)
+                elif r == REG_TEX0_1:
+                    st['tex0_1'] = lo
+                    self.cur = None  # state changed → flush draw grouping
+                elif r == REG_TEX0_2:
+                    st['tex0_2'] = lo
+                    self.cur = None
+                elif r == REG_AD:
+                    self._ad(hi & 0xFF, lo)
+        return True
+
+    def _ad(self, addr: int, lo: int) -> None:
+        st = self.state
+        if addr == ADDR_PRIM:
+            st['prim'] = lo & 0x7FF
+            st['fst'] = bool((lo >> 8) & 1)
+        elif addr in (ADDR_TEX0_1, ADDR_TEX0_2, ADDR_TEX1_1, ADDR_TEX1_2):
+            st[{ADDR_TEX0_1: 'tex0_1', ADDR_TEX0_2: 'tex0_2',
+                ADDR_TEX1_1: 'tex1_1', ADDR_TEX1_2: 'tex1_2'}[addr]] = lo
+            self.cur = None
+        elif addr == ADDR_ST:
+            st['s'], st['t'] = struct.unpack('<2f', struct.pack('<Q', lo))
+        elif addr == ADDR_UV:
+            st['u'] = lo & 0x3FFF
+            st['v'] = (lo >> 16) & 0x3FFF
+        elif addr == ADDR_XYZ2 or addr == ADDR_XYZF2:
+            # A+D-kicked draws only carry PRIM/FST/TEX0_1.
+            self._kick(lo & 0xFFFF, (lo >> 16) & 0xFFFF, (lo >> 32) & 0xFFFFFFFF,
+                       full=False)
+
+    def _packed_block(self, block: bytes, nloop: int, regs: List[int]) -> None:
+        """Whole-GIFTAG PACKED decode for tags that only latch and kick.
+
+        Slot k's qwords are rows k, k+nreg, ... of the block; a kick at
+        slot k takes each latched register from the last slot before k
+        that writes it in the same loop, else from the last writer of the
+        previous loop (the tag-start state for loop 0)."""
+        if nloop == 0:
+            return
+        nreg = len(regs)
+        st = self.state
+        h = array('H', block)
+        w = array('I', block)
+        fl = array('f', block)
+        if sys.byteorder != 'little':
+            h.byteswap()
+            w.byteswap()
+            fl.byteswap()
+
+        def slot_values(k: int, key: str) -> array:
+            if key == 's':
+                return fl[4 * k::4 * nreg]
+            if key == 't':
+                return fl[4 * k + 1::4 * nreg]
+            if key == 'q':
+                return fl[4 * k + 2::4 * nreg]
+            if key == 'u':
+                return _masked(h[8 * k::8 * nreg], 0x3FFF)
+            if key == 'v':
+                return _masked(h[8 * k + 1::8 * nreg], 0x3FFF)
+            # rgba: bytes 0, 4, 8, 12 of the qword
+            rgba = bytearray(4 * nloop)
+            for c in range(4):
+                rgba[c::4] = block[16 * k + 4 * c::16 * nreg]
+            out = array('I', bytes(rgba))
+            if sys.byteorder != 'little':
+                out.byteswap()
+            return out
+
+        writers: Dict[str, List[int]] = {}
+        for k, r in enumerate(regs):
+            keys = {REG_ST: ('s', 't', 'q'), REG_UV: ('u', 'v'), REG_RGBAQ: ('rgba',)}.get(r, ())
+            for key in keys:
+                writers.setdefault(key, []).append(k)
+        kicks = [k for k, r in enumerate(regs) if r in _KICK_REGS]
+
+        if kicks:
+            d = self._draw()
+            di = len(self.draws) - 1
+            base = d.count
+            nk = len(kicks)
+            total = nloop * nk
+            cols: Dict[str, array] = {}
+            for j, k in enumerate(kicks):
+                per_kick = {
+                    'x': h[8 * k::8 * nreg],
+                    'y': h[8 * k + 2::8 * nreg],
+                    'z': _masked(w[4 * k + 2::4 * nreg], 0xFFFFFF),
+                }
+                for key in _LATCHED:
+                    ws = writers.get(key, [])
+                    before = [x for x in ws if x < k]
+                    if before:
+                        per_kick[key] = slot_values(before[-1], key)
+                        continue
+                    start = st[key]
+                    if isinstance(start, _Inherit):
+                        rows = range(j, total, nk) if not ws else range(j, j + 1)
+                        self._fixup_rows(di, key, base, rows)
+                        start = 0
+                    if ws:
+                        prev = slot_values(ws[-1], key)
+                        per_kick[key] = array(_COLUMNS[key], [start]) + prev[:nloop - 1]
+                    else:
+                        per_kick[key] = array(_COLUMNS[key], [start]) * nloop
+                for key, col in per_kick.items():
+                    if nk == 1:
+                        cols[key] = col
+                    else:
+                        dst = cols.setdefault(key, array(_COLUMNS[key], bytes(total * col.itemsize)))
+                        dst[j::nk] = col
+            for key, col in cols.items():
+                d.cols[key].extend(col)
+
+        for key, ws in writers.items():
+            st[key] = slot_values(ws[-1], key)[-1]
+
+    def _fixup_rows(self, di: int, key: str, base: int, rows: range) -> None:
+        if rows.step == 1:
+            self.fixups.append((di, key, base + rows.start, base + rows.stop))
+        else:
+            self.fixups.extend((di, key, base + r, base + r + 1) for r in rows)
+
+    def result(self) -> BatchResult:
+        written = {k: v for k, v in self.state.items() if not isinstance(v, _Inherit)}
+        end = 'carry' if self.cur is _CARRY else ('none' if self.cur is None else 'open')
+        return BatchResult(self.draws, self.fixups, self.flags, written, end)
+
+
+def _masked(col: array, mask: int) -> array:
+    if col and max(col) > mask:
+        return array(col.typecode, (x & mask for x in col))
+    return col
+
+
+def parse_batch(transfers: List[bytes]) -> BatchResult:
+    """Parse consecutive transfers with unknown starting GS state."""
+    bp = _BatchParser()
+    for t in transfers:
+        bp.transfer(t)
+    return bp.result()
+
+
+class _Merger:
+    """Stitches BatchResults, in dump order, into the sequential result."""
+
+    def __init__(self):
+        self.draws: List[DrawCall] = []
+        self.state = dict(STATE_DEFAULTS)
+        self.open = False  # a draw is still open across the batch boundary
+
+    def _resolve(self, value):
+        return self.state[value.key] if isinstance(value, _Inherit) else value
+
+    def add(self, res: BatchResult) -> None:
+        for d in res.draws:
+            for attr in ('prim', 'fst', 'tex0_1', 'tex0_2', 'tex1_1', 'tex1_2'):
+                setattr(d, attr, self._resolve(getattr(d, attr)))
+        for di, key, a, b in res.fixups:
+            col = res.draws[di].cols[key]
+            col[a:b] = array(col.typecode, [self.state[key]]) * (b - a)
+        for di, d in enumerate(res.draws):
+            flag = res.flags.get(di)
+            if flag == 'carry':
+                merge = self.open and self.draws[-1].prim == d.prim
+            elif flag == 'maybe':
+                merge = self.draws[-1].prim == d.prim
+            else:
+                merge = False
+            if merge:
+                self.draws[-1].extend(d)
+            else:
+                self.draws.append(d)
+        self.state.update(res.written)
+        if res.end != 'carry':
+            self.open = res.end == 'open'
+
+
+def extract_drawcalls(path: Path, jobs: int = 1,
+                      batch_bytes: int = BATCH_BYTES) -> List[DrawCall]:
+    """Draw calls of the whole dump. `jobs` != 1 parses batches over a
+    process pool (0 = one worker per core); at most a few batches per
+    worker are in flight, so memory stays bounded either way."""
+    merger = _Merger()
+    if jobs == 1:
+        for batch in iter_batches(path, batch_bytes):
+            merger.add(parse_batch(batch))
+        return merger.draws
+    workers = jobs or os.cpu_count() or 1
+    with ProcessPoolExecutor(max_workers=workers) as pool:
+        window = 2 * workers
+        pending: deque = deque()
+        for batch in iter_batches(path, batch_bytes):
+            pending.append(pool.submit(parse_batch, batch))
+            if len(pending) >= window:
+                merger.add(pending.popleft().result())
+        while pending:
+            merger.add(pending.popleft().result())
+    return merger.draws
 
 
 def _decode_tex0(tex0: int) -> dict:
@@ -361,18 +727,21 @@ def main() -> None:
                     help='print at most N draw calls')
     ap.add_argument('--min-verts', type=int, default=4,
                     help='only show draws with at least N vertices')
+    ap.add_argument('--jobs', '-j', type=int, default=1,
+                    help='worker processes for VSync-split batches (0 = all cores)')
     args = ap.parse_args()
 
-    draws = extract_drawcalls(args.path)
+    draws = extract_drawcalls(args.path, jobs=args.jobs)
     print(f"total draws: {len(draws)}")
-    big = [d for d in draws if len(d.vertices) >= args.min_verts]
+    big = [d for d in draws if d.count >= args.min_verts]
     print(f"with >= {args.min_verts} verts: {len(big)}")
 
     for di, d in enumerate(big[:args.limit]):
         t0 = _decode_tex0(d.tex0_1)
-        print(f"\ndraw {di}: {d.prim_name()} verts={len(d.vertices)} fst={d.fst} "
+        print(f"\ndraw {di}: {d.prim_name()} verts={d.count} fst={d.fst} "
               f"tex0={d.tex0_1:016x} (tbp={t0['tbp']:#x} {t0['tw']}x{t0['th']})")
-        for vi, v in enumerate(d.vertices[:6]):
+        for vi in range(min(6, d.count)):
+            v = d.vertex(vi)
             # XYZ are 12.4 fixed (with 0x8000 offset by GS spec)
             x = (v.x - 0x0000) / 16.0
             y = (v.y - 0x0000) / 16.0
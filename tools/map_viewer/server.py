@@ -6,37 +6,180 @@ Usage:
 Open the printed URL. `/` is the map viewer; `/animations` is the
 deduplicated model viewer (Model -> Anim id, with the manifest of
 scenes referencing each model shown alongside).
+
+Requests run on their own threads, so one slow download doesn't hold up
+other browsers on the same export. Files carry strong ETags (content
+hash, cached per size/mtime); a request whose ``?v=`` matches that hash,
+as the URLs in scenes.json do, is cacheable forever. Bodies go out with
+``socket.sendfile``. JSON (.gltf, manifests, the indices) is sent gzip-
+or brotli-encoded when the client accepts it; a ``<file>.gz`` / ``.br``
+written next to the source is used as-is, otherwise the encoded copy is
+made once and kept in memory.
 """
 from __future__ import annotations
 
 import argparse
+import gzip
+import hashlib
 import http.server
 import json
-import socketserver
+import os
+import re
+import threading
 import webbrowser
+from collections import OrderedDict
 from pathlib import Path
+from urllib.parse import parse_qs, urlsplit
+
+try:
+    import brotli  # optional: pip install brotli
+except ImportError:
+    brotli = None
 
 
 HERE = Path(__file__).resolve().parent
 
+IMMUTABLE = "public, max-age=31536000, immutable"
+COMPRESSIBLE = (".gltf", ".json")
+ENCODED_CACHE_BYTES = 64 << 20
+
+
+def file_digest(path: Path) -> str:
+    """Strong ETag value / ``?v=`` version of a file's contents."""
+    h = hashlib.blake2b(digest_size=12)
+    with path.open("rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            h.update(block)
+    return h.hexdigest()
+
+
+def _encode(data: bytes, enc: str) -> bytes:
+    if enc == "br":
+        return brotli.compress(data)
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def _pick_encoding(accept: str | None) -> str | None:
+    """Best of br/gzip the client accepts (q > 0), or None."""
+    offered = {}
+    for part in (accept or "").split(","):
+        token, _, params = part.strip().partition(";")
+        q = 1.0
+        m = re.search(r"q\s*=\s*([0-9.]+)", params)
+        if m:
+            try:
+                q = float(m.group(1))
+            except ValueError:
+                q = 0.0
+        offered[token.strip().lower()] = q
+    for enc in (("br", "gzip") if brotli is not None else ("gzip",)):
+        if offered.get(enc, offered.get("*", 0.0)) > 0:
+            return enc
+    return None
+
+
+class AssetCache:
+    """Content digests and encoded copies of served files.
+
+    Both are keyed on (size, mtime_ns), so a re-export is picked up on the
+    next request without restarting. Encoded copies are evicted least
+    recently used past ``max_bytes``.
+    """
+
+    def __init__(self, max_bytes: int = ENCODED_CACHE_BYTES) -> None:
+        self._lock = threading.Lock()
+        self._digests: dict[Path, tuple[int, int, str]] = {}
+        self._encoded: OrderedDict[tuple[Path, str], tuple[int, int, bytes]] = OrderedDict()
+        self._encoded_bytes = 0
+        self.max_bytes = max_bytes
+
+    def digest(self, path: Path, st: os.stat_result) -> str:
+        with self._lock:
+            hit = self._digests.get(path)
+        if hit and hit[:2] == (st.st_size, st.st_mtime_ns):
+            return hit[2]
+        value = file_digest(path)
+        with self._lock:
+            self._digests[path] = (st.st_size, st.st_mtime_ns, value)
+        return value
+
+    def encoded(self, path: Path, st: os.stat_result, enc: str) -> bytes:
+        key = (path, enc)
+        with self._lock:
+            hit = self._encoded.get(key)
+            if hit and hit[:2] == (st.st_size, st.st_mtime_ns):
+                self._encoded.move_to_end(key)
+                return hit[2]
+        sidecar = path.with_name(path.name + (".br" if enc == "br" else ".gz"))
+        try:
+            fresh = sidecar.stat().st_mtime_ns >= st.st_mtime_ns
+        except OSError:
+            fresh = False
+        data = sidecar.read_bytes() if fresh else _encode(path.read_bytes(), enc)
+        with self._lock:
+            old = self._encoded.pop(key, None)
+            if old:
+                self._encoded_bytes -= len(old[2])
+            self._encoded[key] = (st.st_size, st.st_mtime_ns, data)
+            self._encoded_bytes += len(data)
+            while self._encoded_bytes > self.max_bytes and len(self._encoded) > 1:
+                _, (_, _, dropped) = self._encoded.popitem(last=False)
+                self._encoded_bytes -= len(dropped)
+        return data
+
+
+class Payload:
+    """An in-memory response (page, index JSON) with its encoded copies."""
+
+    def __init__(self, data: bytes, ctype: str) -> None:
+        self.ctype = ctype
+        self.etag = hashlib.blake2b(data, digest_size=12).hexdigest()
+        self.variants = {None: data, "gzip": _encode(data, "gzip")}
+        if brotli is not None:
+            self.variants["br"] = _encode(data, "br")
+
 
 def build_scene_index(root: Path) -> list[dict]:
     scenes: list[dict] = []
     for scene_dir in sorted(p for p in root.iterdir() if p.is_dir()):
-        gltfs = sorted(scene_dir.glob("*.gltf"))
-        if not gltfs:
+        # A .glb (psm2_gltf --glb) wins over a .gltf left from an older export.
+        gltfs = sorted(scene_dir.glob("*.glb")) or sorted(scene_dir.glob("*.gltf"))
+        # psm2_gltf --chunks: the viewer streams <map>_chunks/* via the manifest.
+        manifests = sorted(scene_dir.glob("*.chunks.json"))
+        if not gltfs and not manifests:
             continue
-        gltf = gltfs[0]
-        scenes.append(
-            {
-                "scene": scene_dir.name,
-                "file": gltf.name,
-                "url": f"/maps/{scene_dir.name}/{gltf.name}",
-            }
-        )
+        entry = {
+            "scene": scene_dir.name,
+            "file": (gltfs or manifests)[0].name,
+            "url": f"/maps/{scene_dir.name}/{gltfs[0].name}" if gltfs else None,
+        }
+        if manifests:
+            entry["chunks"] = f"/maps/{scene_dir.name}/{manifests[0].name}"
+        scenes.append(entry)
     return scenes
 
 
+def version_scenes(map_root: Path, scenes: list[dict], cache: AssetCache) -> list[dict]:
+    """``scenes`` with ``?v=<digest>`` on each URL, so the browser keeps the
+    file until it changes. Digests come from ``cache``, the same ones the
+    files are then served with; a missing file is left unversioned."""
+    out = []
+    for entry in scenes:
+        entry = dict(entry)
+        for key in ("url", "chunks"):
+            url = entry.get(key)
+            if not url:
+                continue
+            path = map_root / url[len("/maps/"):]
+            try:
+                st = path.stat()
+            except OSError:
+                continue
+            entry[key] = f"{url}?v={cache.digest(path, st)}"
+        out.append(entry)
+    return out
+
+
 def build_models_index(root: Path) -> dict:
     """Read out/models/_index.json (produced by psc3_export_all)."""
     if not root.is_dir():
@@ -74,62 +217,193 @@ def _safe_under(base: Path, rel: str) -> Path | None:
     return target
 
 
+def _parse_range(header: str | None, size: int) -> tuple[int, int] | None:
+    """(first, last) byte of a single ``bytes=`` range, clamped to ``size``.
+
+    None means serve the whole file (no header, or a form we don't split:
+    multiple ranges, other units). Raises ValueError when unsatisfiable.
+    """
+    m = re.fullmatch(r"\s*bytes\s*=\s*(\d*)\s*-\s*(\d*)\s*", header or "")
+    if m is None or not (m.group(1) or m.group(2)):
+        return None
+    if not m.group(1):  # suffix: the last N bytes
+        n = int(m.group(2))
+        if n == 0 or size == 0:
+            raise ValueError("empty suffix range")
+        return max(0, size - n), size - 1
+    first = int(m.group(1))
+    last = int(m.group(2)) if m.group(2) else size - 1
+    if first >= size or last < first:
+        raise ValueError("range outside file")
+    return first, min(last, size - 1)
+
+
 def _ctype_for(path: Path) -> str:
     if path.suffix == ".gltf":
         return "model/gltf+json"
+    if path.suffix == ".glb":
+        return "model/gltf-binary"
     if path.suffix == ".bin":
         return "application/octet-stream"
     if path.suffix == ".png":
         return "image/png"
     if path.suffix in (".jpg", ".jpeg"):
         return "image/jpeg"
+    if path.suffix == ".json":
+        return "application/json"
+    if path.suffix == ".ktx2":
+        return "image/ktx2"
     return "application/octet-stream"
 
 
-def make_handler(map_root: Path, models_root: Path, scenes: list[dict], models_index: dict):
-    index_html = (HERE / "index.html").read_bytes()
-    anim_html = (HERE / "index_anim.html").read_bytes()
-    scenes_json = json.dumps(scenes).encode("utf-8")
-    models_json = json.dumps(models_index).encode("utf-8")
+def make_handler(map_root: Path, models_root: Path, scenes: list[dict], models_index: dict,
+                 cache: AssetCache | None = None):
+    pages = {
+        "index": Payload((HERE / "index.html").read_bytes(), "text/html; charset=utf-8"),
+        "anim": Payload((HERE / "index_anim.html").read_bytes(), "text/html; charset=utf-8"),
+        "models": Payload(json.dumps(models_index).encode("utf-8"), "application/json"),
+    }
+    cache = cache or AssetCache()
+    scenes_lock = threading.Lock()
+
+    def scenes_page() -> Payload:
+        # Hashed on first request rather than at startup, then re-checked
+        # per request against the cache's (size, mtime) so re-exports show.
+        data = json.dumps(version_scenes(map_root, scenes, cache)).encode("utf-8")
+        with scenes_lock:
+            page = pages.get("scenes")
+            if page is None or page.variants[None] != data:
+                page = pages["scenes"] = Payload(data, "application/json")
+        return page
 
     class Handler(http.server.SimpleHTTPRequestHandler):
-        def _send_bytes(self, data: bytes, ctype: str) -> None:
+        protocol_version = "HTTP/1.1"  # keep-alive; every response sets Content-Length
+
+        def _not_modified(self, etag: str, headers: dict[str, str]) -> bool:
+            match = self.headers.get("If-None-Match")
+            if not match or not (match.strip() == "*"
+                                 or etag in (t.strip() for t in match.split(","))):
+                return False
+            self.send_response(304)
+            self.send_header("ETag", etag)
+            for k, v in headers.items():
+                self.send_header(k, v)
+            self.end_headers()
+            return True
+
+        def _send_payload(self, page: Payload) -> None:
+            enc = _pick_encoding(self.headers.get("Accept-Encoding"))
+            enc = enc if enc in page.variants else None
+            etag = f'"{page.etag}-{enc}"' if enc else f'"{page.etag}"'
+            common = {"Cache-Control": "no-cache", "Vary": "Accept-Encoding"}
+            if self._not_modified(etag, common):
+                return
+            data = page.variants[enc]
             self.send_response(200)
-            self.send_header("Content-Type", ctype)
+            self.send_header("Content-Type", page.ctype)
             self.send_header("Content-Length", str(len(data)))
-            self.send_header("Cache-Control", "no-store")
+            if enc:
+                self.send_header("Content-Encoding", enc)
+            self.send_header("ETag", etag)
+            for k, v in common.items():
+                self.send_header(k, v)
             self.end_headers()
-            self.wfile.write(data)
+            if self.command != "HEAD":
+                self.wfile.write(data)
+
+        def _serve_file(self, base: Path, rel: str, version: str | None = None) -> None:
+            """Exported files: strong ETag, byte ranges, compressed JSON.
 
-        def _serve_file(self, base: Path, rel: str) -> None:
+            ``Range`` (one ``bytes=`` range) answers 206; ``If-Range`` with
+            a stale tag falls back to the full file. Compressible files are
+            only encoded for whole-file requests.
+            """
             target = _safe_under(base, rel)
             if target is None or not target.is_file():
                 self.send_error(404)
                 return
-            self._send_bytes(target.read_bytes(), _ctype_for(target))
+            st = target.stat()
+            size = st.st_size
+            digest = cache.digest(target, st)
+            common = {"Cache-Control": IMMUTABLE if version == digest else "no-cache"}
+            enc = None
+            if target.suffix in COMPRESSIBLE:
+                common["Vary"] = "Accept-Encoding"
+                if "Range" not in self.headers:
+                    enc = _pick_encoding(self.headers.get("Accept-Encoding"))
+            etag = f'"{digest}-{enc}"' if enc else f'"{digest}"'
+            if self._not_modified(etag, common):
+                return
+
+            if enc:
+                data = cache.encoded(target, st, enc)
+                self.send_response(200)
+                self.send_header("Content-Type", _ctype_for(target))
+                self.send_header("Content-Length", str(len(data)))
+                self.send_header("Content-Encoding", enc)
+                self.send_header("ETag", etag)
+                for k, v in common.items():
+                    self.send_header(k, v)
+                self.end_headers()
+                if self.command != "HEAD":
+                    self.wfile.write(data)
+                return
+
+            rng = None
+            if self.headers.get("If-Range") in (None, etag):
+                try:
+                    rng = _parse_range(self.headers.get("Range"), size)
+                except ValueError:
+                    self.send_response(416)
+                    self.send_header("Content-Range", f"bytes */{size}")
+                    self.send_header("Content-Length", "0")
+                    self.end_headers()
+                    return
+            first, last = rng if rng is not None else (0, size - 1)
+            length = last - first + 1
+            self.send_response(206 if rng is not None else 200)
+            self.send_header("Content-Type", _ctype_for(target))
+            self.send_header("Content-Length", str(length))
+            if rng is not None:
+                self.send_header("Content-Range", f"bytes {first}-{last}/{size}")
+            self.send_header("Accept-Ranges", "bytes")
+            self.send_header("ETag", etag)
+            for k, v in common.items():
+                self.send_header(k, v)
+            self.end_headers()
+            if self.command == "HEAD" or length <= 0:
+                return
+            with target.open("rb") as f:
+                # os.sendfile where available, plain send() otherwise.
+                self.connection.sendfile(f, offset=first, count=length)
 
         def do_GET(self):  # noqa: N802
-            path = self.path.split("?", 1)[0]
+            url = urlsplit(self.path)
+            path = url.path
+            version = (parse_qs(url.query).get("v") or [None])[0]
             if path in ("/", "/index.html"):
-                self._send_bytes(index_html, "text/html; charset=utf-8")
+                self._send_payload(pages["index"])
                 return
             if path in ("/animations", "/animations/", "/models", "/models/", "/index_anim.html"):
-                self._send_bytes(anim_html, "text/html; charset=utf-8")
+                self._send_payload(pages["anim"])
                 return
             if path == "/scenes.json":
-                self._send_bytes(scenes_json, "application/json")
+                self._send_payload(scenes_page())
                 return
             if path == "/models-index.json":
-                self._send_bytes(models_json, "application/json")
+                self._send_payload(pages["models"])
                 return
             if path.startswith("/maps/"):
-                self._serve_file(map_root, path[len("/maps/"):])
+                self._serve_file(map_root, path[len("/maps/"):], version)
                 return
             if path.startswith("/models/"):
-                self._serve_file(models_root, path[len("/models/"):])
+                self._serve_file(models_root, path[len("/models/"):], version)
                 return
             self.send_error(404)
 
+        def do_HEAD(self):  # noqa: N802
+            self.do_GET()
+
         def log_message(self, format, *args):  # quieter
             return
 
@@ -155,7 +429,7 @@ def main() -> int:
     print(f"[viewer] maps: {len(scenes)} scenes from {map_root}")
     print(f"[viewer] models: {len(models_index)} unique models from {models_root}")
     handler = make_handler(map_root, models_root, scenes, models_index)
-    with socketserver.TCPServer(("127.0.0.1", args.port), handler) as httpd:
+    with http.server.ThreadingHTTPServer(("127.0.0.1", args.port), handler) as httpd:
         url = f"http://127.0.0.1:{args.port}/"
         print(f"[viewer] open {url}  (Ctrl+C to stop)")
         print(f"[viewer]      {url}models")
@@ -7,18 +7,47 @@ The layout is inferred from the game executable:
 
 This tool does not decode audio or video. It only reproduces the game's
 container split so the MPEG payload can be tested with external decoders.
+
+The file is streamed one interleaved block at a time, like
+FUN_002f1c98 pulling the next block off the disc, so memory stays at a few
+blocks whatever the movie size. With `--reorder` the PCM channel stripes are
+undone on the fly (see mv3_reorder_audio.py) and the audio output is plain
+s16le stereo. MPEG and PCM are written by one thread each through bounded
+queues, so both can be pipes or FIFOs read by the same consumer; `--ffmpeg`
+starts ffmpeg on two such pipes directly. ffmpeg probes the whole video
+input before it opens the audio one, so there the PCM queue is unbounded:
+audio backs up in memory while video is read, instead of stalling the
+demuxer with both pipes full.
 """
 
 from __future__ import annotations
 
 import argparse
 import json
+import os
+import queue
+import shlex
 import struct
+import subprocess
+import sys
+import threading
 from pathlib import Path
+from typing import BinaryIO, Callable, Iterator, Optional
+
+from mv3_reorder_audio import (
+    DEFAULT_CHUNK_SIZE,
+    DEFAULT_STRIPE_SIZE,
+    check_layout,
+    destripe_into,
+)
 
 
 HEADER = struct.Struct("<4sIIIII")
 SECTOR_SIZE = 0x800
+# Chunks buffered per output before the demuxer blocks on a slow reader
+# (0 = unbounded).
+QUEUE_DEPTH = 4
+FFMPEG_ARGS = "-c:v copy -c:a flac -shortest"
 
 
 class Mv3Error(ValueError):
@@ -68,9 +97,104 @@ def require_valid_layout(header: dict[str, int | str], data_offset: int) -> None
         raise Mv3Error("PCM chunk size exceeds the game's 8-chunk buffer limit")
 
 
-def demux(data: bytes, data_offset: int) -> tuple[dict[str, int | str], bytes, bytes, dict[str, int]]:
-    header = parse_header(data)
+def read_blocks(src: BinaryIO, block_size: int) -> Iterator[memoryview]:
+    """Yield each complete interleaved block from the current position.
+
+    One buffer is reused for every block, so consumers must copy what they
+    keep. The number of trailing bytes is the generator's return value.
+    """
+    block = bytearray(block_size)
+    view = memoryview(block)
+    while True:
+        filled = 0
+        while filled < block_size:
+            n = src.readinto(view[filled:])
+            if not n:
+                return filled
+            filled += n
+        yield view
+
+
+class Sink:
+    """Write chunks to a file, stdout ("-") or raw fd from a worker thread."""
+
+    def __init__(self, target: str | int, label: str, depth: int = QUEUE_DEPTH):
+        self.target = target
+        self.label = label
+        self.written = 0
+        self.error: Optional[BaseException] = None
+        self._queue: queue.Queue[Optional[bytes]] = queue.Queue(maxsize=depth)
+        self._thread = threading.Thread(target=self._run, name=f"mv3-{label}", daemon=True)
+        self._thread.start()
+
+    def _open(self) -> BinaryIO:
+        if isinstance(self.target, int):
+            return os.fdopen(self.target, "wb")
+        if self.target == "-":
+            return os.fdopen(os.dup(sys.stdout.fileno()), "wb")
+        path = Path(self.target)
+        path.parent.mkdir(parents=True, exist_ok=True)
+        return path.open("wb")  # blocks here, not in the demuxer, for a FIFO
+
+    def _run(self) -> None:
+        try:
+            with self._open() as out:
+                while True:
+                    chunk = self._queue.get()
+                    if chunk is None:
+                        return
+                    out.write(chunk)
+                    self.written += len(chunk)
+        except BaseException as exc:  # noqa: BLE001 - reported by close()
+            self.error = exc
+            while self._queue.get() is not None:
+                pass
+
+    def put(self, chunk: bytes) -> None:
+        self._queue.put(chunk)
+
+    def close(self) -> None:
+        self._queue.put(None)
+        self._thread.join()
+        if self.error is not None:
+            raise Mv3Error(f"{self.label} output failed: {self.error}")
+
+
+def read_header(src: BinaryIO, data_offset: int) -> dict[str, int | str]:
+    """Read and validate the MV30 header; `src` is left at `data_offset`.
+
+    Reads forward instead of seeking so stdin and pipes work too.
+    """
+    header = parse_header(src.read(HEADER.size))
     require_valid_layout(header, data_offset)
+    skip = data_offset - HEADER.size
+    while skip > 0:
+        got = len(src.read(min(skip, SECTOR_SIZE)))
+        if not got:
+            raise Mv3Error(f"file is shorter than data offset 0x{data_offset:x}")
+        skip -= got
+    return header
+
+
+def stream_demux(
+    src: BinaryIO,
+    header: dict[str, int | str],
+    data_offset: int,
+    emit_mpeg: Callable[[bytes], None],
+    emit_pcm: Callable[[bytes], None],
+    reorder: bool = False,
+    chunk_size: int = DEFAULT_CHUNK_SIZE,
+    stripe_size: int = DEFAULT_STRIPE_SIZE,
+) -> dict[str, int]:
+    """Split `src` (positioned by `read_header`) block by block into MPEG
+    and PCM chunks; returns the stats written to the .mv3.json sidecar.
+
+    With `reorder`, PCM is regrouped into `chunk_size` audio chunks and
+    de-striped before it is emitted; a trailing partial chunk keeps its
+    complete stripe pairs and drops the rest.
+    """
+    if reorder:
+        check_layout(chunk_size, stripe_size)
 
     block_size = int(header["block_size"])
     pcm_offset = int(header["pcm_offset"])
@@ -78,21 +202,41 @@ def demux(data: bytes, data_offset: int) -> tuple[dict[str, int | str], bytes, b
     mpeg_offset = int(header["mpeg_offset"])
     mpeg_size = int(header["mpeg_size"])
 
-    if len(data) < data_offset:
-        raise Mv3Error(f"file is shorter than data offset 0x{data_offset:x}")
-
-    payload_size = len(data) - data_offset
-    block_count = payload_size // block_size
-    trailing_bytes = payload_size % block_size
-
-    pcm_chunks: list[bytes] = []
-    mpeg_chunks: list[bytes] = []
-
-    for block_index in range(block_count):
-        start = data_offset + block_index * block_size
-        block = data[start : start + block_size]
-        pcm_chunks.append(block[pcm_offset : pcm_offset + pcm_size])
-        mpeg_chunks.append(block[mpeg_offset : mpeg_offset + mpeg_size])
+    carry = bytearray()
+    pcm_bytes = 0
+
+    def flush_pcm(size: int) -> None:
+        nonlocal pcm_bytes
+        out = bytearray(size)
+        destripe_into(out, memoryview(carry)[:size], stripe_size)
+        del carry[:size]
+        emit_pcm(bytes(out))
+        pcm_bytes += size
+
+    block_count = 0
+    blocks = read_blocks(src, block_size)
+    while True:
+        try:
+            block = next(blocks)
+        except StopIteration as stop:
+            trailing_bytes = stop.value
+            break
+        block_count += 1
+        emit_mpeg(bytes(block[mpeg_offset : mpeg_offset + mpeg_size]))
+        if not reorder:
+            emit_pcm(bytes(block[pcm_offset : pcm_offset + pcm_size]))
+            pcm_bytes += pcm_size
+            continue
+        carry += block[pcm_offset : pcm_offset + pcm_size]
+        while len(carry) >= chunk_size:
+            flush_pcm(chunk_size)
+
+    dropped = 0
+    if reorder and carry:
+        pairs = len(carry) - len(carry) % (stripe_size * 2)
+        dropped = len(carry) - pairs
+        if pairs:
+            flush_pcm(pairs)
 
     stats = {
         "data_offset": data_offset,
@@ -100,34 +244,43 @@ def demux(data: bytes, data_offset: int) -> tuple[dict[str, int | str], bytes, b
         "trailing_bytes": trailing_bytes,
         "pcm_payload_bytes": block_count * pcm_size,
         "mpeg_payload_bytes": block_count * mpeg_size,
+        "pcm_written_bytes": pcm_bytes,
+        "pcm_dropped_bytes": dropped,
     }
-    return header, b"".join(pcm_chunks), b"".join(mpeg_chunks), stats
+    return stats
 
 
 def default_prefix(path: Path) -> Path:
     return path.with_suffix("")
 
 
-def write_outputs(prefix: Path, header: dict[str, int | str], pcm: bytes, mpeg: bytes, stats: dict[str, int]) -> None:
-    prefix.parent.mkdir(parents=True, exist_ok=True)
-    pcm_path = prefix.with_suffix(".pcm")
-    mpeg_path = prefix.with_suffix(".mpg")
-    info_path = prefix.with_suffix(".mv3.json")
-
-    pcm_path.write_bytes(pcm)
-    mpeg_path.write_bytes(mpeg)
-    info_path.write_text(json.dumps({"header": header, "stats": stats}, indent=2) + "\n", encoding="utf-8")
-
-    print(f"wrote {mpeg_path} ({len(mpeg)} bytes)")
-    print(f"wrote {pcm_path} ({len(pcm)} bytes)")
-    print(f"wrote {info_path}")
-    if stats["trailing_bytes"]:
-        print(f"warning: ignored {stats['trailing_bytes']} trailing byte(s) after complete blocks")
+def spawn_ffmpeg(output: str, extra_args: str) -> tuple[subprocess.Popen, int, int]:
+    """Start ffmpeg reading MPEG and s16le audio from two inherited pipes.
+
+    Returns (process, mpeg write fd, pcm write fd).
+    """
+    mpeg_r, mpeg_w = os.pipe()
+    pcm_r, pcm_w = os.pipe()
+    cmd = [
+        "ffmpeg", "-hide_banner", "-y",
+        "-fflags", "+genpts", "-f", "mpegvideo", "-i", f"pipe:{mpeg_r}",
+        "-f", "s16le", "-ar", "48000", "-ac", "2", "-i", f"pipe:{pcm_r}",
+        *shlex.split(extra_args), output,
+    ]
+    try:
+        proc = subprocess.Popen(cmd, pass_fds=(mpeg_r, pcm_r), stdin=subprocess.DEVNULL)
+    except OSError:
+        for fd in (mpeg_r, mpeg_w, pcm_r, pcm_w):
+            os.close(fd)
+        raise
+    os.close(mpeg_r)
+    os.close(pcm_r)
+    return proc, mpeg_w, pcm_w
 
 
 def main() -> int:
     parser = argparse.ArgumentParser(description="Demux an Orphen MV3 file into MPEG and PCM payloads.")
-    parser.add_argument("mv3", type=Path, help="Path to an extracted .MV3 file")
+    parser.add_argument("mv3", help="Path to an extracted .MV3 file, or - for stdin")
     parser.add_argument("-o", "--out-prefix", type=Path, help="Output prefix; defaults to input without suffix")
     parser.add_argument(
         "--data-offset",
@@ -135,11 +288,78 @@ def main() -> int:
         default=SECTOR_SIZE,
         help="Offset where interleaved blocks begin; game default is 0x800",
     )
+    parser.add_argument(
+        "--reorder",
+        action="store_true",
+        help="Undo the PCM channel stripes; the audio output is s16le stereo 48000 Hz",
+    )
+    parser.add_argument("--mpeg-out", help="MPEG destination (file, FIFO or -); default <prefix>.mpg")
+    parser.add_argument("--pcm-out", help="PCM destination (file, FIFO or -); default <prefix>.pcm")
+    parser.add_argument(
+        "--ffmpeg",
+        metavar="OUTPUT",
+        help="Pipe both streams straight into ffmpeg writing OUTPUT (implies --reorder)",
+    )
+    parser.add_argument(
+        "--ffmpeg-args",
+        default=FFMPEG_ARGS,
+        help=f"Output options passed to ffmpeg with --ffmpeg (default: {FFMPEG_ARGS!r})",
+    )
+    parser.add_argument("--chunk-size", type=lambda text: int(text, 0), default=DEFAULT_CHUNK_SIZE,
+                        help="Audio chunk size for --reorder; regular Mxx movies use 0x30000")
+    parser.add_argument("--stripe-size", type=lambda text: int(text, 0), default=DEFAULT_STRIPE_SIZE,
+                        help="Left/right stripe size for --reorder; confirmed value is 0x200")
     args = parser.parse_args()
 
-    data = args.mv3.read_bytes()
-    header, pcm, mpeg, stats = demux(data, args.data_offset)
-    write_outputs(args.out_prefix or default_prefix(args.mv3), header, pcm, mpeg, stats)
+    if args.mv3 == "-" and args.out_prefix is None and not args.ffmpeg and not (args.mpeg_out and args.pcm_out):
+        parser.error("reading stdin needs -o, --ffmpeg or both --mpeg-out and --pcm-out")
+    if args.mpeg_out == "-" and args.pcm_out == "-":
+        parser.error("only one stream can go to stdout")
+    reorder = args.reorder or bool(args.ffmpeg)
+    uses_stdout = "-" in (args.mpeg_out, args.pcm_out)
+    log = sys.stderr if uses_stdout else sys.stdout
+    prefix = args.out_prefix or (default_prefix(Path(args.mv3)) if args.mv3 != "-" else None)
+
+    src = sys.stdin.buffer if args.mv3 == "-" else open(args.mv3, "rb")
+    header = read_header(src, args.data_offset)
+    if reorder:
+        check_layout(args.chunk_size, args.stripe_size)
+
+    proc = None
+    if args.ffmpeg:
+        proc, mpeg_target, pcm_target = spawn_ffmpeg(args.ffmpeg, args.ffmpeg_args)
+    else:
+        mpeg_target = args.mpeg_out or str(prefix.with_suffix(".mpg"))
+        pcm_target = args.pcm_out or str(prefix.with_suffix(".pcm"))
+    # ffmpeg reads video until it has probed it, only then audio.
+    sinks = [Sink(mpeg_target, "MPEG"), Sink(pcm_target, "PCM", depth=0 if proc else QUEUE_DEPTH)]
+
+    try:
+        stats = stream_demux(
+            src, header, args.data_offset, sinks[0].put, sinks[1].put,
+            reorder=reorder, chunk_size=args.chunk_size, stripe_size=args.stripe_size,
+        )
+    finally:
+        if src is not sys.stdin.buffer:
+            src.close()
+        for sink in sinks:
+            sink.close()
+
+    for sink in sinks:
+        where = args.ffmpeg if proc else sink.target
+        print(f"wrote {where} ({sink.written} bytes {sink.label})", file=log)
+    if prefix is not None and not args.ffmpeg:
+        info_path = prefix.with_suffix(".mv3.json")
+        info_path.parent.mkdir(parents=True, exist_ok=True)
+        stats["pcm_layout"] = "s16le_stereo" if reorder else "striped"
+        info_path.write_text(json.dumps({"header": header, "stats": stats}, indent=2) + "\n", encoding="utf-8")
+        print(f"wrote {info_path}", file=log)
+    if stats["trailing_bytes"]:
+        print(f"warning: ignored {stats['trailing_bytes']} trailing byte(s) after complete blocks", file=log)
+    if stats["pcm_dropped_bytes"]:
+        print(f"warning: dropped {stats['pcm_dropped_bytes']} PCM byte(s) short of a stripe pair", file=log)
+    if proc is not None:
+        return proc.wait()
     return 0
 
 
@@ -10,7 +10,9 @@ stripes, not as ordinary LRLR samples. The confirmed movie layout is:
 - 0x200-byte left/right channel stripes inside each 0x30000-byte chunk
 
 This tool converts the raw `.pcm` emitted by `mv3_demux.py` into a conventional
-s16le stereo stream suitable for ffmpeg with `-f s16le -ar 48000 -ac 2`.
+s16le stereo stream suitable for ffmpeg with `-f s16le -ar 48000 -ac 2`. It
+works one chunk at a time, so memory stays at two chunks whatever the input
+size. `mv3_demux.py --reorder` applies the same shuffle while demuxing.
 """
 
 from __future__ import annotations
@@ -28,7 +30,7 @@ class Mv3AudioError(ValueError):
     pass
 
 
-def reorder_channel_stripes(data: bytes, chunk_size: int, stripe_size: int) -> bytes:
+def check_layout(chunk_size: int, stripe_size: int) -> None:
     if chunk_size <= 0:
         raise Mv3AudioError("chunk size must be positive")
     if stripe_size <= 0:
@@ -37,30 +39,55 @@ def reorder_channel_stripes(data: bytes, chunk_size: int, stripe_size: int) -> b
         raise Mv3AudioError("stripe size must be a multiple of the sample size")
     if chunk_size % (stripe_size * 2) != 0:
         raise Mv3AudioError("chunk size must contain complete left/right stripe pairs")
+
+
+def destripe_into(out: bytearray | memoryview, chunk: bytes | memoryview, stripe_size: int) -> None:
+    """Write one chunk of L/R stripes into `out` as interleaved LRLR samples.
+
+    The left stripes, concatenated, are exactly the even output samples and
+    the right stripes the odd ones, so the whole chunk is two joins and two
+    strided sample copies instead of a per-sample loop.
+    """
+    pair = stripe_size * 2
+    n = len(chunk)
+    left = b"".join(chunk[i : i + stripe_size] for i in range(0, n, pair))
+    right = b"".join(chunk[i + stripe_size : i + pair] for i in range(0, n, pair))
+    samples = memoryview(out).cast("B")[:n].cast("H")
+    samples[0::2] = memoryview(left).cast("H")
+    samples[1::2] = memoryview(right).cast("H")
+
+
+def reorder_channel_stripes(data: bytes, chunk_size: int, stripe_size: int) -> bytes:
+    check_layout(chunk_size, stripe_size)
     if len(data) % chunk_size != 0:
         raise Mv3AudioError("input size must contain complete MV3 audio chunks")
 
     output = bytearray(len(data))
-    write_offset = 0
-
+    view = memoryview(data)
     for chunk_start in range(0, len(data), chunk_size):
-        chunk = data[chunk_start : chunk_start + chunk_size]
-        for pair_start in range(0, chunk_size, stripe_size * 2):
-            left = chunk[pair_start : pair_start + stripe_size]
-            right = chunk[pair_start + stripe_size : pair_start + stripe_size * 2]
-
-            for sample_offset in range(0, stripe_size, BYTES_PER_SAMPLE):
-                output[write_offset : write_offset + BYTES_PER_SAMPLE] = left[
-                    sample_offset : sample_offset + BYTES_PER_SAMPLE
-                ]
-                output[write_offset + BYTES_PER_SAMPLE : write_offset + BYTES_PER_SAMPLE * 2] = right[
-                    sample_offset : sample_offset + BYTES_PER_SAMPLE
-                ]
-                write_offset += BYTES_PER_SAMPLE * 2
-
+        destripe_into(memoryview(output)[chunk_start : chunk_start + chunk_size],
+                      view[chunk_start : chunk_start + chunk_size], stripe_size)
     return bytes(output)
 
 
+def reorder_file(src: Path, dst: Path, chunk_size: int, stripe_size: int) -> int:
+    """Stream `src` -> `dst` chunk by chunk; returns the bytes written."""
+    check_layout(chunk_size, stripe_size)
+    if src.stat().st_size % chunk_size != 0:
+        raise Mv3AudioError("input size must contain complete MV3 audio chunks")
+
+    chunk = bytearray(chunk_size)
+    output = bytearray(chunk_size)
+    written = 0
+    dst.parent.mkdir(parents=True, exist_ok=True)
+    with src.open("rb") as fin, dst.open("wb") as fout:
+        while fin.readinto(chunk) == chunk_size:
+            destripe_into(output, chunk, stripe_size)
+            fout.write(output)
+            written += chunk_size
+    return written
+
+
 def main() -> int:
     parser = argparse.ArgumentParser(description="Reorder demuxed Orphen MV3 audio channel stripes.")
     parser.add_argument("input_pcm", type=Path, help="Raw .pcm file emitted by mv3_demux.py")
@@ -79,11 +106,8 @@ def main() -> int:
     )
     args = parser.parse_args()
 
-    data = args.input_pcm.read_bytes()
-    reordered = reorder_channel_stripes(data, args.chunk_size, args.stripe_size)
-    args.output_pcm.parent.mkdir(parents=True, exist_ok=True)
-    args.output_pcm.write_bytes(reordered)
-    print(f"wrote {args.output_pcm} ({len(reordered)} bytes)")
+    written = reorder_file(args.input_pcm, args.output_pcm, args.chunk_size, args.stripe_size)
+    print(f"wrote {args.output_pcm} ({written} bytes)")
     return 0
 
 
@@ -0,0 +1,207 @@
+"""Packed animation clip store (``<model>.clips``) for the model viewer.
+
+``psc3_gltf_anim.emit_animated`` writes the whole skinned mesh once per
+anim id, so browsing a model's clips refetches and re-parses the same
+geometry every time. ``psc3_gltf_anim.emit_clip_store`` writes the mesh
++ skeleton once, and every clip of the model goes into one of these
+files; ``index_anim.html`` decodes it into ``THREE.AnimationClip``s
+bound to the skeleton's bones.
+
+Per joint (skin joint order = ``mesh.submeshes`` order) a clip holds a
+translation and a rotation track. Tracks are reduced first: a key is
+dropped when linear interpolation (slerp for rotations, as the viewer
+plays them) between the keys kept around it stays within tolerance of
+every dropped key. Constant tracks end up with one key.
+
+Layout (little-endian; every section 4-byte aligned):
+
+    header   "PCLP" u16 version u16 joints u16 clips u16 0 u32 0
+    clips  x (u16 anim_id, u16 n_times, f32 duration, u32 offset, u32 size)
+    clip body at offset:
+        f32 times[n_times]                    seconds, shared by tracks
+        per joint:
+          translation  u16 n, u16 0, f32 base[3], f32 step[3],
+                       u16 key[n] (index into times), u16 value[3n]
+                       -> base + value * step
+          rotation     u16 n, u16 0, u16 key[n], s16 value[4n]
+                       -> value / 32767, renormalized (x, y, z, w)
+        (each track padded to 4 bytes)
+
+Translations are quantized over the track's own range (65535 steps),
+rotations per component to 1/32767 -- well under the reduction
+tolerances.
+"""
+from __future__ import annotations
+
+import math
+import struct
+from dataclasses import dataclass, field
+from typing import List, Sequence, Tuple
+
+MAGIC = b"PCLP"
+VERSION = 1
+
+POS_TOL = 1e-3     # fraction of the skeleton's extent
+ROT_TOL = 0.002    # radians (~0.1 degree)
+
+Vec = Tuple[float, ...]
+
+
+@dataclass
+class Track:
+    keys: List[int]            # indices into Clip.times
+    values: List[Vec]          # one (x, y, z) or (x, y, z, w) per key
+
+
+@dataclass
+class Clip:
+    anim_id: int
+    times: List[float]
+    tracks: List[Tuple[Track, Track]] = field(default_factory=list)  # per joint
+
+    @property
+    def duration(self) -> float:
+        return self.times[-1] if self.times else 0.0
+
+
+# ---------------------------------------------------------------------------
+# Keyframe reduction
+# ---------------------------------------------------------------------------
+
+def _lerp(a: Vec, b: Vec, t: float) -> Vec:
+    return tuple(x + (y - x) * t for x, y in zip(a, b))
+
+
+def _slerp(a: Vec, b: Vec, t: float) -> Vec:
+    d = sum(x * y for x, y in zip(a, b))
+    if d < 0.0:
+        b, d = tuple(-y for y in b), -d
+    if d > 0.9995:
+        q = _lerp(a, b, t)
+    else:
+        th = math.acos(d)
+        s = math.sin(th)
+        wa, wb = math.sin((1.0 - t) * th) / s, math.sin(t * th) / s
+        q = tuple(wa * x + wb * y for x, y in zip(a, b))
+    n = math.sqrt(sum(x * x for x in q)) or 1.0
+    return tuple(x / n for x in q)
+
+
+def _pos_err(a: Vec, b: Vec) -> float:
+    return math.sqrt(sum((x - y) ** 2 for x, y in zip(a, b)))
+
+
+def _rot_err(a: Vec, b: Vec) -> float:
+    d = min(1.0, abs(sum(x * y for x, y in zip(a, b))))
+    return 2.0 * math.acos(d)
+
+
+def reduce_keys(times: Sequence[float], values: Sequence[Vec], tol: float,
+                rotation: bool = False) -> List[int]:
+    """Indices of the keys to keep (first and last always, if they differ)."""
+    n = len(values)
+    if n <= 1:
+        return list(range(n))
+    interp, err = (_slerp, _rot_err) if rotation else (_lerp, _pos_err)
+    if all(err(values[0], v) <= tol for v in values[1:]):
+        return [0]
+    kept = [0]
+    a = 0
+    j = 2
+    while j < n:
+        # Can keys a+1 .. j-1 be rebuilt from a and j?
+        span = times[j] - times[a]
+        ok = span > 0.0 and all(
+            err(interp(values[a], values[j], (times[k] - times[a]) / span), values[k]) <= tol
+            for k in range(a + 1, j))
+        if not ok:
+            a = j - 1
+            kept.append(a)
+        j += 1
+    kept.append(n - 1)
+    return kept
+
+
+def reduce_track(times: Sequence[float], values: Sequence[Vec], tol: float,
+                 rotation: bool = False) -> Track:
+    keys = reduce_keys(times, values, tol, rotation)
+    return Track(keys, [tuple(values[k]) for k in keys])
+
+
+# ---------------------------------------------------------------------------
+# Encode / parse
+# ---------------------------------------------------------------------------
+
+def _pad4(out: bytearray) -> None:
+    out += b"\0" * ((-len(out)) % 4)
+
+
+def _encode_clip(clip: Clip) -> bytes:
+    out = bytearray(struct.pack(f"<{len(clip.times)}f", *clip.times))
+    for trans, rot in clip.tracks:
+        n = len(trans.keys)
+        lo = [min(v[c] for v in trans.values) for c in range(3)]
+        hi = [max(v[c] for v in trans.values) for c in range(3)]
+        step = [(h - l) / 65535.0 for l, h in zip(lo, hi)]
+        q = [round((v[c] - lo[c]) / step[c]) if step[c] else 0
+             for v in trans.values for c in range(3)]
+        out += struct.pack("<HH6f", n, 0, *lo, *step)
+        out += struct.pack(f"<{n}H{3 * n}H", *trans.keys, *q)
+        _pad4(out)
+
+        n = len(rot.keys)
+        q = [max(-32767, min(32767, round(x * 32767.0))) for v in rot.values for x in v]
+        out += struct.pack(f"<HH{n}H{4 * n}h", n, 0, *rot.keys, *q)
+        _pad4(out)
+    return bytes(out)
+
+
+def encode(clips: Sequence[Clip], joints: int) -> bytes:
+    """Clip store bytes; every clip must carry ``joints`` track pairs."""
+    head = MAGIC + struct.pack("<HHHHI", VERSION, joints, len(clips), 0, 0)
+    bodies = [_encode_clip(c) for c in clips]
+    off = len(head) + 16 * len(clips)
+    table = bytearray()
+    for clip, body in zip(clips, bodies):
+        if len(clip.tracks) != joints:
+            raise ValueError(f"clip {clip.anim_id}: {len(clip.tracks)} tracks, expected {joints}")
+        table += struct.pack("<HHfII", clip.anim_id, len(clip.times), clip.duration, off, len(body))
+        off += len(body)
+    return head + bytes(table) + b"".join(bodies)
+
+
+def parse(data: bytes) -> Tuple[int, List[Clip]]:
+    """(joints, clips) from ``encode`` output; values are dequantized."""
+    if data[:4] != MAGIC:
+        raise ValueError("not a PCLP clip store")
+    version, joints, n_clips, _, _ = struct.unpack_from("<HHHHI", data, 4)
+    if version != VERSION:
+        raise ValueError(f"unsupported clip store version {version}")
+    clips = []
+    for i in range(n_clips):
+        aid, n_times, _dur, p, _size = struct.unpack_from("<HHfII", data, 16 + 16 * i)
+        times = list(struct.unpack_from(f"<{n_times}f", data, p))
+        p += 4 * n_times
+        clip = Clip(aid, times)
+        for _ in range(joints):
+            n, _ = struct.unpack_from("<HH", data, p)
+            base = struct.unpack_from("<3f", data, p + 4)
+            step = struct.unpack_from("<3f", data, p + 16)
+            p += 28
+            keys = list(struct.unpack_from(f"<{n}H", data, p))
+            q = struct.unpack_from(f"<{3 * n}H", data, p + 2 * n)
+            p += 8 * n + (-(28 + 8 * n)) % 4
+            trans = Track(keys, [tuple(base[c] + q[3 * k + c] * step[c] for c in range(3))
+                                 for k in range(n)])
+            n, _ = struct.unpack_from("<HH", data, p)
+            keys = list(struct.unpack_from(f"<{n}H", data, p + 4))
+            q = struct.unpack_from(f"<{4 * n}h", data, p + 4 + 2 * n)
+            p += 4 + 10 * n + (-(4 + 10 * n)) % 4
+            values = []
+            for k in range(n):
+                v = [x / 32767.0 for x in q[4 * k:4 * k + 4]]
+                s = math.sqrt(sum(x * x for x in v)) or 1.0
+                values.append(tuple(x / s for x in v))
+            clip.tracks.append((trans, Track(keys, values)))
+        clips.append(clip)
+    return joints, clips
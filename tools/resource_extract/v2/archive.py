@@ -0,0 +1,94 @@
+"""Memory-mapped, zero-copy access to the disc archives.
+
+Every BIN on the disc is read-only input, and the big ones (VOICE.BIN,
+the ~295 MB MCB1.BIN) used to be pulled into RAM with `f.read()` before a
+handful of entries were sliced out of them. Here each archive is mapped
+once and entries are handed out as `memoryview` slices of the mapping, so
+only the pages actually touched become resident.
+
+Lifetime: `map_file` closes the Python file object immediately (the mmap
+keeps its own descriptor). The mapping is released when the last view
+into it is dropped, so callers never need an explicit close.
+
+Users:
+    bin_toc.parse_toc / iter_entries   -> FlatArchive
+    mcb.extract / mcb.iter_bundles     -> map_file(MCB1.BIN)
+    mcb_bundle / mcb_unpack_all        -> map_file(<bundle>.bin)
+    target_picker                      -> mcb.iter_bundles
+"""
+from __future__ import annotations
+
+import mmap
+import struct
+from dataclasses import dataclass
+from typing import Iterator, List, Tuple
+
+SECTOR = 2048
+
+
+def map_file(path: str) -> memoryview:
+    """Map `path` read-only and return a byte view over the whole file."""
+    with open(path, "rb") as f:
+        try:
+            mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        except ValueError:
+            # Zero-length files cannot be mapped.
+            return memoryview(b"")
+    return memoryview(mm)
+
+
+@dataclass
+class Entry:
+    index: int
+    sector: int
+    byte_offset: int
+    size: int
+
+
+def decode_toc_word(index: int, raw: int) -> Entry:
+    """u32 TOC word: bits [0:17] = size in words, bits [17:32] = sector."""
+    words = raw & 0x1FFFF
+    sector = (raw >> 17) & 0x7FFF
+    return Entry(index, sector, sector * SECTOR, words * 4)
+
+
+class FlatArchive:
+    """A flat-TOC BIN (GRP / SCR / MAP / TEX / ITM / SND / VOICE), mapped.
+
+    The TOC is decoded on demand: `entry(i)` reads one u32, and iteration
+    walks the table without materialising it first.
+    """
+
+    def __init__(self, path: str):
+        self.path = path
+        self.view = map_file(path)
+        self.count = struct.unpack_from("<I", self.view, 0)[0] if len(self.view) >= 4 else 0
+
+    def __len__(self) -> int:
+        return self.count
+
+    def entry(self, index: int) -> Entry:
+        if not 0 <= index < self.count:
+            raise IndexError(index)
+        (raw,) = struct.unpack_from("<I", self.view, 4 + index * 4)
+        return decode_toc_word(index, raw)
+
+    def __iter__(self) -> Iterator[Entry]:
+        table = self.view[4:4 + self.count * 4]
+        for i, (raw,) in enumerate(struct.iter_unpack("<I", table)):
+            yield decode_toc_word(i, raw)
+
+    def entries(self) -> List[Entry]:
+        return list(self)
+
+    def payload(self, entry: Entry) -> memoryview:
+        """Zero-copy view of one entry's (still compressed) bytes."""
+        if entry.size == 0:
+            return self.view[0:0]
+        return self.view[entry.byte_offset:entry.byte_offset + entry.size]
+
+    def iter_payloads(self) -> Iterator[Tuple[Entry, memoryview]]:
+        """Yield (Entry, view) for each non-empty entry."""
+        for e in self:
+            if e.size:
+                yield e, self.payload(e)
@@ -8,60 +8,42 @@ Layout (from FUN_00223268 + FUN_00221b18 + baseline/extract_map_bin.py):
         bits [17:32] = sector offset (sector = 2048 bytes)
 
 Each entry's payload is usually headerless-LZ compressed (decoder at
-src/FUN_002f3118.c; Python port at baseline/lz_decoder.py).  A few entries are
+src/FUN_002f3118.c; Python port at baseline/lz_decoder.py, fast path in lz.py).  A few entries are
 empty (size == 0).
 
 No knowledge of per-entry format is baked in here — decompression + magic
 dispatch happens in `extract_all.py`.
+
+The archive is memory-mapped (see archive.py): `parse_toc` returns a view
+over the whole file and `read_entry` / `iter_entries` hand out zero-copy
+slices of it.
 """
 from __future__ import annotations
 
 import os
-import struct
-from dataclasses import dataclass
-from typing import List, Tuple
-
-SECTOR = 2048
-
+from typing import Iterator, List, Tuple
 
-@dataclass
-class Entry:
-    index: int
-    sector: int
-    byte_offset: int
-    size: int
+from .archive import SECTOR, Entry, FlatArchive  # noqa: F401  (re-exported)
 
 
-def parse_toc(path: str) -> Tuple[bytes, List[Entry]]:
-    with open(path, "rb") as f:
-        data = f.read()
-    (count,) = struct.unpack_from("<I", data, 0)
-    entries: List[Entry] = []
-    for i in range(count):
-        (raw,) = struct.unpack_from("<I", data, 4 + i * 4)
-        words = raw & 0x1FFFF
-        sector = (raw >> 17) & 0x7FFF
-        entries.append(Entry(i, sector, sector * SECTOR, words * 4))
-    return data, entries
+def parse_toc(path: str) -> Tuple[memoryview, List[Entry]]:
+    arc = FlatArchive(path)
+    return arc.view, arc.entries()
 
 
-def read_entry(buf: bytes, entry: Entry) -> bytes:
+def read_entry(buf: memoryview | bytes, entry: Entry) -> memoryview | bytes:
     if entry.size == 0:
         return b""
     return buf[entry.byte_offset : entry.byte_offset + entry.size]
 
 
-def iter_entries(path: str):
-    """Yield (Entry, raw_bytes) for each non-empty entry in a BIN."""
-    data, entries = parse_toc(path)
-    for e in entries:
-        if e.size == 0:
-            continue
-        yield e, read_entry(data, e)
+def iter_entries(path: str) -> Iterator[Tuple[Entry, memoryview]]:
+    """Yield (Entry, raw_view) for each non-empty entry in a BIN."""
+    yield from FlatArchive(path).iter_payloads()
 
 
 def summarize(path: str) -> None:
-    data, entries = parse_toc(path)
+    entries = FlatArchive(path).entries()
     non_empty = [e for e in entries if e.size > 0]
     total = sum(e.size for e in non_empty)
     print(f"{os.path.basename(path)}: {len(entries)} entries "
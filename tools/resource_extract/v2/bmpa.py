@@ -27,7 +27,7 @@ from dataclasses import dataclass
 from pathlib import Path
 import struct
 import zlib
-from typing import Iterable
+from typing import Iterable, Optional, Tuple
 
 
 MAGIC = b"BMPA"
@@ -61,35 +61,32 @@ def to_rgba(img: BmpaImage) -> bytes:
 
     Palette bytes are stored as B, G, R, A (PS2 GS-style), so we swap the
     first and third channels on the way out.
+
+    Each output channel is one ``bytes.translate`` of the index plane
+    through that channel's 256-byte column of the palette, written with a
+    strided slice, so the per-pixel work stays in C.
     """
     out = bytearray(img.width * img.height * 4)
     pal = img.palette
     idx = img.indices
-    for i, v in enumerate(idx):
-        o = i * 4
-        p = v * 4
-        out[o]     = pal[p + 2]  # R <- B
-        out[o + 1] = pal[p + 1]  # G
-        out[o + 2] = pal[p]      # B <- R
-        out[o + 3] = pal[p + 3]  # A
+    for dst, src in ((0, 2), (1, 1), (2, 0), (3, 3)):  # R <- B, G, B <- R, A
+        out[dst::4] = idx.translate(pal[src::4])
     return bytes(out)
 
 
-def write_png(img: BmpaImage, path: str | Path) -> None:
-    """Write `img` as an RGBA PNG (uses only the stdlib).
+def flip_rows(rgba: bytes, width: int, height: int) -> bytes:
+    """Reverse the row order of an RGBA8888 buffer."""
+    stride = width * 4
+    return b"".join(rgba[y * stride : (y + 1) * stride] for y in range(height - 1, -1, -1))
+
+
+def to_png_rgba(img: BmpaImage) -> bytes:
+    """RGBA8888 in PNG row order (right side up; see ``write_png``)."""
+    return flip_rows(to_rgba(img), img.width, img.height)
 
-    The pixel grid is flipped vertically on write: BMPA files store rows
-    bottom-up (PS2 GS convention), so the raw index buffer renders upside
-    down. Flipping here gives right-side-up PNGs.
-    """
-    rgba = to_rgba(img)
 
-    raw = bytearray()
-    stride = img.width * 4
-    for y in range(img.height):
-        raw.append(0)  # filter type None
-        src_y = img.height - 1 - y
-        raw.extend(rgba[src_y * stride : (src_y + 1) * stride])
+def encode_png(width: int, height: int, rgba: bytes, level: int = 6) -> bytes:
+    """RGBA8888 rows (top row first) -> PNG file bytes, filter type None."""
 
     def _chunk(tag: bytes, data: bytes) -> bytes:
         return (
@@ -99,10 +96,55 @@ def write_png(img: BmpaImage, path: str | Path) -> None:
             + struct.pack(">I", zlib.crc32(tag + data) & 0xFFFFFFFF)
         )
 
-    ihdr = struct.pack(">IIBBBBB", img.width, img.height, 8, 6, 0, 0, 0)
-    idat = zlib.compress(bytes(raw), 6)
-    png = b"\x89PNG\r\n\x1a\n" + _chunk(b"IHDR", ihdr) + _chunk(b"IDAT", idat) + _chunk(b"IEND", b"")
-    Path(path).write_bytes(png)
+    stride = width * 4
+    raw = b"".join(b"\x00" + rgba[y * stride : (y + 1) * stride] for y in range(height))
+    ihdr = struct.pack(">IIBBBBB", width, height, 8, 6, 0, 0, 0)
+    idat = zlib.compress(raw, level)
+    return b"\x89PNG\r\n\x1a\n" + _chunk(b"IHDR", ihdr) + _chunk(b"IDAT", idat) + _chunk(b"IEND", b"")
+
+
+def read_png_rgba(data: bytes) -> Optional[Tuple[int, int, bytes]]:
+    """(width, height, RGBA8888 rows) for PNGs in the ``encode_png`` form.
+
+    Only 8-bit RGBA, non-interlaced, all rows filter type None -- i.e.
+    what this module writes. Anything else returns None so callers can
+    fall back to the loose file.
+    """
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        return None
+    pos = 8
+    width = height = 0
+    idat = []
+    while pos + 8 <= len(data):
+        length, tag = struct.unpack_from(">I4s", data, pos)
+        body = data[pos + 8 : pos + 8 + length]
+        pos += 12 + length
+        if tag == b"IHDR":
+            width, height, depth, ctype, _, _, interlace = struct.unpack(">IIBBBBB", body)
+            if (depth, ctype, interlace) != (8, 6, 0):
+                return None
+        elif tag == b"IDAT":
+            idat.append(body)
+        elif tag == b"IEND":
+            break
+    try:
+        raw = zlib.decompress(b"".join(idat))
+    except zlib.error:
+        return None
+    stride = width * 4 + 1
+    if not width or len(raw) != stride * height or any(raw[y * stride] for y in range(height)):
+        return None
+    return width, height, b"".join(raw[y * stride + 1 : (y + 1) * stride] for y in range(height))
+
+
+def write_png(img: BmpaImage, path: str | Path) -> None:
+    """Write `img` as an RGBA PNG (uses only the stdlib).
+
+    The pixel grid is flipped vertically on write: BMPA files store rows
+    bottom-up (PS2 GS convention), so the raw index buffer renders upside
+    down. Flipping here gives right-side-up PNGs.
+    """
+    Path(path).write_bytes(encode_png(img.width, img.height, to_png_rgba(img)))
 
 
 # ---------------------------------------------------------------------------
@@ -0,0 +1,184 @@
+"""Dependency records for incremental exports (``--incremental``).
+
+Every export stage (``extract_all``, ``mcb_unpack_all``, ``psm2_gltf``,
+``psc3_export_all``) rewrites its whole output tree on each run. With
+``--incremental`` a stage keeps ``<dst>/_build.json``:
+
+    {"version": 1,
+     "targets": {<key>: {"inputs":  {<name>: <digest>, ...},
+                         "outputs": [<path relative to dst>, ...],
+                         "meta":    {...}}},
+     "files":   {<abs path>: [size, mtime_ns, <digest>]}}
+
+A target is fresh when the inputs it would be built from now hash to the
+recorded digests and every recorded output still exists; the stage then
+skips it and reuses ``meta`` (stats, index entries) in its summary.
+
+Inputs are whatever the artifact is derived from: the compressed entry or
+record bytes, the source file, sidecar tables like ``grp_tex_map.json``,
+the option flags, and the exporter's own code. ``code_version`` hashes a
+module's source together with every module of this package it imports
+(transitively), so editing ``psc3_anim_decode.py`` invalidates the models
+but no map, and editing ``psm2.py`` invalidates the maps but no model.
+
+``files`` caches file digests by (size, mtime_ns), so an unchanged
+source tree is stat'ed rather than re-read.
+"""
+from __future__ import annotations
+
+import ast
+import hashlib
+import json
+import os
+from functools import lru_cache
+from typing import Dict, Iterable, List, Optional, Sequence
+
+STATE_NAME = "_build.json"
+STATE_VERSION = 1
+
+_PKG_DIR = os.path.dirname(os.path.abspath(__file__))
+_SELF = __name__.rsplit(".", 1)[-1]
+
+
+def digest_bytes(data) -> str:
+    return hashlib.blake2b(data, digest_size=16).hexdigest()
+
+
+# ---------------------------------------------------------------------------
+# Code versions
+# ---------------------------------------------------------------------------
+
+@lru_cache(maxsize=None)
+def _module_source(name: str) -> Optional[bytes]:
+    try:
+        with open(os.path.join(_PKG_DIR, name + ".py"), "rb") as f:
+            return f.read()
+    except OSError:
+        return None
+
+
+@lru_cache(maxsize=None)
+def _module_deps(name: str) -> tuple:
+    """Sibling modules ``name`` imports with ``from . import x`` /
+    ``from .x import y`` (function-level imports included). This module
+    is left out: it decides what gets rebuilt, not what is written."""
+    src = _module_source(name)
+    if src is None:
+        return ()
+    deps = set()
+    for node in ast.walk(ast.parse(src)):
+        if isinstance(node, ast.ImportFrom) and node.level == 1:
+            for cand in ([node.module] if node.module else [a.name for a in node.names]):
+                if cand != _SELF and _module_source(cand) is not None:
+                    deps.add(cand)
+    return tuple(sorted(deps))
+
+
+@lru_cache(maxsize=None)
+def code_version(*modules: str, shallow: Sequence[str] = ()) -> str:
+    """Digest of ``modules`` and everything they import from this package,
+    plus the source of each ``shallow`` module alone (its imports are
+    left out, for drivers whose per-target dependencies are listed
+    explicitly)."""
+    seen = set()
+    todo = list(modules)
+    while todo:
+        name = todo.pop()
+        if name not in seen:
+            seen.add(name)
+            todo.extend(_module_deps(name))
+    seen.update(shallow)
+    h = hashlib.blake2b(digest_size=16)
+    for name in sorted(seen):
+        h.update(name.encode() + b"\0" + (_module_source(name) or b"") + b"\0")
+    return h.hexdigest()
+
+
+# ---------------------------------------------------------------------------
+# Build state
+# ---------------------------------------------------------------------------
+
+class BuildState:
+    """``<root>/_build.json``; a disabled state never reports a target fresh
+    and never writes (the stages' default full-rebuild mode)."""
+
+    def __init__(self, root: str, enabled: bool = True):
+        self.root = os.path.abspath(root)
+        self.path = os.path.join(self.root, STATE_NAME)
+        self.enabled = enabled
+        self.targets: Dict[str, dict] = {}
+        self.files: Dict[str, list] = {}
+        self.fresh = 0
+        self.built = 0
+        if enabled:
+            try:
+                with open(self.path, "r", encoding="utf-8") as f:
+                    state = json.load(f)
+                if state.get("version") == STATE_VERSION:
+                    self.targets = state.get("targets", {})
+                    self.files = state.get("files", {})
+            except (OSError, ValueError):
+                pass
+
+    def file_digest(self, path: str) -> str:
+        """Content digest of ``path`` ("-" if missing), cached by stat."""
+        path = os.path.abspath(path)
+        try:
+            st = os.stat(path)
+        except OSError:
+            return "-"
+        hit = self.files.get(path)
+        if hit and hit[0] == st.st_size and hit[1] == st.st_mtime_ns:
+            return hit[2]
+        h = hashlib.blake2b(digest_size=16)
+        with open(path, "rb") as f:
+            for block in iter(lambda: f.read(1 << 20), b""):
+                h.update(block)
+        self.files[path] = [st.st_size, st.st_mtime_ns, h.hexdigest()]
+        return h.hexdigest()
+
+    def files_digest(self, paths: Iterable[str]) -> str:
+        """One digest over several files (names and contents)."""
+        h = hashlib.blake2b(digest_size=16)
+        for p in sorted(paths):
+            h.update(f"{os.path.basename(p)}={self.file_digest(p)};".encode())
+        return h.hexdigest()
+
+    def meta(self, key: str) -> Optional[dict]:
+        rec = self.targets.get(key)
+        return rec.get("meta", {}) if rec else None
+
+    def check(self, key: str, inputs: Dict[str, str]) -> Optional[dict]:
+        """The target's recorded meta if it is fresh, else None."""
+        if not self.enabled:
+            return None
+        rec = self.targets.get(key)
+        if (rec is None or rec["inputs"] != inputs
+                or not all(os.path.exists(os.path.join(self.root, o)) for o in rec["outputs"])):
+            return None
+        self.fresh += 1
+        return rec.get("meta", {})
+
+    def record(self, key: str, inputs: Dict[str, str], outputs: Iterable[str],
+               meta: Optional[dict] = None) -> None:
+        self.built += 1
+        if not self.enabled:
+            return
+        rel: List[str] = [os.path.relpath(os.path.abspath(o), self.root) for o in outputs]
+        self.targets[key] = {"inputs": inputs, "outputs": rel, "meta": meta or {}}
+
+    def forget(self, key: str) -> None:
+        self.targets.pop(key, None)
+
+    def save(self) -> None:
+        if not self.enabled:
+            return
+        os.makedirs(self.root, exist_ok=True)
+        tmp = self.path + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            json.dump({"version": STATE_VERSION, "targets": self.targets,
+                       "files": self.files}, f, separators=(",", ":"))
+        os.replace(tmp, self.path)
+
+    def summary(self) -> str:
+        return f"{self.built} rebuilt, {self.fresh} up to date"
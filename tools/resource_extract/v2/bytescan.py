@@ -0,0 +1,269 @@
+"""Find many byte patterns in one pass over buffers, files and directories.
+
+A pattern is hex bytes with optional wildcards, spaces allowed:
+
+    "50 53 4D 32"     literal bytes
+    "0B 04 ?? ??"     `??` matches any byte
+    "3? ?F"           `?` in one nibble leaves that nibble free
+
+or one of the MAGICS names (PSM2, PSC3, PSB4, BMPA, SUBPROC). `Scanner`
+compiles every pattern into a single alternation, so the `re` engine
+walks the data once whatever the number of patterns, skipping straight
+to bytes that can start one of them; each hit is then checked against
+the patterns that can begin with that byte, so overlapping hits (a
+pattern starting inside another's match) are all reported, exactly as a
+`buf.find(needle, i + 1)` loop per pattern would.
+
+Files are mapped with archive.map_file and never read through Python.
+`scan_paths` splits them into SPAN-byte ranges (overlapping by the
+longest pattern, so no hit is lost at a seam) and scans the ranges over
+`jobs` worker processes; `re` holds the GIL, so threads would not scale.
+
+Usage:
+    python -m tools.resource_extract.v2.bytescan --magic all --jobs 0 ISO_DIR
+    python -m tools.resource_extract.v2.bytescan --hex "0B 04 ?? ?? 00 00" MCB1.BIN
+
+Output is one JSON line per hit: {"path", "offset", "pattern"}.
+"""
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import re
+import sys
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import dataclass
+from typing import Dict, Iterable, Iterator, List, Optional, Sequence, Tuple, Union
+
+from .archive import map_file
+
+MAGICS = {
+    "PSM2": "50 53 4D 32",
+    "PSC3": "50 53 43 33",
+    "PSB4": "50 53 42 34",
+    "BMPA": "42 4D 50 41",
+    # SCR subproc prologue `0B 04 <id16> 00 00` (analyzed/scr_decode.py).
+    "SUBPROC": "0B 04 ?? ??",
+}
+
+SPAN = 64 << 20
+
+PatternSpec = Union[str, Tuple[str, str]]
+"""Hex text or MAGICS name (named after itself), or (name, hex text)."""
+
+
+@dataclass(frozen=True)
+class Pattern:
+    name: str
+    text: str
+    regex: bytes
+    """`re` source matching exactly the pattern's bytes."""
+    length: int
+    first: Optional[int]
+    """Fixed first byte, or None when the first byte has a wildcard."""
+
+
+def _nibble_class(tok: str) -> bytes:
+    hi, lo = tok[0], tok[1]
+    values = [h << 4 | l
+              for h in (range(16) if hi == "?" else (int(hi, 16),))
+              for l in (range(16) if lo == "?" else (int(lo, 16),))]
+    return b"[" + b"".join(b"\\x%02x" % v for v in values) + b"]"
+
+
+def parse_pattern(text: str, name: Optional[str] = None) -> Pattern:
+    """Compile hex text (with `?` wildcards) or a MAGICS name to a Pattern."""
+    if name is None:
+        name = text
+    text = MAGICS.get(text.upper(), text)
+    digits = re.sub(r"[\s_-]", "", text)
+    if not digits or len(digits) % 2:
+        raise ValueError(f"pattern {name!r}: need an even number of hex digits / '?'")
+    parts: List[bytes] = []
+    first: Optional[int] = None
+    for i in range(0, len(digits), 2):
+        tok = digits[i:i + 2]
+        if tok == "??":
+            parts.append(b".")
+        elif "?" in tok:
+            parts.append(_nibble_class(tok))
+        else:
+            try:
+                v = int(tok, 16)
+            except ValueError:
+                raise ValueError(f"pattern {name!r}: bad byte {tok!r}") from None
+            parts.append(re.escape(bytes([v])))
+            if i == 0:
+                first = v
+    return Pattern(name, text, b"".join(parts), len(digits) // 2, first)
+
+
+class Scanner:
+    """One-pass search for a fixed set of patterns."""
+
+    def __init__(self, patterns: Iterable[PatternSpec]):
+        self.patterns: List[Pattern] = []
+        for spec in patterns:
+            if isinstance(spec, tuple):
+                self.patterns.append(parse_pattern(spec[1], spec[0]))
+            else:
+                self.patterns.append(parse_pattern(spec))
+        if not self.patterns:
+            raise ValueError("no patterns")
+        self.max_length = max(p.length for p in self.patterns)
+        self._rx = re.compile(b"|".join(p.regex for p in self.patterns), re.DOTALL)
+        self._match = [re.compile(p.regex, re.DOTALL).match for p in self.patterns]
+        # Candidates per first byte, in pattern order.
+        anywhere = [i for i, p in enumerate(self.patterns) if p.first is None]
+        self._by_first: List[List[int]] = [
+            sorted(anywhere + [i for i, p in enumerate(self.patterns) if p.first == b])
+            for b in range(256)]
+
+    def scan(self, buf, start: int = 0, end: Optional[int] = None) -> Iterator[Tuple[int, int]]:
+        """Yield (offset, pattern index) for every hit starting in
+        [start, end), by offset then pattern order. Hits may run past
+        `end` but not past the buffer."""
+        n = len(buf)
+        if end is None or end > n:
+            end = n
+        limit = min(n, end + self.max_length - 1)
+        search, match, by_first = self._rx.search, self._match, self._by_first
+        pos = start
+        while True:
+            m = search(buf, pos, limit)
+            if m is None:
+                return
+            off = m.start()
+            if off >= end:
+                return
+            for i in by_first[buf[off]]:
+                if match[i](buf, off, limit):
+                    yield off, i
+            pos = off + 1
+
+    def find_all(self, buf) -> Dict[str, List[int]]:
+        """Every hit offset, per pattern name (all names present)."""
+        out: Dict[str, List[int]] = {p.name: [] for p in self.patterns}
+        names = [p.name for p in self.patterns]
+        for off, i in self.scan(buf):
+            out[names[i]].append(off)
+        return out
+
+
+_SCANNERS: Dict[Tuple[PatternSpec, ...], Scanner] = {}
+
+
+def scanner_for(*patterns: PatternSpec) -> Scanner:
+    """Scanner over `patterns`, compiled once per process."""
+    sc = _SCANNERS.get(patterns)
+    if sc is None:
+        sc = _SCANNERS[patterns] = Scanner(patterns)
+    return sc
+
+
+def find_all(buf, pattern: str) -> List[int]:
+    """Offsets of every (overlapping) hit of one pattern in `buf`."""
+    return [off for off, _ in scanner_for(pattern).scan(buf)]
+
+
+# ---------------------------------------------------------------------------
+# Files
+
+def iter_files(paths: Sequence[str]) -> Iterator[str]:
+    for p in paths:
+        if os.path.isfile(p):
+            yield p
+        elif os.path.isdir(p):
+            for root, dirs, files in os.walk(p):
+                dirs.sort()
+                for f in sorted(files):
+                    yield os.path.join(root, f)
+
+
+def _spans(paths: Sequence[str], span: int) -> List[Tuple[str, int, int]]:
+    out = []
+    for path in iter_files(paths):
+        try:
+            size = os.path.getsize(path)
+        except OSError:
+            continue
+        for start in range(0, max(size, 1), span):
+            out.append((path, start, min(size, start + span)))
+    return out
+
+
+def _scan_span(specs: Tuple[Tuple[str, str], ...], path: str,
+               start: int, end: int) -> List[Tuple[int, int]]:
+    sc = scanner_for(*specs)
+    try:
+        buf = map_file(path)
+    except OSError:
+        return []
+    return list(sc.scan(buf, start, end))
+
+
+def scan_paths(paths: Sequence[str], patterns: Sequence[PatternSpec], *,
+               jobs: int = 1, span: int = SPAN) -> Iterator[Tuple[str, int, str]]:
+    """Yield (path, offset, pattern name) for every hit in every file under
+    `paths`, in file then offset order, over `jobs` worker processes
+    (0 = all cores). Unreadable files are skipped."""
+    sc = Scanner(patterns)
+    specs = tuple((p.name, p.text) for p in sc.patterns)
+    names = [p.name for p in sc.patterns]
+    tasks = _spans(paths, span)
+    if jobs == 1 or len(tasks) < 2:
+        results: Iterable = (_scan_span(specs, *t) for t in tasks)
+        for (path, _, _), hits in zip(tasks, results):
+            for off, i in hits:
+                yield path, off, names[i]
+        return
+    with ProcessPoolExecutor(max_workers=jobs or None) as pool:
+        results = pool.map(_scan_span, *zip(*[(specs,) + t for t in tasks]))
+        for (path, _, _), hits in zip(tasks, results):
+            for off, i in hits:
+                yield path, off, names[i]
+
+
+# ---------------------------------------------------------------------------
+# CLI
+
+def main(argv: List[str] | None = None) -> int:
+    ap = argparse.ArgumentParser(description="Find byte patterns in files (one pass for all patterns)")
+    ap.add_argument("paths", nargs="+", help="Files / directories to scan")
+    ap.add_argument("--hex", action="append", default=[],
+                    help="Hex pattern, '??' / '?' wildcards allowed (repeatable)")
+    ap.add_argument("--magic", action="append", default=[],
+                    help=f"Named pattern: {', '.join(MAGICS)} or 'all' (repeatable)")
+    ap.add_argument("--jobs", type=int, default=1, help="Worker processes (0 = all cores)")
+    ap.add_argument("--count", action="store_true", help="Print hit counts per pattern instead of hits")
+    args = ap.parse_args(argv)
+
+    specs: List[PatternSpec] = list(args.hex)
+    for m in args.magic:
+        names = list(MAGICS) if m.lower() == "all" else [m.upper()]
+        for n in names:
+            if n not in MAGICS:
+                ap.error(f"unknown magic {m!r}")
+            specs.append((n, MAGICS[n]))
+    if not specs:
+        ap.error("give at least one --hex or --magic")
+    try:
+        hits = scan_paths(args.paths, specs, jobs=args.jobs)
+        counts: Dict[str, int] = {}
+        for path, off, name in hits:
+            counts[name] = counts.get(name, 0) + 1
+            if not args.count:
+                print(json.dumps({"path": path, "offset": off, "pattern": name}))
+    except ValueError as e:
+        ap.error(str(e))
+    if args.count:
+        for name, n in counts.items():
+            print(f"{name:>24}: {n}")
+    sys.stdout.flush()
+    # Non-zero exit indicates no matches (useful for scripts).
+    return 0 if counts else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,221 @@
+"""Content-addressed cache of LZ-decoded payloads, shared by the extract tools.
+
+`extract_all`, `mcb_bundle`, `mcb_unpack_all` and `target_picker` all
+LZ-decode the same BIN entries and MCB1 records on every run. With
+`--cache DIR` they look each compressed payload up here first.
+
+Store layout (one directory):
+
+    blobs.pack   every decoded payload, back to back (append-only)
+    index.jsonl  one JSON object per stored payload:
+                   {"k": <blake2b-128 of the decoder version + the
+                          COMPRESSED bytes, hex>,
+                    "o": <offset in blobs.pack>, "n": <decoded size>,
+                    "m": <metadata, see describe()>}
+
+Hits are served as zero-copy views into a read-only mapping of
+`blobs.pack` (archive.map_file), so a warm run does no decoding and no
+copying. Appends take an exclusive `flock` (where available) so the
+`extract_all --jobs` workers can share one store; a payload decoded by two
+workers at once is simply stored twice and the later index line wins.
+A crash between the blob write and the index line leaves unreferenced
+bytes in the pack, never a dangling index entry; a torn index line is
+skipped on load, and the next append starts on a fresh line.
+
+The decoder version (build_graph.code_version of lz.py and this module)
+is part of every key, so a decoder fix misses on every old entry instead
+of serving a stale decode. Old entries stay in the pack as dead bytes;
+delete the directory to reclaim them. An index without its pack is
+treated as an empty cache.
+
+Metadata per payload, computed once at insert time:
+    kind      psm2 / psc3 / psb4 / bmpa / bin
+    sections  header section offsets for the mesh formats (same field
+              names as psm2.parse_psm2 / psc3_full.parse_psc3_full /
+              psb4.parse_psb4)
+"""
+from __future__ import annotations
+
+import argparse
+import hashlib
+import json
+import os
+import struct
+import sys
+from collections import Counter
+from functools import lru_cache
+from typing import Callable, Dict, Optional, Tuple
+
+from .archive import map_file
+from .build_graph import code_version
+from .lz import decode_bytes as lz_decode
+
+try:
+    import fcntl
+except ImportError:  # Windows: single-writer use only.
+    fcntl = None  # type: ignore
+
+PACK_NAME = "blobs.pack"
+INDEX_NAME = "index.jsonl"
+
+# Header u32 fields per mesh magic (name, offset).
+_SECTION_FIELDS = {
+    b"PSM2": (("A", 0x04), ("C", 0x08), ("D", 0x0C), ("E", 0x14), ("B", 0x30)),
+    b"PSC3": (("offs_submeshes", 0x08), ("offs_u0c", 0x0C),
+              ("offs_section_a", 0x10), ("offs_vertices", 0x14),
+              ("offs_vertex_bytes", 0x18), ("offs_primitives", 0x1C),
+              ("offs_colors", 0x20), ("offs_materials", 0x24),
+              ("offs_normals", 0x28), ("offs_section_b", 0x2C)),
+    b"PSB4": (("offs_a", 0x04), ("offs_b", 0x08), ("offs_c", 0x0C)),
+}
+_KINDS = {b"PSM2": "psm2", b"PSC3": "psc3", b"PSB4": "psb4", b"BMPA": "bmpa"}
+
+
+@lru_cache(maxsize=None)
+def decoder_version() -> bytes:
+    return code_version("lz", "decode_cache").encode()
+
+
+def payload_key(payload: bytes | memoryview) -> str:
+    h = hashlib.blake2b(decoder_version(), digest_size=16)
+    h.update(payload)
+    return h.hexdigest()
+
+
+def describe(decoded: bytes | memoryview) -> dict:
+    """Magic kind plus header section offsets for the mesh formats."""
+    magic = bytes(decoded[:4])
+    meta: dict = {"kind": _KINDS.get(magic, "bin")}
+    fields = _SECTION_FIELDS.get(magic)
+    if fields and len(decoded) >= max(o for _n, o in fields) + 4:
+        meta["sections"] = {name: struct.unpack_from("<I", decoded, o)[0]
+                            for name, o in fields}
+    return meta
+
+
+class DecodeCache:
+    def __init__(self, root: str):
+        self.root = root
+        os.makedirs(root, exist_ok=True)
+        self.pack_path = os.path.join(root, PACK_NAME)
+        self.index_path = os.path.join(root, INDEX_NAME)
+        self.index: Dict[str, Tuple[int, int, dict]] = {}
+        self._view = memoryview(b"")
+        self.hits = 0
+        self.misses = 0
+        self._load_index()
+
+    def _load_index(self) -> None:
+        if not os.path.exists(self.index_path):
+            return
+        if not os.path.exists(self.pack_path):
+            # Offsets into a pack that is gone; start over.
+            open(self.index_path, "w").close()
+            return
+        pack_size = os.path.getsize(self.pack_path)
+        with open(self.index_path, "r", encoding="utf-8") as f:
+            for line in f:
+                try:
+                    rec = json.loads(line)
+                    key, off, size, meta = rec["k"], rec["o"], rec["n"], rec["m"]
+                except (ValueError, KeyError, TypeError):
+                    continue  # torn line from an interrupted run
+                if off + size <= pack_size:
+                    self.index[key] = (off, size, meta)
+
+    def _blob(self, off: int, size: int) -> memoryview:
+        if off + size > len(self._view):
+            # Another writer (or we) appended since the last mapping.
+            self._view = map_file(self.pack_path)
+        return self._view[off:off + size]
+
+    def __len__(self) -> int:
+        return len(self.index)
+
+    def get(self, payload: bytes | memoryview) -> Optional[Tuple[memoryview, dict]]:
+        hit = self.index.get(payload_key(payload))
+        if hit is None:
+            return None
+        off, size, meta = hit
+        return self._blob(off, size), meta
+
+    def put(self, payload: bytes | memoryview, decoded: bytes | memoryview) -> dict:
+        key = payload_key(payload)
+        meta = describe(decoded)
+        with open(self.pack_path, "ab") as fp, open(self.index_path, "a+b") as fi:
+            if fcntl is not None:
+                fcntl.flock(fp, fcntl.LOCK_EX)
+            try:
+                off = fp.seek(0, os.SEEK_END)
+                fp.write(decoded)
+                fp.flush()
+                line = json.dumps({"k": key, "o": off, "n": len(decoded), "m": meta}) + "\n"
+                if fi.seek(0, os.SEEK_END):
+                    fi.seek(-1, os.SEEK_END)
+                    if fi.read(1) != b"\n":
+                        line = "\n" + line  # don't glue onto a torn line
+                fi.write(line.encode("utf-8"))
+                fi.flush()
+            finally:
+                if fcntl is not None:
+                    fcntl.flock(fp, fcntl.LOCK_UN)
+        self.index[key] = (off, len(decoded), meta)
+        return meta
+
+    def lookup(self, payload: bytes | memoryview) -> Tuple[bytes | memoryview, dict]:
+        """Decoded payload + metadata, decoding and storing on a miss.
+
+        LZ errors propagate and nothing is stored, so callers keep their
+        existing `lz_fail` handling.
+        """
+        hit = self.get(payload)
+        if hit is not None:
+            self.hits += 1
+            return hit
+        self.misses += 1
+        decoded = lz_decode(payload)
+        meta = self.put(payload, decoded)
+        return decoded, meta
+
+    def decode(self, payload: bytes | memoryview) -> bytes | memoryview:
+        return self.lookup(payload)[0]
+
+
+@lru_cache(maxsize=None)
+def open_cache(root: str) -> DecodeCache:
+    """One DecodeCache per directory per process."""
+    return DecodeCache(root)
+
+
+def decoder(cache_dir: Optional[str]) -> Callable[[bytes | memoryview], bytes | memoryview]:
+    """`lz.decode_bytes`, or the cached equivalent when `cache_dir` is set."""
+    if not cache_dir:
+        return lz_decode
+    return open_cache(cache_dir).decode
+
+
+# ---------------------------------------------------------------------------
+# CLI
+# ---------------------------------------------------------------------------
+
+def main(argv: list[str] | None = None) -> int:
+    ap = argparse.ArgumentParser(description="Inspect a decoded-payload cache")
+    ap.add_argument("cache", help="Cache directory (as passed to --cache)")
+    args = ap.parse_args(argv)
+
+    cache = DecodeCache(args.cache)
+    kinds: Counter = Counter()
+    total = 0
+    for _off, size, meta in cache.index.values():
+        kinds[meta.get("kind", "bin")] += 1
+        total += size
+    pack = os.path.getsize(cache.pack_path) if os.path.exists(cache.pack_path) else 0
+    print(f"{args.cache}: {len(cache)} payloads, {total:,} decoded bytes "
+          f"({pack:,} bytes in {PACK_NAME})")
+    for k, v in kinds.most_common():
+        print(f"  {k:<5} {v}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
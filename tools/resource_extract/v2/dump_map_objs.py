@@ -11,6 +11,10 @@ that yielded no geometry) plus a short stats dump at the end.
 
 All three parsers are the pristine v2 implementations — they already validate
 against MAP.BIN output of the game's own loaders.
+
+Each file is one task; ``--jobs N`` spreads them over N worker processes
+(0 = one per core). Vertex and normal blocks are formatted in one pass
+each rather than line by line.
 """
 from __future__ import annotations
 
@@ -18,6 +22,8 @@ import argparse
 import os
 import sys
 from collections import Counter
+from concurrent.futures import ProcessPoolExecutor
+from itertools import chain
 
 from . import psm2 as psm2_mod
 from . import psc3 as psc3_mod
@@ -28,64 +34,64 @@ def _write_obj(path: str, name: str,
                positions, normals, primitives) -> bool:
     if not positions or not primitives:
         return False
+    out = [f"# {name}\n",
+           f"# v={len(positions)} n={len(normals)} f={len(primitives)}\n",
+           f"o {name}\n",
+           # Remap PS2 (x, y, z) -> (x, z, -y) so Z-up becomes Y-up.
+           ("v %.6f %.6f %.6f\n" * len(positions))
+           % tuple(chain.from_iterable((x, z, -y) for x, y, z in positions)),
+           ("vn %.6f %.6f %.6f\n" * len(normals))
+           % tuple(chain.from_iterable((x, z, -y) for x, y, z in normals))]
+    for prim in primitives:
+        # Triangle strip style: prims with 3 unique indices -> tri
+        # (v0, v1, v2, v3); if v2 == v3 we have a triangle.
+        a, b, c, *_ = prim
+        d = prim[3] if len(prim) > 3 else c
+        if c == d:
+            out.append(f"f {a+1} {b+1} {c+1}\n")
+        else:
+            out.append(f"f {a+1} {b+1} {c+1} {d+1}\n")
     with open(path, "w") as f:
-        f.write(f"# {name}\n")
-        f.write(f"# v={len(positions)} n={len(normals)} f={len(primitives)}\n")
-        f.write(f"o {name}\n")
-        for x, y, z in positions:
-            # Remap PS2 (x, y, z) -> (x, z, -y) so Z-up becomes Y-up.
-            f.write(f"v {x:.6f} {z:.6f} {-y:.6f}\n")
-        for nx, ny, nz in normals:
-            f.write(f"vn {nx:.6f} {nz:.6f} {-ny:.6f}\n")
-        for prim in primitives:
-            # Triangle strip style: prims with 3 unique indices -> tri
-            # (v0, v1, v2, v3); if v2 == v3 we have a triangle.
-            a, b, c, *_ = prim
-            d = prim[3] if len(prim) > 3 else c
-            if c == d:
-                f.write(f"f {a+1} {b+1} {c+1}\n")
-            else:
-                f.write(f"f {a+1} {b+1} {c+1} {d+1}\n")
+        f.write("".join(out))
     return True
 
 
-def run(src: str, dst: str) -> None:
-    os.makedirs(dst, exist_ok=True)
-    stats = Counter()
-    for fn in sorted(os.listdir(src)):
-        path = os.path.join(src, fn)
-        stem, ext = os.path.splitext(fn)
-        buf = open(path, "rb").read()
-        out_name = None
-        positions = normals = primitives = None
-        try:
-            if ext == ".psm2":
-                mesh = psm2_mod.parse_psm2(buf)
-                positions, normals, primitives = mesh.positions, mesh.normals, mesh.primitives
-                out_name = f"{stem}_PSM2.obj"
-            elif ext == ".psc3":
-                mesh = psc3_mod.parse_psc3(buf)
-                positions, normals, primitives = mesh.positions, mesh.normals, mesh.primitives
-                out_name = f"{stem}_PSC3.obj"
-            elif ext == ".psb4":
-                mesh = psb4_mod.parse_psb4(buf)
-                positions = mesh.positions
-                normals = []  # PSB4 has no vertex normals
-                primitives = mesh.primitives
-                out_name = f"{stem}_PSB4.obj"
-            else:
-                continue
-        except Exception as ex:
-            stats[f"{ext}_fail"] += 1
-            continue
-        if not out_name:
-            continue
-        if _write_obj(os.path.join(dst, out_name),
-                      out_name.replace(".obj", ""),
-                      positions, normals, primitives):
-            stats[f"{ext}_ok"] += 1
+def _dump_one(path: str, dst: str) -> str:
+    """Convert one mesh file; returns its stats key (``<ext>_ok`` etc.),
+    or "" for files that are not meshes."""
+    stem, ext = os.path.splitext(os.path.basename(path))
+    with open(path, "rb") as f:
+        buf = f.read()
+    try:
+        if ext == ".psm2":
+            mesh = psm2_mod.parse_psm2(buf)
+            normals = mesh.normals
+        elif ext == ".psc3":
+            mesh = psc3_mod.parse_psc3(buf)
+            normals = mesh.normals
+        elif ext == ".psb4":
+            mesh = psb4_mod.parse_psb4(buf)
+            normals = []  # PSB4 has no vertex normals
         else:
-            stats[f"{ext}_empty"] += 1
+            return ""
+    except Exception:
+        return f"{ext}_fail"
+    out_name = f"{stem}_{ext[1:].upper()}"
+    if _write_obj(os.path.join(dst, out_name + ".obj"), out_name,
+                  mesh.positions, normals, mesh.primitives):
+        return f"{ext}_ok"
+    return f"{ext}_empty"
+
+
+def run(src: str, dst: str, jobs: int = 1) -> None:
+    os.makedirs(dst, exist_ok=True)
+    paths = [os.path.join(src, fn) for fn in sorted(os.listdir(src))]
+    if jobs == 1:
+        keys = [_dump_one(p, dst) for p in paths]
+    else:
+        with ProcessPoolExecutor(max_workers=jobs or None) as pool:
+            keys = list(pool.map(_dump_one, paths, [dst] * len(paths), chunksize=8))
+    stats = Counter(k for k in keys if k)
     print(f"\nWrote OBJs to {dst}")
     for k in sorted(stats):
         print(f"  {k:<12} {stats[k]}")
@@ -97,8 +103,10 @@ def main(argv=None) -> int:
                     help="Directory with .psm2/.psc3/.psb4 files")
     ap.add_argument("dst", default="out/all/map_obj", nargs="?",
                     help="Output directory for OBJs")
+    ap.add_argument("--jobs", "-j", type=int, default=1,
+                    help="Worker processes, one file per task (0 = all cores)")
     args = ap.parse_args(argv)
-    run(args.src, args.dst)
+    run(args.src, args.dst, args.jobs)
     return 0
 
 
@@ -11,6 +11,14 @@ What it does:
     It also writes a sibling .ext hint when the magic is recognised (psm2/psc3/
     psb4/bmpa).
   * For MCB: delegates to `mcb.py` which already handles the pair.
+  * `--jobs N` (0 = all cores) pools the entries of every flat-TOC BIN into
+    one largest-first task queue over N worker processes. Output names and
+    the printed stats are the same as the sequential run.
+  * `--cache DIR` serves decoded entries from a decode_cache.py store and
+    adds new ones to it, so re-extracts skip LZ decoding entirely.
+  * `--incremental` records each entry's compressed-bytes digest and the
+    extractor's code version in DST/_build.json (build_graph.py) and skips
+    entries whose output is already up to date.
 
 No mesh parsing is invoked from here — downstream tools (psm2.py, psc3.py,
 psb4.py, mcb_scan_meshes.py) operate on the dumped chunks.
@@ -23,14 +31,15 @@ from __future__ import annotations
 
 import argparse
 import os
-import struct
 import sys
-from typing import Optional
+from concurrent.futures import ProcessPoolExecutor, as_completed
+from functools import lru_cache
+from typing import Dict, Iterable, List, Optional, Tuple
 
-from .bin_toc import iter_entries, parse_toc
-
-# Reuse the headerless LZ decoder (baseline/lz_decoder.py = port of FUN_002f3118).
-from ..baseline.lz_decoder import decode_bytes as lz_decode
+from .archive import FlatArchive
+from .bin_toc import iter_entries
+from .build_graph import BuildState, code_version, digest_bytes
+from .decode_cache import decoder
 
 
 # Files with the flat TOC format.
@@ -52,37 +61,168 @@ def classify_magic(buf: bytes) -> Optional[str]:
     return None
 
 
-def extract_flat_bin(path: str, dst_dir: str, decompress: bool = True) -> dict:
-    """Extract every entry of a flat-TOC BIN into `dst_dir`.
+def _extract_entry(index: int, raw: bytes, dst_dir: str, decompress: bool,
+                   cache_dir: Optional[str] = None) -> Tuple[bool, Optional[str]]:
+    """Decode + classify + write one TOC entry.
 
-    Returns a small stats dict.
+    Returns (lz_failed, kind); kind is None when the payload is empty and
+    nothing was written. Decoding goes through the decode_cache store when
+    `cache_dir` is set (headerless LZ, FUN_002f3118, via lz.py otherwise).
     """
-    os.makedirs(dst_dir, exist_ok=True)
+    payload = raw
+    lz_failed = False
+    if decompress:
+        try:
+            payload = decoder(cache_dir)(raw)
+        except Exception:
+            lz_failed = True
+            # Fall back to raw bytes so we never silently drop data.
+            payload = raw
+    if not payload:
+        return lz_failed, None
+    kind = classify_magic(payload) or "bin"
+    name = f"{index:04d}.{kind}"
+    with open(os.path.join(dst_dir, name), "wb") as f:
+        f.write(payload)
+    return lz_failed, kind
+
+
+def _fold_stats(results: Iterable[Tuple[bool, Optional[str]]]) -> dict:
+    """Build the per-BIN stats dict from per-entry results in TOC order."""
     stats = {"entries": 0, "empty": 0, "ok": 0, "lz_fail": 0}
     magics: dict[str, int] = {}
-    for e, raw in iter_entries(path):
+    for lz_failed, kind in results:
         stats["entries"] += 1
-        payload = raw
-        if decompress:
-            try:
-                payload = lz_decode(raw)
-            except Exception:
-                stats["lz_fail"] += 1
-                # Fall back to raw bytes so we never silently drop data.
-                payload = raw
-        if not payload:
+        if lz_failed:
+            stats["lz_fail"] += 1
+        if kind is None:
             stats["empty"] += 1
             continue
-        kind = classify_magic(payload) or "bin"
         magics[kind] = magics.get(kind, 0) + 1
-        name = f"{e.index:04d}.{kind}"
-        with open(os.path.join(dst_dir, name), "wb") as f:
-            f.write(payload)
         stats["ok"] += 1
     stats["by_magic"] = magics
     return stats
 
 
+# ---------------------------------------------------------------------------
+# Incremental mode
+# ---------------------------------------------------------------------------
+
+def _entry_target(state: BuildState, path: str, index: int, raw,
+                  decompress: bool) -> Tuple[str, Dict[str, str]]:
+    """(key, inputs) of one TOC entry's output in `state`."""
+    if not state.enabled:
+        return "", {}
+    return (f"{os.path.basename(path).upper()}/{index}",
+            {"src": digest_bytes(raw), "code": code_version("extract_all"),
+             "decompress": str(decompress)})
+
+
+def _entry_hit(state: BuildState, key: str,
+               inputs: Dict[str, str]) -> Optional[Tuple[bool, Optional[str]]]:
+    meta = state.check(key, inputs)
+    return None if meta is None else (meta["lz_fail"], meta["kind"])
+
+
+def _entry_record(state: BuildState, key: str, inputs: Dict[str, str],
+                  dst_dir: str, index: int, result: Tuple[bool, Optional[str]]) -> None:
+    lz_failed, kind = result
+    outputs = [os.path.join(dst_dir, f"{index:04d}.{kind}")] if kind else []
+    state.record(key, inputs, outputs, {"lz_fail": lz_failed, "kind": kind})
+
+
+def extract_flat_bin(path: str, dst_dir: str, decompress: bool = True,
+                     cache_dir: Optional[str] = None,
+                     state: Optional[BuildState] = None) -> dict:
+    """Extract every entry of a flat-TOC BIN into `dst_dir`.
+
+    With an enabled `state`, up-to-date entries are skipped. Returns a
+    small stats dict.
+    """
+    os.makedirs(dst_dir, exist_ok=True)
+    state = state or BuildState(dst_dir, enabled=False)
+    results = []
+    for e, raw in iter_entries(path):
+        key, inputs = _entry_target(state, path, e.index, raw, decompress)
+        res = _entry_hit(state, key, inputs) if state.enabled else None
+        if res is None:
+            res = _extract_entry(e.index, raw, dst_dir, decompress, cache_dir)
+            _entry_record(state, key, inputs, dst_dir, e.index, res)
+        results.append(res)
+    return _fold_stats(results)
+
+
+# ---------------------------------------------------------------------------
+# Parallel mode
+# ---------------------------------------------------------------------------
+
+@lru_cache(maxsize=None)
+def _worker_archive(path: str) -> FlatArchive:
+    # One mapping per BIN per worker process; tasks only carry the path.
+    return FlatArchive(path)
+
+
+def _extract_entry_at(path: str, index: int, dst_dir: str, decompress: bool,
+                      cache_dir: Optional[str]) -> Tuple[bool, Optional[str]]:
+    """Worker: slice one entry out of the mapped BIN and extract it."""
+    arc = _worker_archive(path)
+    return _extract_entry(index, arc.payload(arc.entry(index)), dst_dir,
+                          decompress, cache_dir)
+
+
+def extract_flat_bins_parallel(bins: List[Tuple[str, str]], decompress: bool = True,
+                               jobs: Optional[int] = None,
+                               cache_dir: Optional[str] = None,
+                               state: Optional[BuildState] = None) -> Dict[str, dict]:
+    """Extract several flat-TOC BINs at once over a process pool.
+
+    `bins` is a list of (path, dst_dir). Every non-empty entry of every BIN
+    becomes one task; tasks are submitted largest-first so big MAP/VOICE
+    entries start early and the many tiny ITM/SND ones fill the gaps at the
+    end (the executor's shared queue does the balancing). Output names and
+    the returned per-BIN stats are identical to `extract_flat_bin`.
+    Up-to-date entries of an enabled `state` are resolved up front and
+    never queued.
+    """
+    state = state or BuildState(".", enabled=False)
+    results: Dict[str, Dict[int, Tuple[bool, Optional[str]]]] = {p: {} for p, _ in bins}
+    targets: Dict[Tuple[str, int], Tuple[str, Dict[str, str]]] = {}
+    tasks = []
+    for path, dst_dir in bins:
+        os.makedirs(dst_dir, exist_ok=True)
+        arc = FlatArchive(path)
+        for e in arc:
+            if not e.size:
+                continue
+            if state.enabled:
+                key, inputs = _entry_target(state, path, e.index, arc.payload(e), decompress)
+                hit = _entry_hit(state, key, inputs)
+                if hit is not None:
+                    results[path][e.index] = hit
+                    continue
+                targets[(path, e.index)] = (key, inputs)
+            tasks.append((e.size, path, e.index, dst_dir))
+    tasks.sort(key=lambda t: -t[0])
+
+    with ProcessPoolExecutor(max_workers=jobs) as pool:
+        futures = {
+            pool.submit(_extract_entry_at, path, index, dst_dir,
+                        decompress, cache_dir): (path, index, dst_dir)
+            for _size, path, index, dst_dir in tasks
+        }
+        for fut in as_completed(futures):
+            path, index, dst_dir = futures[fut]
+            results[path][index] = fut.result()
+            if state.enabled:
+                key, inputs = targets[(path, index)]
+                _entry_record(state, key, inputs, dst_dir, index, results[path][index])
+
+    return {
+        path: _fold_stats(res[i] for i in sorted(res))
+        for path, res in results.items()
+    }
+
+
 def extract_mcb(mcb0: str, mcb1: str, dst_dir: str) -> dict:
     from . import mcb as mcb_mod
     written, magics = mcb_mod.extract(mcb0_path=mcb0, mcb1_path=mcb1,
@@ -90,7 +230,11 @@ def extract_mcb(mcb0: str, mcb1: str, dst_dir: str) -> dict:
     return {"written": written, "top_magics": magics.most_common(10)}
 
 
-def run(src: str, dst: str, no_decompress: bool = False) -> None:
+def run(src: str, dst: str, no_decompress: bool = False, jobs: int = 1,
+        cache_dir: Optional[str] = None, incremental: bool = False) -> None:
+    """Extract `src` into `dst`. `jobs` != 1 fans flat-TOC entries out over
+    a process pool (0 = one worker per core); `incremental` skips entries
+    recorded as up to date in DST/_build.json."""
     if os.path.isdir(src):
         bins_found = []
         for name in sorted(os.listdir(src)):
@@ -107,18 +251,32 @@ def run(src: str, dst: str, no_decompress: bool = False) -> None:
                     sub = os.path.join(dst, "mcb")
                     s = extract_mcb(mcb0, mcb1, sub)
                     print(f"MCB: {s}")
-        for up, p in bins_found:
-            sub = os.path.join(dst, up.replace(".BIN", "").lower())
-            s = extract_flat_bin(p, sub, decompress=not no_decompress)
-            print(f"{up}: {s}")
+        targets = [(up, p, os.path.join(dst, up.replace(".BIN", "").lower()))
+                   for up, p in bins_found]
     else:
         up = os.path.basename(src).upper()
         if up in FLAT_TOC_BINS:
-            s = extract_flat_bin(src, dst, decompress=not no_decompress)
-            print(f"{up}: {s}")
+            targets = [(up, src, dst)]
         else:
             raise SystemExit(f"unsupported file: {src}")
 
+    state = BuildState(dst, enabled=incremental)
+    if jobs == 1:
+        for up, p, sub in targets:
+            s = extract_flat_bin(p, sub, decompress=not no_decompress,
+                                 cache_dir=cache_dir, state=state)
+            print(f"{up}: {s}")
+    else:
+        all_stats = extract_flat_bins_parallel(
+            [(p, sub) for _up, p, sub in targets],
+            decompress=not no_decompress, jobs=jobs or None,
+            cache_dir=cache_dir, state=state)
+        for up, p, _sub in targets:
+            print(f"{up}: {all_stats[p]}")
+    if incremental:
+        state.save()
+        print(f"build: {state.summary()}")
+
 
 def main(argv=None) -> int:
     ap = argparse.ArgumentParser(description="Extract all resource archives")
@@ -126,8 +284,16 @@ def main(argv=None) -> int:
     ap.add_argument("dst", help="Output directory root")
     ap.add_argument("--no-decompress", action="store_true",
                     help="Skip LZ decompression (write raw compressed blobs)")
+    ap.add_argument("--jobs", "-j", type=int, default=1,
+                    help="Worker processes for flat-TOC entries (0 = all cores)")
+    ap.add_argument("--cache", default=None,
+                    help="Decoded-payload cache directory (see decode_cache.py)")
+    ap.add_argument("--incremental", action="store_true",
+                    help="Skip entries whose compressed bytes and extractor code "
+                         "match DST/_build.json")
     args = ap.parse_args(argv)
-    run(args.src, args.dst, no_decompress=args.no_decompress)
+    run(args.src, args.dst, no_decompress=args.no_decompress, jobs=args.jobs,
+        cache_dir=args.cache, incremental=args.incremental)
     return 0
 
 
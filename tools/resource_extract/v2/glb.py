@@ -0,0 +1,231 @@
+"""Binary glTF (GLB) container and quantized vertex streams.
+
+Shared by ``psm2_gltf`` and ``psc3_gltf`` when they run with ``--glb``:
+one self-contained ``.glb`` per scene/model (JSON chunk + BIN chunk, PNG
+textures embedded as buffer views) instead of ``.gltf`` + ``.bin`` +
+loose PNGs.
+
+Vertex data is quantized per KHR_mesh_quantization and interleaved into
+one buffer view per stream (byteStride 16, or 20 with float UVs):
+
+    +0   POSITION    SHORT x3 (+2 pad)  integer grid; the mesh node's
+                                        translation/scale dequantize it
+    +8   NORMAL      BYTE x3 (+1 pad)   normalized
+    +12  TEXCOORD_0  UNSIGNED_SHORT x2  normalized, when every UV is in
+                                        [0, 1]; FLOAT x2 otherwise
+
+All primitives of a mesh share one position grid (``PositionGrid``),
+because the dequantizing transform lives on the node. Indices are u16
+when the primitive's largest index allows it, else u32.
+
+Packing is array-level: each attribute is quantized into one ``array``,
+and the interleave is a handful of strided 32-bit-word copies between
+memoryviews (every attribute slot is a whole number of words).
+"""
+from __future__ import annotations
+
+import json
+import os
+import struct
+import sys
+from array import array
+from itertools import chain
+from typing import Dict, Iterable, List, Optional, Sequence, Tuple
+
+GLB_MAGIC = 0x46546C67  # "glTF"
+CHUNK_JSON = 0x4E4F534A
+CHUNK_BIN = 0x004E4942
+
+ARRAY_BUFFER = 34962
+ELEMENT_ARRAY_BUFFER = 34963
+BYTE, UNSIGNED_BYTE, SHORT, UNSIGNED_SHORT, UNSIGNED_INT, FLOAT = 5120, 5121, 5122, 5123, 5125, 5126
+
+QUANT_EXT = "KHR_mesh_quantization"
+
+_BIG = sys.byteorder == "big"
+
+
+def _le(a: array) -> array:
+    if _BIG:
+        a.byteswap()
+    return a
+
+
+def pack_f32(seq: Iterable[Sequence[float]]) -> bytes:
+    """Flatten float tuples into little-endian f32 bytes in one pass."""
+    return _le(array("f", chain.from_iterable(seq))).tobytes()
+
+
+def pack_index(seq: Sequence[int], wide: Optional[bool] = None) -> Tuple[bytes, int]:
+    """(bytes, componentType) with u16 unless an index needs u32.
+
+    0xFFFF is kept out of u16 buffers: WebGL2 treats it as primitive
+    restart.
+    """
+    if wide is None:
+        wide = bool(seq) and max(seq) >= 0xFFFF
+    if wide:
+        return _le(array("I", seq)).tobytes(), UNSIGNED_INT
+    return _le(array("H", seq)).tobytes(), UNSIGNED_SHORT
+
+
+def bbox(seq: Sequence[Sequence[float]]) -> Tuple[List[float], List[float]]:
+    if not seq:
+        return [0.0, 0.0, 0.0], [0.0, 0.0, 0.0]
+    xs, ys, zs = zip(*seq)
+    return [min(xs), min(ys), min(zs)], [max(xs), max(ys), max(zs)]
+
+
+class PositionGrid:
+    """Signed 16-bit grid covering a bounding box, centred on it."""
+
+    def __init__(self, positions: Sequence[Sequence[float]]):
+        mn, mx = bbox(positions)
+        self.center = [(a + b) * 0.5 for a, b in zip(mn, mx)]
+        # One step for all axes: a non-uniform node scale would skew the
+        # normals. 32766 leaves headroom so rounding never reaches past int16.
+        step = max(b - a for a, b in zip(mn, mx)) * 0.5 / 32766.0 or 1.0
+        self.step = [step] * 3
+
+    def node_transform(self) -> dict:
+        """Node TRS that maps grid coordinates back to mesh units."""
+        return {"translation": list(self.center), "scale": list(self.step)}
+
+    def quantize(self, positions: Sequence[Sequence[float]]) -> array:
+        cx, cy, cz = self.center
+        ix, iy, iz = (1.0 / s for s in self.step)
+        return array("h", [v for x, y, z in positions
+                           for v in (round((x - cx) * ix), round((y - cy) * iy),
+                                     round((z - cz) * iz), 0)])
+
+
+def _snorm8(normals: Sequence[Sequence[float]]) -> array:
+    def q(v: float) -> int:
+        return max(-127, min(127, round(v * 127.0)))
+    return array("b", [c for x, y, z in normals for c in (q(x), q(y), q(z), 0)])
+
+
+class GlbBuilder:
+    """Accumulates the BIN chunk plus the bufferViews/accessors indexing it."""
+
+    def __init__(self) -> None:
+        self.chunks: List[bytes] = []
+        self.length = 0
+        self.buffer_views: List[dict] = []
+        self.accessors: List[dict] = []
+        self.quantized = False
+
+    def add_view(self, data: bytes, target: Optional[int] = None,
+                 stride: Optional[int] = None) -> int:
+        pad = (-self.length) % 4
+        if pad:
+            self.chunks.append(b"\x00" * pad)
+            self.length += pad
+        bv: dict = {"buffer": 0, "byteOffset": self.length, "byteLength": len(data)}
+        if stride is not None:
+            bv["byteStride"] = stride
+        if target is not None:
+            bv["target"] = target
+        self.chunks.append(data)
+        self.length += len(data)
+        self.buffer_views.append(bv)
+        return len(self.buffer_views) - 1
+
+    def add_accessor(self, bv: int, count: int, ctype: str, comp_type: int,
+                     offset: int = 0, normalized: bool = False,
+                     mn=None, mx=None) -> int:
+        a: dict = {"bufferView": bv, "byteOffset": offset,
+                   "componentType": comp_type, "count": count, "type": ctype}
+        if normalized:
+            a["normalized"] = True
+        if mn is not None:
+            a["min"] = mn
+        if mx is not None:
+            a["max"] = mx
+        self.accessors.append(a)
+        return len(self.accessors) - 1
+
+    def add_vertex_stream(self, grid: PositionGrid,
+                          positions: Sequence[Sequence[float]],
+                          normals: Sequence[Sequence[float]],
+                          uvs: Sequence[Sequence[float]]) -> Dict[str, int]:
+        """Quantize + interleave one vertex stream; returns glTF attributes."""
+        n = len(positions)
+        pos = grid.quantize(positions)
+        qmin = [min(pos[i::4], default=0) for i in range(3)]
+        qmax = [max(pos[i::4], default=0) for i in range(3)]
+        _le(pos)
+        nrm = _snorm8(normals)
+        flat_uv = list(chain.from_iterable(uvs))
+        unit_uv = all(0.0 <= c <= 1.0 for c in flat_uv)
+        if unit_uv:
+            uv = _le(array("H", [round(c * 65535.0) for c in flat_uv]))
+        else:
+            uv = _le(array("f", flat_uv))
+        uv_words = 1 if unit_uv else 2
+        words = 3 + uv_words
+        out = bytearray(4 * words * n)
+        if n:
+            dst = memoryview(out).cast("I")
+            pw = memoryview(pos).cast("B").cast("I")
+            uw = memoryview(uv).cast("B").cast("I")
+            dst[0::words] = pw[0::2]
+            dst[1::words] = pw[1::2]
+            dst[2::words] = memoryview(nrm).cast("B").cast("I")
+            for k in range(uv_words):
+                dst[3 + k::words] = uw[k::uv_words]
+        bv = self.add_view(bytes(out), ARRAY_BUFFER, stride=4 * words)
+        self.quantized = True
+        return {
+            "POSITION": self.add_accessor(bv, n, "VEC3", SHORT, 0, mn=qmin, mx=qmax),
+            "NORMAL": self.add_accessor(bv, n, "VEC3", BYTE, 8, normalized=True),
+            "TEXCOORD_0": self.add_accessor(bv, n, "VEC2",
+                                            UNSIGNED_SHORT if unit_uv else FLOAT, 12,
+                                            normalized=unit_uv),
+        }
+
+    def add_indices(self, indices: Sequence[int]) -> int:
+        data, comp = pack_index(indices)
+        bv = self.add_view(data, ELEMENT_ARRAY_BUFFER)
+        return self.add_accessor(bv, len(indices), "SCALAR", comp)
+
+    def add_image(self, png_path: str, name: str) -> dict:
+        """Embed a PNG; falls back to a relative URI when it can't be read."""
+        try:
+            with open(png_path, "rb") as f:
+                data = f.read()
+        except OSError:
+            return {"uri": name, "name": name}
+        return self.add_image_data(data, name)
+
+    def add_image_data(self, data: bytes, name: str) -> dict:
+        return {"bufferView": self.add_view(data), "mimeType": "image/png", "name": name}
+
+    def finish(self, gltf: dict) -> None:
+        """Attach buffers/bufferViews/accessors (+ extension flags) to `gltf`."""
+        if self.length:
+            gltf["buffers"] = [{"byteLength": self.length + (-self.length) % 4}]
+        if self.buffer_views:
+            gltf["bufferViews"] = self.buffer_views
+        if self.accessors:
+            gltf["accessors"] = self.accessors
+        if self.quantized:
+            gltf.setdefault("extensionsUsed", []).append(QUANT_EXT)
+            gltf.setdefault("extensionsRequired", []).append(QUANT_EXT)
+
+    def write(self, path: str, gltf: dict) -> int:
+        """Write the GLB container; returns its size in bytes."""
+        js = json.dumps(gltf, separators=(",", ":")).encode("utf-8")
+        js += b" " * ((-len(js)) % 4)
+        bin_blob = b"".join(self.chunks)
+        bin_blob += b"\x00" * ((-len(bin_blob)) % 4)
+        total = 12 + 8 + len(js) + (8 + len(bin_blob) if bin_blob else 0)
+        os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+        with open(path, "wb") as f:
+            f.write(struct.pack("<III", GLB_MAGIC, 2, total))
+            f.write(struct.pack("<II", len(js), CHUNK_JSON))
+            f.write(js)
+            if bin_blob:
+                f.write(struct.pack("<II", len(bin_blob), CHUNK_BIN))
+                f.write(bin_blob)
+        return total
@@ -0,0 +1,253 @@
+"""KTX2 texture writer with BC1/BC3 block compression (stdlib only).
+
+Used by ``tex_atlas`` for the optional GPU-ready copy of a texture atlas:
+the mip chain is built once at export time and stored in the block
+format the GPU samples directly, so a loader uploads the levels as-is
+instead of decoding a PNG and generating mipmaps.
+
+Formats:
+
+    rgba8   VK_FORMAT_R8G8B8A8_SRGB      4 B/texel, lossless
+    bc1     VK_FORMAT_BC1_RGBA_SRGB_BLOCK 8 B/4x4 block, 1-bit alpha
+    bc3     VK_FORMAT_BC3_SRGB_BLOCK     16 B/4x4 block, 8-bit alpha
+
+The BC encoder is a bounding-box fit: endpoints are the colour range of
+the block's pixels (inset by 1/16, diagonal picked by the sign of each
+channel's covariance with the widest one), and every pixel takes the
+nearest palette entry along the endpoint axis. BMPA pages are 8-bit
+indexed, so identical 4x4 blocks recur a lot; encoded blocks are cached
+by their pixel bytes.
+
+Basis Universal / UASTC would need a native encoder, so they are not
+produced here. Supercompression is not applied (scheme 0).
+
+File layout follows the KTX 2.0 specification: identifier, header,
+level index (level 0 first), one basic data format descriptor, a
+``KTXwriter`` key/value entry, then level data from the smallest mip to
+the largest.
+"""
+from __future__ import annotations
+
+import struct
+from typing import Dict, List, Sequence, Tuple
+
+IDENTIFIER = b"\xabKTX 20\xbb\r\n\x1a\n"
+
+VK_FORMAT_R8G8B8A8_SRGB = 43
+VK_FORMAT_BC1_RGBA_SRGB_BLOCK = 134
+VK_FORMAT_BC3_SRGB_BLOCK = 138
+
+# Data format descriptor constants (Khronos Data Format spec, khr_df.h).
+_DF_MODEL_RGBSDA, _DF_MODEL_BC1A, _DF_MODEL_BC3 = 1, 128, 130
+_DF_PRIMARIES_BT709 = 1
+_DF_TRANSFER_SRGB = 2
+_DF_SAMPLE_LINEAR = 0x80
+
+FORMATS = ("rgba8", "bc1", "bc3")
+
+Level = Tuple[int, int, bytes]  # (width, height, RGBA8888 rows)
+
+
+# ---------------------------------------------------------------------------
+# Mip chain
+# ---------------------------------------------------------------------------
+
+def downsample(width: int, height: int, rgba: bytes) -> Level:
+    """2x2 box filter; odd edges repeat the last row/column."""
+    w2, h2 = max(1, width // 2), max(1, height // 2)
+    out = bytearray(w2 * h2 * 4)
+    stride = width * 4
+    o = 0
+    for y in range(h2):
+        r0 = rgba[2 * y * stride:(2 * y + 1) * stride]
+        r1 = rgba[min(2 * y + 1, height - 1) * stride:][:stride]
+        for x in range(w2):
+            a = 8 * x
+            b = a + 4 if 2 * x + 1 < width else a
+            for c in range(4):
+                out[o + c] = (r0[a + c] + r0[b + c] + r1[a + c] + r1[b + c] + 2) >> 2
+            o += 4
+    return w2, h2, bytes(out)
+
+
+def mip_chain(width: int, height: int, rgba: bytes, levels: int) -> List[Level]:
+    """Level 0 plus up to ``levels - 1`` box-filtered reductions."""
+    chain = [(width, height, rgba)]
+    while len(chain) < levels and (chain[-1][0] > 1 or chain[-1][1] > 1):
+        chain.append(downsample(*chain[-1]))
+    return chain
+
+
+def max_levels(width: int, height: int) -> int:
+    return max(width, height).bit_length()
+
+
+# ---------------------------------------------------------------------------
+# BC1 / BC3 blocks
+# ---------------------------------------------------------------------------
+
+def _pack565(r: int, g: int, b: int) -> int:
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+
+
+def _unpack565(c: int) -> Tuple[int, int, int]:
+    r, g, b = c >> 11, (c >> 5) & 0x3F, c & 0x1F
+    return (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)
+
+
+def _endpoints(px: Sequence[Tuple[int, int, int]]) -> Tuple[int, int]:
+    """(c0, c1) as RGB565 spanning the pixels' colour range."""
+    lo = [min(p[c] for p in px) for c in range(3)]
+    hi = [max(p[c] for p in px) for c in range(3)]
+    main = max(range(3), key=lambda c: hi[c] - lo[c])
+    n = len(px)
+    mean = [sum(p[c] for p in px) / n for c in range(3)]
+    for c in range(3):
+        if c != main and sum((p[c] - mean[c]) * (p[main] - mean[main]) for p in px) < 0:
+            lo[c], hi[c] = hi[c], lo[c]
+    inset = [(h - l) >> 4 for l, h in zip(lo, hi)]
+    e0 = [h - i for h, i in zip(hi, inset)]
+    e1 = [l + i for l, i in zip(lo, inset)]
+    return _pack565(*e0), _pack565(*e1)
+
+
+def _color_indices(px: Sequence[Tuple[int, int, int]], c0: int, c1: int,
+                   steps: int, codes: Sequence[int]) -> List[int]:
+    """Nearest of ``steps + 1`` evenly spaced colours from c0 to c1."""
+    e0, e1 = _unpack565(c0), _unpack565(c1)
+    d = [a - b for a, b in zip(e0, e1)]
+    dd = sum(v * v for v in d)
+    if not dd:
+        return [codes[0]] * len(px)
+    out = []
+    for p in px:
+        t = sum((p[c] - e1[c]) * d[c] for c in range(3)) / dd  # 1.0 at c0
+        out.append(codes[min(steps, max(0, round((1.0 - t) * steps)))])
+    return out
+
+
+def _bc1_color(block: bytes, punch_through: bool) -> bytes:
+    px = [tuple(block[i:i + 3]) for i in range(0, 64, 4)]
+    alpha = block[3::4]
+    if punch_through and min(alpha) < 128:
+        opaque = [p for p, a in zip(px, alpha) if a >= 128]
+        if not opaque:
+            return struct.pack("<HHI", 0, 0, 0xFFFFFFFF)
+        c0, c1 = _endpoints(opaque)
+        if c0 > c1:  # three-colour mode needs c0 <= c1
+            c0, c1 = c1, c0
+        idx = _color_indices(px, c0, c1, 2, (0, 2, 1))
+        idx = [i if a >= 128 else 3 for i, a in zip(idx, alpha)]
+    else:
+        c0, c1 = _endpoints(px)
+        if c0 < c1:
+            c0, c1 = c1, c0
+        idx = _color_indices(px, c0, c1, 3, (0, 2, 3, 1))
+    bits = 0
+    for i, v in enumerate(idx):
+        bits |= v << (2 * i)
+    return struct.pack("<HHI", c0, c1, bits)
+
+
+def _bc3_alpha(block: bytes) -> bytes:
+    alpha = block[3::4]
+    a0, a1 = max(alpha), min(alpha)
+    if a0 == a1:
+        return bytes((a0, a1)) + bytes(6)
+    codes = (0, 2, 3, 4, 5, 6, 7, 1)  # a0 ... a1 in 7 steps
+    bits = 0
+    for i, a in enumerate(alpha):
+        bits |= codes[round((a0 - a) * 7 / (a0 - a1))] << (3 * i)
+    return bytes((a0, a1)) + bits.to_bytes(6, "little")
+
+
+def _blocks(width: int, height: int, rgba: bytes):
+    """4x4 RGBA blocks in raster order, edge pixels repeated past the border."""
+    stride = width * 4
+    for by in range(0, height, 4):
+        rows = [rgba[min(by + y, height - 1) * stride:][:stride] for y in range(4)]
+        for bx in range(0, width, 4):
+            if bx + 4 <= width:
+                yield b"".join(r[bx * 4:bx * 4 + 16] for r in rows)
+            else:
+                yield b"".join(r[min(bx + x, width - 1) * 4:][:4] for r in rows for x in range(4))
+
+
+def encode_bc(width: int, height: int, rgba: bytes, fmt: str) -> bytes:
+    """Compress one level to BC1 (``bc1``) or BC3 (``bc3``)."""
+    cache: Dict[bytes, bytes] = {}
+    out = []
+    for block in _blocks(width, height, rgba):
+        enc = cache.get(block)
+        if enc is None:
+            if fmt == "bc1":
+                enc = _bc1_color(block, punch_through=True)
+            else:
+                enc = _bc3_alpha(block) + _bc1_color(block, punch_through=False)
+            cache[block] = enc
+        out.append(enc)
+    return b"".join(out)
+
+
+# ---------------------------------------------------------------------------
+# Container
+# ---------------------------------------------------------------------------
+
+def _dfd(fmt: str) -> bytes:
+    if fmt == "rgba8":
+        model, dims, plane = _DF_MODEL_RGBSDA, (0, 0, 0, 0), 4
+        # (bit offset, bit length, channel id); alpha is always linear.
+        samples = [(0, 8, 0), (8, 8, 1), (16, 8, 2), (24, 8, 15 | _DF_SAMPLE_LINEAR)]
+        lower, upper = 0, 255
+    elif fmt == "bc1":
+        model, dims, plane = _DF_MODEL_BC1A, (3, 3, 0, 0), 8
+        samples = [(0, 64, 1)]  # KHR_DF_CHANNEL_BC1A_ALPHAPRESENT
+        lower, upper = 0, 0xFFFFFFFF
+    else:
+        model, dims, plane = _DF_MODEL_BC3, (3, 3, 0, 0), 16
+        samples = [(0, 64, 15 | _DF_SAMPLE_LINEAR), (64, 64, 0)]  # BC3_ALPHA, BC3_COLOR
+        lower, upper = 0, 0xFFFFFFFF
+    block_size = 24 + 16 * len(samples)
+    body = struct.pack("<IHH4B4B8B", 0, 2, block_size,
+                       model, _DF_PRIMARIES_BT709, _DF_TRANSFER_SRGB, 0,
+                       *dims, plane, 0, 0, 0, 0, 0, 0, 0)
+    for off, length, chan in samples:
+        body += struct.pack("<HBB4BII", off, length - 1, chan, 0, 0, 0, 0, lower, upper)
+    return struct.pack("<I", 4 + len(body)) + body
+
+
+def _kv(key: str, value: str) -> bytes:
+    kv = key.encode() + b"\0" + value.encode() + b"\0"
+    entry = struct.pack("<I", len(kv)) + kv
+    return entry + b"\0" * ((-len(entry)) % 4)
+
+
+def encode(chain: Sequence[Level], fmt: str, writer: str = "tex_atlas.py") -> bytes:
+    """KTX2 file bytes for a mip chain (level 0 first) in ``fmt``."""
+    if fmt not in FORMATS:
+        raise ValueError(f"unknown KTX2 format {fmt!r} (expected one of {FORMATS})")
+    vk = {"rgba8": VK_FORMAT_R8G8B8A8_SRGB, "bc1": VK_FORMAT_BC1_RGBA_SRGB_BLOCK,
+          "bc3": VK_FORMAT_BC3_SRGB_BLOCK}[fmt]
+    align = {"rgba8": 4, "bc1": 8, "bc3": 16}[fmt]
+    levels = [rgba if fmt == "rgba8" else encode_bc(w, h, rgba, fmt) for w, h, rgba in chain]
+
+    n = len(levels)
+    dfd = _dfd(fmt)
+    kvd = _kv("KTXwriter", writer)
+    dfd_off = 80 + 24 * n
+    kvd_off = dfd_off + len(dfd)
+    pos = kvd_off + len(kvd)
+    offsets = [0] * n
+    data = bytearray()
+    for i in range(n - 1, -1, -1):  # smallest mip first in the file
+        pad = (-(pos + len(data))) % align
+        data += b"\0" * pad
+        offsets[i] = pos + len(data)
+        data += levels[i]
+
+    w0, h0 = chain[0][0], chain[0][1]
+    head = IDENTIFIER + struct.pack("<9I", vk, 1, w0, h0, 0, 0, 1, n, 0)
+    head += struct.pack("<4I2Q", dfd_off, len(dfd), kvd_off, len(kvd), 0, 0)
+    for off, lvl in zip(offsets, levels):
+        head += struct.pack("<3Q", off, len(lvl), len(lvl))
+    return head + dfd + kvd + bytes(data)
@@ -0,0 +1,272 @@
+"""Headerless LZ decoder (FUN_002f3118) — block-level rewrite of the baseline port.
+
+`baseline/lz_decoder.py` mirrors the game's routine byte for byte: every
+output byte goes through `CircularBuffer.write_byte` and a one-byte
+`out.write`. That is faithful but dominates the runtime of `extract_all`,
+`mcb_bundle`, `mcb_unpack_all` and `target_picker`.
+
+This module decodes the same grammar (see the baseline docstring for the
+flag layout) in two passes:
+
+  1. `calculate_decompressed_size` walks the tokens (skipping raw payloads)
+     to get the exact output length;
+  2. `_decode` fills a buffer of exactly that size, one token at a time,
+     with equal-length slice assignments — no growth, no ring buffer:
+
+    raw run       -> one slice copy from the input
+    RLE run       -> one `bytes((value,)) * length` copy
+    LZ match      -> one slice copy when distance >= length; for
+                     overlapping matches the `distance`-byte period is
+                     repeated and trimmed, which is what the byte loop in
+                     FUN_002f3118 produces
+
+The output *is* the history. The game's ring is zero-initialised, so a
+back-reference that reaches before the start of the current stream reads
+0x00 — `_copy` writes those bytes explicitly so output stays byte-identical
+to the baseline even for malformed streams.
+
+`decode_exact` returns the result as a `memoryview`, optionally backed by a
+`DecodeArena` that is reused across records; the PSM2/PSC3/PSB4/BMPA
+parsers only use `struct.unpack_from` and slicing, so they accept the view
+as-is.
+
+`decode_bytes` has the same signature and the same truncation / EOFError
+behaviour as `baseline.lz_decoder.decode_bytes`, so callers switch by
+changing the import only.
+"""
+from __future__ import annotations
+
+import argparse
+import sys
+from typing import Optional
+
+# 13-bit displacement; encoded 0 means the full window (baseline: capacity).
+WINDOW = 0x2000
+
+
+def _as_bytes(data) -> bytes | bytearray:
+    return data if isinstance(data, (bytes, bytearray)) else bytes(data)
+
+
+def calculate_decompressed_size(data: bytes | bytearray | memoryview, multi: bool = False) -> int:
+    """Token-level size pass; same result as the baseline function.
+
+    Raw payloads are skipped rather than scanned, so this costs a small
+    fraction of a decode.
+    """
+    src = _as_bytes(data)
+    n = len(src)
+    pos = 0
+    total = 0
+    while pos < n:
+        flag = src[pos]
+        pos += 1
+        if flag == 0:
+            if multi:
+                continue
+            break
+        if flag & 0x80:
+            if pos >= n:
+                break
+            pos += 1
+            total += (flag >> 5) | 4
+            while pos < n and (src[pos] & 0xE0) == 0x60:
+                total += src[pos] & 0x1F
+                pos += 1
+        elif flag & 0x40:
+            if (flag & 0x10) == 0:
+                length = (flag & 0x0F) + 4
+            else:
+                if pos >= n:
+                    break
+                length = ((flag & 0x0F) << 8) + src[pos] + 4
+                pos += 1
+            if pos >= n:
+                break
+            pos += 1
+            total += length
+        else:
+            if (flag & 0x20) == 0:
+                length = flag & 0x1F
+            else:
+                if pos >= n:
+                    break
+                length = ((flag & 0x1F) << 8) + src[pos]
+                pos += 1
+            step = min(length, n - pos)
+            pos += step
+            total += step
+    return total
+
+
+def _copy(out: bytearray, base: int, w: int, end: int, dist: int, length: int) -> int:
+    """Write a back-reference of `length` bytes at `out[w]`; returns new `w`.
+
+    `base` is the offset where the current stream started; history before
+    it reads as zero (fresh ring buffer in FUN_002f3118). Arena buffers are
+    reused, so the zeros are written explicitly.
+    """
+    length = min(length, end - w)
+    start = w - dist
+    if start < base:
+        pad = min(base - start, length)
+        out[w:w + pad] = bytes(pad)
+        w += pad
+        length -= pad
+        start += pad
+    if length <= 0:
+        return w
+    if dist >= length:
+        out[w:w + length] = out[start:start + length]
+    else:
+        out[w:w + length] = (out[start:w] * (length // dist + 1))[:length]
+    return w + length
+
+
+def _decode(src: bytes | bytearray, out: bytearray, w: int, end: int,
+            multi: bool, capped: bool) -> int:
+    """Decode `src` into the preallocated `out[w:end]`. Returns the end offset.
+
+    Every write is an equal-length slice assignment, so `out` is never
+    resized. When `capped` (caller-imposed size), decoding stops as soon as
+    `end` is reached; otherwise the remaining tokens are still walked so a
+    truncated tail raises EOFError exactly like the baseline.
+    """
+    n = len(src)
+    base = w
+    pos = 0
+
+    while pos < n:
+        if capped and w >= end:
+            break
+        flag = src[pos]
+        pos += 1
+
+        if flag == 0:
+            if multi:
+                base = w
+                continue
+            break
+
+        if flag & 0x80:
+            # LZ match start, then any run of 0x60 continue flags reusing
+            # the same displacement.
+            if pos >= n:
+                raise EOFError("Unexpected EOF reading displacement low byte")
+            disp = ((flag & 0x1F) << 8) | src[pos]
+            pos += 1
+            dist = disp or WINDOW
+            w = _copy(out, base, w, end, dist, (flag >> 5) | 4)
+            while pos < n and (src[pos] & 0xE0) == 0x60:
+                clen = src[pos] & 0x1F
+                pos += 1
+                if clen:
+                    w = _copy(out, base, w, end, dist, clen)
+        elif flag & 0x40:
+            # RLE
+            if (flag & 0x10) == 0:
+                length = (flag & 0x0F) + 4
+            else:
+                if pos >= n:
+                    raise EOFError("Unexpected EOF reading RLE length low byte")
+                length = ((flag & 0x0F) << 8) + src[pos] + 4
+                pos += 1
+            if pos >= n:
+                raise EOFError("Unexpected EOF reading RLE value byte")
+            length = min(length, end - w)
+            out[w:w + length] = bytes((src[pos],)) * length
+            w += length
+            pos += 1
+        else:
+            # Raw data
+            if (flag & 0x20) == 0:
+                length = flag & 0x1F
+            else:
+                if pos >= n:
+                    raise EOFError("Unexpected EOF reading raw length low byte")
+                length = ((flag & 0x1F) << 8) + src[pos]
+                pos += 1
+            if length:
+                chunk = src[pos:pos + min(length, end - w)]
+                out[w:w + len(chunk)] = chunk
+                w += len(chunk)
+                pos += length
+                if pos > n:
+                    # Truncated input: keep what we have and stop.
+                    break
+    return w
+
+
+def decode_exact(
+    data: bytes | bytearray | memoryview,
+    decompressed_size: Optional[int] = None,
+    *,
+    multi: bool = False,
+    arena: Optional["DecodeArena"] = None,
+) -> memoryview:
+    """Size pass, one exact allocation, then decode. Returns a memoryview.
+
+    Without `arena` the view owns a fresh `bytearray`. With `arena` the
+    view aliases the arena's buffer and is only valid until the next
+    `arena` decode.
+    """
+    src = _as_bytes(data)
+    size = calculate_decompressed_size(src, multi=multi)
+    capped = decompressed_size is not None and decompressed_size <= size
+    if capped:
+        size = decompressed_size
+    out = bytearray(size) if arena is None else arena.reserve(size)
+    w = _decode(src, out, 0, size, multi, capped)
+    return memoryview(out)[:w]
+
+
+class DecodeArena:
+    """Reusable output buffer for `decode_exact`.
+
+    Grows geometrically and never shrinks, so walking a whole MCB1 bundle
+    settles on one allocation the size of its largest record. Growth
+    allocates a new buffer instead of resizing, so views handed out earlier
+    keep the old one alive rather than raising BufferError.
+    """
+
+    def __init__(self, capacity: int = 1 << 20):
+        self._buf = bytearray(capacity)
+
+    def reserve(self, size: int) -> bytearray:
+        if size > len(self._buf):
+            cap = len(self._buf) or 1
+            while cap < size:
+                cap *= 2
+            self._buf = bytearray(cap)
+        return self._buf
+
+    def decode(self, data: bytes | bytearray | memoryview, *, multi: bool = False) -> memoryview:
+        return decode_exact(data, multi=multi, arena=self)
+
+
+def decode_bytes(data: bytes, decompressed_size: Optional[int] = None, *, multi: bool = False) -> bytes:
+    """Drop-in replacement for `baseline.lz_decoder.decode_bytes`."""
+    return decode_exact(data, decompressed_size, multi=multi).tobytes()
+
+
+def main(argv: list[str] | None = None) -> int:
+    p = argparse.ArgumentParser(description="Orphen LZ headerless decoder (FUN_002f3118), block-level")
+    p.add_argument("input", help="Input file (compressed)")
+    p.add_argument("output", nargs="?", help="Output file (decompressed); stdout if omitted")
+    p.add_argument("--size", type=int, default=None, help="Optional known decompressed size")
+    p.add_argument("--multi", action="store_true", help="Treat input as concatenated headerless streams")
+    args = p.parse_args(argv)
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+    out = decode_bytes(data, decompressed_size=args.size, multi=args.multi)
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(out)
+    else:
+        sys.stdout.buffer.write(out)
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
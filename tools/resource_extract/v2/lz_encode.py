@@ -0,0 +1,428 @@
+"""Headerless LZ encoder — the inverse of FUN_002f3118 (`lz.py`).
+
+Lets modded SCR / MAP / MCB payloads be packed back into the game's own
+format. The output uses only the grammar the decoder documents:
+
+    raw run       0x00|len (1..0x1F)  or  0x20|len>>8, len&0xFF  (..0x1FFF)
+    RLE run       0x40|len-4 (4..19)  or  0x50|(len-4)>>8, (len-4)&0xFF
+                  (..0x1003), then the value byte
+    LZ match      0x80|(len-4)<<5|disp>>8, disp&0xFF  (len 4..7)
+                  then 0x60|n continuation flags (n <= 0x1F) that copy
+                  n more bytes from the same displacement
+    end           0x00
+
+Displacements stay within 1..0x1FFF. RLE flags are kept in 0x40..0x5F so
+a token after a match is never mistaken for a 0x60 continuation.
+
+Matches are found with hash chains keyed on the next 4 bytes (the
+shortest match the grammar has), over the 0x1FFF-byte window; a
+candidate is extended with doubling slice compares, so long matches cost
+a few C-level compares instead of a byte loop.
+
+Two parsers:
+
+  greedy  (default) at each position take whichever of the longest match
+          and the RLE run saves more bytes, else a literal; a short
+          chain walk (`FAST_CHAIN`) keeps it fast.
+  optimal (`--optimal`) price every position once, front to back: the
+          cheapest way to reach each offset through literals (with the
+          raw-header bytes they cost), RLE runs of every useful length
+          and the longest match cut at each length whose token cost
+          changes, over a deeper chain walk (`OPTIMAL_CHAIN`). Repeats of
+          `NICE_LENGTH` or more are taken as they come. Typically 5-25%
+          smaller than greedy, and an order of magnitude slower.
+
+`encode_many` spreads payloads over a process pool; `--archive` round-trips
+every LZ entry of a flat-TOC BIN through decode -> encode -> decode and
+reports sizes against the 17-bit word field of the TOC.
+
+Pure Python (stdlib only), like the decoder.
+"""
+from __future__ import annotations
+
+import argparse
+import re
+import sys
+from concurrent.futures import ProcessPoolExecutor
+from typing import List, Optional, Sequence, Tuple
+
+from . import lz
+from .archive import SECTOR, FlatArchive
+
+MAX_DIST = 0x1FFF
+MAX_RAW = 0x1FFF
+MAX_RLE = 0x0FFF + 4
+MIN_MATCH = 4
+FIRST_MATCH = 7          # longest length the match flag itself carries
+MAX_CONT = 0x1F          # bytes per continuation flag
+
+# Largest payload a TOC word can describe (17-bit size in 32-bit words).
+MAX_ENTRY_BYTES = 0x1FFFF * 4
+
+FAST_CHAIN = 8
+OPTIMAL_CHAIN = 48
+# Matches are extended at most this far per search; longer repeats are
+# picked up again by the next search at the match end.
+MATCH_LIMIT = 0x4000
+# The optimal parse takes a match or run at least this long as is.
+NICE_LENGTH = 0x100
+
+_RUN_RE = re.compile(rb"(.)\1{3,}", re.S)
+
+
+# ---------------------------------------------------------------------------
+# Token costs / emitters
+# ---------------------------------------------------------------------------
+
+def match_cost(length: int) -> int:
+    extra = length - FIRST_MATCH
+    return 2 if extra <= 0 else 2 + (extra + MAX_CONT - 1) // MAX_CONT
+
+
+def rle_cost(length: int) -> int:
+    return 2 if length <= 19 else 3
+
+
+def _emit_raw(out: bytearray, data, a: int, b: int) -> None:
+    while a < b:
+        n = min(b - a, MAX_RAW)
+        if n <= 0x1F:
+            out.append(n)
+        else:
+            out += bytes((0x20 | (n >> 8), n & 0xFF))
+        out += data[a:a + n]
+        a += n
+
+
+def _emit_rle(out: bytearray, value: int, length: int) -> None:
+    n = length - 4
+    if n <= 0x0F:
+        out += bytes((0x40 | n, value))
+    else:
+        out += bytes((0x50 | (n >> 8), n & 0xFF, value))
+
+
+def _emit_match(out: bytearray, dist: int, length: int) -> None:
+    first = min(length, FIRST_MATCH)
+    out += bytes((0x80 | ((first - 4) << 5) | (dist >> 8), dist & 0xFF))
+    rest = length - first
+    while rest > 0:
+        n = min(rest, MAX_CONT)
+        out.append(0x60 | n)
+        rest -= n
+
+
+# ---------------------------------------------------------------------------
+# Match finding
+# ---------------------------------------------------------------------------
+
+def _common(data: bytes, a: int, b: int, limit: int) -> int:
+    """Length of the common prefix of data[a:] and data[b:] (a < b), at most
+    `limit`. Overlapping matches (b - a < length) compare correctly: the
+    decoder's byte-wise copy repeats exactly the bytes compared here."""
+    n = 0
+    step = 16
+    while n < limit:
+        k = min(step, limit - n)
+        if data[a + n:a + n + k] == data[b + n:b + n + k]:
+            n += k
+            step <<= 1
+        elif k == 1:
+            break
+        else:
+            step = k >> 1
+    return n
+
+
+class _Chains:
+    """Hash chains over 4-byte keys. The key is the 4 bytes themselves, so
+    every candidate is a real 4-byte match."""
+
+    def __init__(self, data: bytes, depth: int):
+        self.data = data
+        self.depth = depth
+        self.head: dict = {}
+        self.prev = [-1] * len(data)
+        self.filled = 0   # positions [0, filled) are inserted
+
+    def insert_to(self, end: int) -> None:
+        data, head, prev = self.data, self.head, self.prev
+        for i in range(self.filled, min(end, len(data) - 3)):
+            key = data[i:i + 4]
+            prev[i] = head.get(key, -1)
+            head[key] = i
+        self.filled = max(self.filled, end)
+
+    def longest(self, p: int, limit: int) -> Tuple[int, int]:
+        """(length, distance) of the longest match at `p` (0, 0 if none);
+        positions before `p` must be inserted."""
+        data, prev = self.data, self.prev
+        cand = self.head.get(data[p:p + 4], -1)
+        best_len = best_dist = 0
+        depth = self.depth
+        lo = p - MAX_DIST
+        while cand >= lo and cand >= 0 and depth:
+            # Cheap reject: a longer match must also agree at best_len.
+            if best_len < limit and data[cand + best_len] == data[p + best_len]:
+                n = _common(data, cand, p, limit)
+                if n > best_len:
+                    best_len, best_dist = n, p - cand
+                    if n >= limit:
+                        break
+            cand = prev[cand]
+            depth -= 1
+        return best_len, best_dist
+
+
+def _runs(data: bytes) -> List[int]:
+    """run[i] = number of bytes equal to data[i] from i to the end of its
+    run, for positions inside runs of 4 or more (0 elsewhere)."""
+    run = [0] * (len(data) + 1)
+    for m in _RUN_RE.finditer(data):
+        a, b = m.span()
+        run[a:b] = range(b - a, 0, -1)
+    return run
+
+
+# ---------------------------------------------------------------------------
+# Parsers
+# ---------------------------------------------------------------------------
+
+def _prefer_rle(r: int, m: int) -> bool:
+    """RLE run of `r` or match of `m` at the same position: the run wins
+    unless the match covers more than the run for fewer bytes than the run
+    plus a match over the rest."""
+    if r < 4:
+        return False
+    if m < r + MIN_MATCH:
+        return True
+    return rle_cost(r) + match_cost(m - r) <= match_cost(m)
+
+
+def _encode_greedy(data: bytes, out: bytearray) -> None:
+    n = len(data)
+    chains = _Chains(data, FAST_CHAIN)
+    run = _runs(data)
+    p = lit = 0
+    while p + MIN_MATCH <= n:
+        chains.insert_to(p)
+        r = min(run[p], MAX_RLE)
+        m, d = chains.longest(p, min(n - p, MATCH_LIMIT))
+        if r < 4 and m < MIN_MATCH:
+            p += 1
+            continue
+        _emit_raw(out, data, lit, p)
+        if _prefer_rle(r, m):
+            _emit_rle(out, data[p], r)
+            p += r
+        else:
+            _emit_match(out, d, m)
+            p += m
+        lit = p
+    _emit_raw(out, data, lit, n)
+
+
+def _match_lengths(m: int) -> range | List[int]:
+    """Lengths worth pricing for a match of up to `m` bytes: every short
+    length, then the longest length of each continuation-flag count."""
+    if m <= FIRST_MATCH + MAX_CONT:
+        return range(MIN_MATCH, m + 1)
+    out = list(range(MIN_MATCH, FIRST_MATCH + MAX_CONT + 1))
+    out.extend(range(FIRST_MATCH + 2 * MAX_CONT, m, MAX_CONT))
+    out.append(m)
+    return out
+
+
+def _encode_optimal(data: bytes, out: bytearray) -> None:
+    n = len(data)
+    INF = 1 << 60
+    chains = _Chains(data, OPTIMAL_CHAIN)
+    run = _runs(data)
+    # cost[i]: cheapest encoding of data[:i] that ends on a token boundary;
+    # lit_cost[i] / lit_len[i]: cheapest ending inside a raw run of that length.
+    cost = [INF] * (n + 1)
+    lit_cost = [INF] * (n + 1)
+    lit_len = [0] * (n + 1)
+    # back[i] = (kind, length, dist) of the token ending at i.
+    back: List[Optional[tuple]] = [None] * (n + 1)
+    cost[0] = 0
+    i = 0
+    while i < n:
+        if lit_cost[i] < cost[i]:
+            cost[i] = lit_cost[i]
+            back[i] = ("raw", lit_len[i], 0)
+        c = cost[i]
+        # Literal: extend the raw run ending here or open a new one.
+        if lit_cost[i] <= c and lit_len[i] and lit_len[i] < MAX_RAW:
+            k = lit_len[i] + 1
+            lc = lit_cost[i] + 1 + (k == 0x20)
+        else:
+            k = 1
+            lc = c + 2
+        if lc < lit_cost[i + 1]:
+            lit_cost[i + 1] = lc
+            lit_len[i + 1] = k
+        if i + MIN_MATCH > n:
+            i += 1
+            continue
+        r = min(run[i], MAX_RLE)
+        chains.insert_to(i)
+        m, d = chains.longest(i, min(n - i, MATCH_LIMIT))
+        if max(r, m) >= NICE_LENGTH:
+            # Long repeat: take it outright instead of pricing every
+            # position inside it.
+            if _prefer_rle(r, m):
+                length, tc, tok = r, rle_cost(r), ("rle", r, 0)
+            else:
+                length, tc, tok = m, match_cost(m), ("lz", m, d)
+            j = i + length
+            if c + tc <= cost[j]:
+                cost[j] = c + tc
+                back[j] = tok
+            i = j
+            continue
+        if r >= 4:
+            for length in (range(4, min(r, 19) + 1) if r < 20 else (*range(4, 20), r)):
+                j = i + length
+                if c + rle_cost(length) < cost[j]:
+                    cost[j] = c + rle_cost(length)
+                    back[j] = ("rle", length, 0)
+        if m >= MIN_MATCH:
+            for length in _match_lengths(m):
+                j = i + length
+                mc = c + match_cost(length)
+                if mc < cost[j]:
+                    cost[j] = mc
+                    back[j] = ("lz", length, d)
+        i += 1
+    if lit_cost[n] < cost[n]:
+        back[n] = ("raw", lit_len[n], 0)
+
+    tokens = []
+    i = n
+    while i > 0:
+        kind, length, dist = back[i]
+        # Raw runs were priced byte by byte; `length` covers the whole run.
+        tokens.append((kind, i - length, i, dist))
+        i -= length
+    for kind, a, b, dist in reversed(tokens):
+        if kind == "raw":
+            _emit_raw(out, data, a, b)
+        elif kind == "rle":
+            _emit_rle(out, data[a], b - a)
+        else:
+            _emit_match(out, dist, b - a)
+
+
+def encode(data, *, optimal: bool = False) -> bytes:
+    """Compressed stream (with the 0x00 terminator) that `lz.decode_bytes`
+    turns back into `data`."""
+    data = bytes(data)
+    out = bytearray()
+    if optimal:
+        _encode_optimal(data, out)
+    else:
+        _encode_greedy(data, out)
+    out.append(0)
+    return bytes(out)
+
+
+def _encode_one(args: Tuple[bytes, bool]) -> bytes:
+    data, optimal = args
+    return encode(data, optimal=optimal)
+
+
+def encode_many(payloads: Sequence[bytes], *, optimal: bool = False,
+                jobs: int = 1) -> List[bytes]:
+    """`encode` each payload, over `jobs` worker processes (0 = all cores);
+    results keep the input order."""
+    if jobs == 1 or len(payloads) < 2:
+        return [encode(p, optimal=optimal) for p in payloads]
+    with ProcessPoolExecutor(max_workers=jobs or None) as pool:
+        return list(pool.map(_encode_one, [(bytes(p), optimal) for p in payloads],
+                             chunksize=4))
+
+
+# ---------------------------------------------------------------------------
+# Archive round trip
+# ---------------------------------------------------------------------------
+
+def _roundtrip_entry(args: Tuple[int, bytes, bool]) -> Tuple[int, int, int, int, str]:
+    """(index, packed size, decoded size, new size, status) of one entry."""
+    index, raw, optimal = args
+    try:
+        plain = lz.decode_bytes(raw)
+    except Exception:
+        return index, len(raw), 0, 0, "not-lz"
+    packed = encode(plain, optimal=optimal)
+    if lz.decode_bytes(packed) != plain:
+        return index, len(raw), len(plain), len(packed), "MISMATCH"
+    return index, len(raw), len(plain), len(packed), "ok"
+
+
+def roundtrip_archive(path: str, *, optimal: bool = False, jobs: int = 1) -> List[tuple]:
+    """Decode, re-encode and re-decode every non-empty entry of a flat-TOC
+    BIN; one `_roundtrip_entry` tuple per entry, in TOC order."""
+    arc = FlatArchive(path)
+    work = [(e.index, bytes(v), optimal) for e, v in arc.iter_payloads()]
+    # Largest first so one big entry doesn't finish the run alone.
+    work.sort(key=lambda w: -len(w[1]))
+    if jobs == 1:
+        results = [_roundtrip_entry(w) for w in work]
+    else:
+        with ProcessPoolExecutor(max_workers=jobs or None) as pool:
+            results = list(pool.map(_roundtrip_entry, work))
+    return sorted(results)
+
+
+def _slot(size: int) -> int:
+    return -(-size // SECTOR) * SECTOR
+
+
+def main(argv: list[str] | None = None) -> int:
+    p = argparse.ArgumentParser(description="Orphen LZ headerless encoder (inverse of FUN_002f3118)")
+    p.add_argument("input", help="Input file (decompressed), or a flat-TOC BIN with --archive")
+    p.add_argument("output", nargs="?", help="Output file (compressed); stdout if omitted")
+    p.add_argument("--optimal", action="store_true", help="Optimal parse (smaller, slower)")
+    p.add_argument("--archive", action="store_true",
+                   help="Round-trip every LZ entry of a flat-TOC BIN and report sizes")
+    p.add_argument("--jobs", type=int, default=1, help="Worker processes for --archive (0 = all cores)")
+    args = p.parse_args(argv)
+
+    if args.archive:
+        results = roundtrip_archive(args.input, optimal=args.optimal, jobs=args.jobs)
+        old = new = fit = over = bad = skipped = 0
+        for index, raw_size, _plain_size, new_size, status in results:
+            if status == "not-lz":
+                skipped += 1
+                continue
+            if status != "ok":
+                bad += 1
+                print(f"  entry {index}: round trip MISMATCH", file=sys.stderr)
+                continue
+            old += raw_size
+            new += new_size
+            fit += new_size <= _slot(raw_size)
+            if new_size > MAX_ENTRY_BYTES:
+                over += 1
+                print(f"  entry {index}: {new_size:,} bytes exceeds the TOC size field", file=sys.stderr)
+        done = len(results) - skipped - bad
+        print(f"{args.input}: {done} entries re-encoded ({skipped} not LZ, {bad} mismatched)")
+        if done:
+            print(f"  packed {old:,} -> {new:,} bytes ({100.0 * new / max(old, 1):.1f}%), "
+                  f"{fit} fit their original sectors, {over} too large for the TOC")
+        return 1 if bad or over else 0
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+    out = encode(data, optimal=args.optimal)
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(out)
+    else:
+        sys.stdout.buffer.write(out)
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
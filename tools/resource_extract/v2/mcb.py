@@ -15,6 +15,7 @@ Layout:
 
   MCB1.BIN : ~295 MB raw section blobs concatenated; NOT LZ-compressed at
              this level (the loader reads the bytes straight into RAM).
+             We memory-map it instead of reading it (see archive.py).
 
 This tool dumps every non-empty slot to a file named `s{section:02d}_e{entry:03d}.bin`
 and prints a summary with the magic of each chunk so we can tell the formats
@@ -26,7 +27,9 @@ import argparse
 import os
 import struct
 from collections import Counter
-from typing import List, Tuple
+from typing import Iterator, List, Tuple
+
+from .archive import map_file
 
 N_SECTIONS = 15
 N_ENTRIES = 100
@@ -48,36 +51,45 @@ def load_mcb0(path: str) -> List[List[Tuple[int, int]]]:
     return sections
 
 
+def iter_bundles(mcb0_path: str, mcb1_path: str, verbose: bool = False
+                 ) -> Iterator[Tuple[int, int, int, memoryview]]:
+    """Yield (section, entry, offset, view) for every non-empty slot.
+
+    MCB1 is memory-mapped (archive.map_file); each view is a zero-copy
+    slice of the mapping, so walking all bundles never holds more than the
+    pages being read.
+    """
+    sections = load_mcb0(mcb0_path)
+    mcb1 = map_file(mcb1_path)
+    for s_idx, section in enumerate(sections):
+        for e_idx, (off, size) in enumerate(section):
+            if size == 0:
+                continue
+            if off + size > len(mcb1):
+                if verbose:
+                    print(f"[warn] s{s_idx:02d}_e{e_idx:03d}: "
+                          f"range {off:#x}+{size} exceeds MCB1 size")
+                continue
+            yield s_idx, e_idx, off, mcb1[off:off + size]
+
+
 def extract(mcb0_path: str, mcb1_path: str, dst_dir: str,
             verbose: bool = False) -> Tuple[int, Counter]:
-    sections = load_mcb0(mcb0_path)
     os.makedirs(dst_dir, exist_ok=True)
     magics: Counter = Counter()
     written = 0
-    mcb1_size = os.path.getsize(mcb1_path)
-    with open(mcb1_path, 'rb') as fh:
-        for s_idx, section in enumerate(sections):
-            for e_idx, (off, size) in enumerate(section):
-                if size == 0:
-                    continue
-                if off + size > mcb1_size:
-                    if verbose:
-                        print(f"[warn] s{s_idx:02d}_e{e_idx:03d}: "
-                              f"range {off:#x}+{size} exceeds MCB1 size")
-                    continue
-                fh.seek(off)
-                blob = fh.read(size)
-                out_name = f"s{s_idx:02d}_e{e_idx:03d}.bin"
-                with open(os.path.join(dst_dir, out_name), 'wb') as out:
-                    out.write(blob)
-                written += 1
-                # Capture 4-byte magic for the summary
-                m4 = blob[:4] if len(blob) >= 4 else blob.ljust(4, b'\x00')
-                ascii4 = ''.join(chr(b) if 32 <= b < 127 else '.' for b in m4)
-                magics[(m4.hex(), ascii4)] += 1
-                if verbose:
-                    print(f"[ok]   s{s_idx:02d}_e{e_idx:03d}: "
-                          f"off={off:#010x} size={size:>10}  magic={ascii4!r}")
+    for s_idx, e_idx, off, blob in iter_bundles(mcb0_path, mcb1_path, verbose):
+        out_name = f"s{s_idx:02d}_e{e_idx:03d}.bin"
+        with open(os.path.join(dst_dir, out_name), 'wb') as out:
+            out.write(blob)
+        written += 1
+        # Capture 4-byte magic for the summary
+        m4 = bytes(blob[:4]).ljust(4, b'\x00')
+        ascii4 = ''.join(chr(b) if 32 <= b < 127 else '.' for b in m4)
+        magics[(m4.hex(), ascii4)] += 1
+        if verbose:
+            print(f"[ok]   s{s_idx:02d}_e{e_idx:03d}: "
+                  f"off={off:#010x} size={len(blob):>10}  magic={ascii4!r}")
     return written, magics
 
 
@@ -38,7 +38,8 @@ import sys
 from collections import Counter
 from typing import Iterator, Tuple
 
-from ..baseline.lz_decoder import decode_bytes as lz_decode
+from .archive import map_file
+from .decode_cache import decoder
 
 CATEGORY_NAMES = {
     0x0000: "grp",
@@ -50,8 +51,12 @@ CATEGORY_NAMES = {
 }
 
 
-def iter_records(buf: bytes) -> Iterator[Tuple[int, int, int, int, bytes]]:
-    """Yield (id, category, resource_id, offset, payload) per record."""
+def iter_records(buf: bytes | memoryview) -> Iterator[Tuple[int, int, int, int, bytes | memoryview]]:
+    """Yield (id, category, resource_id, offset, payload) per record.
+
+    `payload` is a slice of `buf`; pass a memoryview (e.g. from
+    archive.map_file or mcb.iter_bundles) to get zero-copy payloads.
+    """
     p = 0
     n = len(buf)
     while p + 8 <= n:
@@ -81,8 +86,9 @@ def _classify(buf: bytes) -> str:
     return "bin"
 
 
-def extract_bundle(bundle_path: str, dst_dir: str) -> dict:
-    buf = open(bundle_path, "rb").read()
+def extract_bundle(bundle_path: str, dst_dir: str, cache_dir: str | None = None) -> dict:
+    lz_decode = decoder(cache_dir)
+    buf = map_file(bundle_path)
     os.makedirs(dst_dir, exist_ok=True)
     stats: Counter = Counter()
     manifest: list[str] = []
@@ -109,7 +115,8 @@ def extract_bundle(bundle_path: str, dst_dir: str) -> dict:
     return dict(stats)
 
 
-def run(src: str, dst: str, limit: int | None = None) -> None:
+def run(src: str, dst: str, limit: int | None = None,
+        cache_dir: str | None = None) -> None:
     os.makedirs(dst, exist_ok=True)
     total: Counter = Counter()
     bundles = sorted(fn for fn in os.listdir(src) if fn.endswith(".bin"))
@@ -118,7 +125,7 @@ def run(src: str, dst: str, limit: int | None = None) -> None:
     for fn in bundles:
         stem = os.path.splitext(fn)[0]
         sub = os.path.join(dst, stem)
-        stats = extract_bundle(os.path.join(src, fn), sub)
+        stats = extract_bundle(os.path.join(src, fn), sub, cache_dir=cache_dir)
         for k, v in stats.items():
             total[k] += v
     print(f"Processed {len(bundles)} bundle(s).  Totals:")
@@ -134,8 +141,10 @@ def main(argv=None) -> int:
                     help="Output root (one subdir per bundle)")
     ap.add_argument("--limit", type=int, default=None,
                     help="Only process the first N bundles (debug)")
+    ap.add_argument("--cache", default=None,
+                    help="Decoded-payload cache directory (see decode_cache.py)")
     args = ap.parse_args(argv)
-    run(args.src, args.dst, limit=args.limit)
+    run(args.src, args.dst, limit=args.limit, cache_dir=args.cache)
     return 0
 
 
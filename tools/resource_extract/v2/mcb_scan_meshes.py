@@ -23,6 +23,7 @@ from typing import List
 from tools.resource_extract.v2 import psm2 as psm2_mod
 from tools.resource_extract.v2 import psc3 as psc3_mod
 from tools.resource_extract.v2 import psb4 as psb4_mod
+from tools.resource_extract.v2.bytescan import scanner_for
 
 MAGIC_MAP = {
     b'PSM2': ('PSM2', psm2_mod),
@@ -31,18 +32,6 @@ MAGIC_MAP = {
 }
 
 
-def _find_all(buf: bytes, needle: bytes) -> List[int]:
-    out: List[int] = []
-    pos = 0
-    while True:
-        i = buf.find(needle, pos)
-        if i < 0:
-            break
-        out.append(i)
-        pos = i + 1
-    return out
-
-
 def _is_plausible_psc3(buf: bytes, off: int) -> bool:
     if off + 0x30 > len(buf):
         return False
@@ -101,12 +90,9 @@ def process_bundle(bundle_path: str, dst_dir: str,
                    tag: str) -> Counter:
     buf = open(bundle_path, 'rb').read()
     stats: Counter = Counter()
-    # Gather all candidate (offset, magic) tuples
-    hits = []
-    for needle, (name, _mod) in MAGIC_MAP.items():
-        for i in _find_all(buf, needle):
-            hits.append((i, name))
-    hits.sort()
+    # Gather all candidate (offset, magic) tuples in one pass
+    names = [name for name, _mod in MAGIC_MAP.values()]
+    hits = [(i, names[k]) for i, k in scanner_for(*names).scan(buf)]
 
     for idx, (off, name) in enumerate(hits):
         # Slice from this magic to the next magic (or EOF)
@@ -10,6 +10,11 @@ write the decoded artifact directly as a usable file:
 Plus a `_manifest.txt` per bundle listing every record's id, category,
 magic, decoded size, and the file written.
 
+With `--incremental`, each record's compressed-bytes digest and the code
+version of the parser for its kind go into `<dst>/_build.json`
+(build_graph.py); records whose files are up to date are neither decoded
+nor rewritten, and their manifest lines are reused.
+
 Usage:
     python -m tools.resource_extract.v2.mcb_unpack_all \
         --src out/all/mcb/s01_e011.bin --dst out/all/mcb_full/s01_e011
@@ -20,7 +25,7 @@ Usage:
 
 This is just glue around the existing modules:
     mcb_bundle.iter_records        (linked-list walker)
-    baseline.lz_decoder.decode_bytes
+    lz.DecodeArena                 (headerless LZ, FUN_002f3118)
     psm2 / psc3 / psb4             (mesh parsers)
     bmpa                           (texture parser + PNG writer)
 """
@@ -33,7 +38,10 @@ from collections import Counter
 from pathlib import Path
 from typing import Iterable
 
-from ..baseline.lz_decoder import decode_bytes as lz_decode
+from .archive import map_file
+from .build_graph import BuildState, code_version, digest_bytes
+from .decode_cache import open_cache
+from .lz import DecodeArena
 from . import bmpa as bmpa_mod
 from . import mcb_bundle
 from . import psb4 as psb4_mod
@@ -44,6 +52,16 @@ from . import psm2 as psm2_mod
 
 CATEGORY_NAMES = mcb_bundle.CATEGORY_NAMES
 
+# Modules each record kind's output depends on, beyond the walker + LZ.
+_KIND_CODE = {
+    "psm2": ("psm2",),
+    "psc3": ("psc3_full",),
+    "psb4": ("psb4",),
+    "bmpa": ("bmpa",),
+    "bin": (),
+}
+_BASE_CODE = ("mcb_unpack_all", "mcb_bundle", "lz", "decode_cache", "archive")
+
 
 # ---------------------------------------------------------------------------
 # Mesh OBJ writer — copied verbatim from dump_map_objs._write_obj so the
@@ -108,66 +126,144 @@ def _extract_mesh_obj(payload: bytes, kind: str, out_path: Path, name: str) -> b
     return False
 
 
-def unpack_bundle(bundle_path: Path, out_dir: Path) -> Counter:
-    """Unpack one bundle file into `out_dir` (created if missing)."""
-    buf = bundle_path.read_bytes()
+def _record_inputs(src: str, kind: str, out_dir: Path) -> dict:
+    """Inputs of a `kind` record's outputs (`src` = compressed-bytes digest).
+    PSC3 MTLs list the bundle's tex PNGs, so their names are an input too;
+    unpack_bundle handles PSC3 records last, once every PNG is written."""
+    inputs = {"src": src,
+              "code": code_version(*_KIND_CODE.get(kind, ()), shallow=_BASE_CODE)}
+    if kind == "psc3":
+        inputs["tex"] = digest_bytes(" ".join(sorted(
+            p.name for p in out_dir.glob("tex_*.png"))).encode())
+    return inputs
+
+
+def _write_record(decoded, kind: str, base: str, cat_name: str, out_dir: Path,
+                  rec: Counter) -> tuple[str, list[Path]]:
+    """Write one decoded record's files; returns (manifest field, outputs)."""
+    outputs: list[Path] = []
+    written = "-"
+    try:
+        if kind in ("psm2", "psc3", "psb4"):
+            obj_path = out_dir / f"{base}.obj"
+            ok = _extract_mesh_obj(decoded, kind, obj_path, base)
+            rec[f"{cat_name}_{kind}"] += 1
+            rec[f"{kind}_{'ok' if ok else 'empty'}"] += 1
+            written = obj_path.name if ok else f"{base}.{kind} (empty)"
+            if ok:
+                outputs.append(obj_path)
+            # Also save the raw decoded payload next to the OBJ for
+            # downstream tooling / re-parsing.
+            (out_dir / f"{base}.{kind}").write_bytes(decoded)
+            outputs.append(out_dir / f"{base}.{kind}")
+        elif kind == "bmpa":
+            png_path = out_dir / f"{base}.png"
+            img = bmpa_mod.parse(decoded)
+            bmpa_mod.write_png(img, png_path)
+            rec[f"{cat_name}_bmpa"] += 1
+            written = png_path.name
+            (out_dir / f"{base}.bmpa").write_bytes(decoded)
+            outputs += [png_path, out_dir / f"{base}.bmpa"]
+        else:
+            bin_path = out_dir / f"{base}.bin"
+            bin_path.write_bytes(decoded)
+            rec[f"{cat_name}_bin"] += 1
+            written = bin_path.name
+            outputs.append(bin_path)
+    except Exception as exc:  # noqa: BLE001
+        rec[f"{kind}_fail"] += 1
+        written = f"FAIL: {exc}"
+    return f"{len(decoded):>9,}  {kind:<4}   {written}", outputs
+
+
+def unpack_bundle(bundle_path: Path, out_dir: Path, cache_dir: str | None = None,
+                  state: BuildState | None = None) -> Counter:
+    """Unpack one bundle file into `out_dir` (created if missing).
+
+    With `cache_dir`, decoded payloads come from (and go to) the shared
+    decode_cache store instead of the per-bundle arena. With an enabled
+    `state`, up-to-date records are skipped.
+
+    PSC3 records are written after all the others: their MTLs list the
+    bundle's tex_*.png files, which must all exist by then. The manifest
+    keeps record order.
+    """
+    buf = map_file(str(bundle_path))
     out_dir.mkdir(parents=True, exist_ok=True)
+    state = state or BuildState(str(out_dir), enabled=False)
 
     stats: Counter = Counter()
+    # Without a cache: one exact-size output buffer reused for every record;
+    # `decoded` is a view into it and is only valid until the next decode.
+    lz_decode = open_cache(cache_dir).decode if cache_dir else DecodeArena().decode
     manifest_lines: list[str] = [
         f"# bundle: {bundle_path.name}  ({len(buf):,} bytes)",
         f"# fields: offset  id          cat   rid    raw_size   kind   written",
     ]
+    seen: Counter = Counter()
+    # (manifest slot, state key, src digest, base, cat name, payload, decoded or None)
+    deferred: list[tuple] = []
+
+    def finish(slot: int, key: str | None, src: str | None, kind: str,
+               rec: Counter, line: str, outputs: list[Path]) -> None:
+        stats.update(rec)
+        manifest_lines[slot] += line
+        if key is not None:
+            state.record(key, _record_inputs(src, kind, out_dir), [str(o) for o in outputs],
+                         {"kind": kind, "line": line, "stats": dict(rec)})
+
+    def up_to_date(slot: int, key: str, src: str, kind: str) -> bool:
+        hit = state.check(key, _record_inputs(src, kind, out_dir))
+        if hit:
+            stats.update(hit["stats"])
+            manifest_lines[slot] += hit["line"]
+        return bool(hit)
+
+    def process(slot: int, key: str | None, src: str | None, base: str, cat_name: str,
+                payload, decoded, defer_psc3: bool) -> None:
+        rec: Counter = Counter({"records": 1})
+        if decoded is None:
+            # LZ-decode every payload.
+            try:
+                decoded = lz_decode(payload)
+            except Exception as exc:  # noqa: BLE001
+                rec["lz_fail"] += 1
+                finish(slot, key, src, "bin", rec, f"LZ FAIL: {exc}", [])
+                return
+        kind = _classify_magic(decoded)
+        if kind == "psc3" and defer_psc3:
+            deferred.append((slot, key, src, base, cat_name, payload, bytes(decoded)))
+            return
+        finish(slot, key, src, kind, rec,
+               *_write_record(decoded, kind, base, cat_name, out_dir, rec))
 
     for idv, cat, rid, offset, payload in mcb_bundle.iter_records(buf):
-        stats["records"] += 1
         cat_name = CATEGORY_NAMES.get(cat, f"cat{cat:04x}")
-
-        # LZ-decode every payload.
-        try:
-            decoded = bytes(lz_decode(payload))
-        except Exception as exc:  # noqa: BLE001
-            stats["lz_fail"] += 1
-            manifest_lines.append(
-                f"  @0x{offset:07x}  {idv:#010x}  {cat_name:<4}  0x{rid:04x}  "
-                f"LZ FAIL: {exc}"
-            )
-            continue
-
-        kind = _classify_magic(decoded)
         base = f"{cat_name}_{rid:04x}"
-        written = "-"
-
-        try:
-            if kind in ("psm2", "psc3", "psb4"):
-                obj_path = out_dir / f"{base}.obj"
-                ok = _extract_mesh_obj(decoded, kind, obj_path, base)
-                stats[f"{cat_name}_{kind}"] += 1
-                stats[f"{kind}_{'ok' if ok else 'empty'}"] += 1
-                written = obj_path.name if ok else f"{base}.{kind} (empty)"
-                # Also save the raw decoded payload next to the OBJ for
-                # downstream tooling / re-parsing.
-                (out_dir / f"{base}.{kind}").write_bytes(decoded)
-            elif kind == "bmpa":
-                png_path = out_dir / f"{base}.png"
-                img = bmpa_mod.parse(decoded)
-                bmpa_mod.write_png(img, png_path)
-                stats[f"{cat_name}_bmpa"] += 1
-                written = png_path.name
-                (out_dir / f"{base}.bmpa").write_bytes(decoded)
-            else:
-                bin_path = out_dir / f"{base}.bin"
-                bin_path.write_bytes(decoded)
-                stats[f"{cat_name}_bin"] += 1
-                written = bin_path.name
-        except Exception as exc:  # noqa: BLE001
-            stats[f"{kind}_fail"] += 1
-            written = f"FAIL: {exc}"
-
-        manifest_lines.append(
-            f"  @0x{offset:07x}  {idv:#010x}  {cat_name:<4}  0x{rid:04x}  "
-            f"{len(decoded):>9,}  {kind:<4}   {written}"
-        )
+        slot = len(manifest_lines)
+        manifest_lines.append(f"  @0x{offset:07x}  {idv:#010x}  {cat_name:<4}  0x{rid:04x}  ")
+
+        key = src = None
+        if state.enabled:
+            # Records are keyed by output name (plus an occurrence count
+            # for repeats), so an edit earlier in the bundle doesn't
+            # invalidate everything after it. The kind is the previous
+            # build's: the same bytes and LZ code decode to the same magic.
+            key = f"{out_dir.name}/{base}" + (f"#{seen[base]}" if seen[base] else "")
+            seen[base] += 1
+            src = digest_bytes(payload)
+            prev = state.meta(key)
+            if prev and prev["kind"] == "psc3":
+                deferred.append((slot, key, src, base, cat_name, payload, None))
+                continue
+            if prev and up_to_date(slot, key, src, prev["kind"]):
+                continue
+        process(slot, key, src, base, cat_name, payload, None, True)
+
+    for slot, key, src, base, cat_name, payload, decoded in deferred:
+        if decoded is None and up_to_date(slot, key, src, "psc3"):
+            continue
+        process(slot, key, src, base, cat_name, payload, decoded, False)
 
     (out_dir / "_manifest.txt").write_text("\n".join(manifest_lines) + "\n")
     return stats
@@ -182,6 +278,9 @@ def main(argv: list[str] | None = None) -> int:
     ap.add_argument("--src", required=True, help="Bundle file OR directory of *.bin bundles")
     ap.add_argument("--dst", required=True, help="Output root directory")
     ap.add_argument("--limit", type=int, default=None, help="Only process first N bundles (dir mode)")
+    ap.add_argument("--cache", default=None, help="Decoded-payload cache directory (see decode_cache.py)")
+    ap.add_argument("--incremental", action="store_true",
+                    help="Skip records whose bytes and parser code match <dst>/_build.json")
     args = ap.parse_args(argv)
 
     src = Path(args.src)
@@ -198,14 +297,18 @@ def main(argv: list[str] | None = None) -> int:
         bundles = bundles[: args.limit]
 
     grand = Counter()
+    state = BuildState(str(dst), enabled=args.incremental)
     for b in bundles:
         sub = dst / b.stem if len(bundles) > 1 else dst
-        stats = unpack_bundle(b, sub)
+        stats = unpack_bundle(b, sub, cache_dir=args.cache, state=state)
         grand.update(stats)
+    state.save()
 
     print(f"Processed {len(bundles)} bundle(s). Totals:")
     for k in sorted(grand):
         print(f"  {k:<20} {grand[k]}")
+    if args.incremental:
+        print(f"build: {state.summary()}")
     return 0
 
 
@@ -0,0 +1,293 @@
+"""Quadric-error LOD chains for exported meshes.
+
+``simplify_levels`` takes one welded triangle soup (``mesh_opt.weld``
+output: one vertex per distinct attribute tuple, triangles split into
+material groups) and returns progressively coarser index lists over the
+SAME vertex buffer. Every step is a half-edge collapse, p -> q: the
+triangles around position p are re-pointed at vertices that already sit
+at q, so the levels only differ in their index buffers.
+
+Cost is the Garland-Heckbert quadric of both endpoints evaluated at q,
+with extra planes along open boundaries so outlines stay put. A collapse
+is refused when it would
+
+  - move a locked position (shared with a neighbouring group, so groups
+    simplified independently still meet without cracks),
+  - move a boundary position off its boundary, or touch a non-manifold
+    edge,
+  - break the link condition (fold two fans into each other),
+  - turn a triangle more than 60 degrees away from its input normal
+    (so no flips, and no slivers built up over many small turns),
+  - cross a UV or material seam: each attribute vertex (wedge) at p must
+    reach exactly one wedge at q across a shared triangle, and that wedge
+    takes over its corners. A seam position therefore only slides along
+    the seam, and a corner never picks up a UV from another chart or a
+    material it was not in.
+
+Cross-seam collapses that would need new attribute values are left
+alone; the mesh stops simplifying there instead of smearing textures.
+"""
+from __future__ import annotations
+
+import heapq
+import math
+from typing import Dict, Hashable, List, Optional, Sequence, Set, Tuple
+
+Vec3 = Tuple[float, float, float]
+Groups = Dict[Hashable, List[int]]
+
+BOUNDARY_WEIGHT = 10.0
+MIN_REDUCTION = 0.9   # a level must keep at most this share of the previous one
+FLIP_COS = 0.5
+
+
+def _sub(a: Vec3, b: Vec3) -> Vec3:
+    return a[0] - b[0], a[1] - b[1], a[2] - b[2]
+
+
+def _cross(a: Vec3, b: Vec3) -> Vec3:
+    return a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]
+
+
+def _dot(a: Vec3, b: Vec3) -> float:
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]
+
+
+def _plane_quadric(n: Vec3, p: Vec3, w: float = 1.0) -> List[float]:
+    """10 upper-triangle terms of w * (n, d)(n, d)^T for the plane through p."""
+    a, b, c = n
+    d = -_dot(n, p)
+    return [w * v for v in (a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d)]
+
+
+def _q_add(q: List[float], r: Sequence[float]) -> None:
+    for i in range(10):
+        q[i] += r[i]
+
+
+def _q_eval(q: Sequence[float], v: Vec3) -> float:
+    x, y, z = v
+    return max(0.0, q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+               + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+               + q[7] * z * z + 2 * q[8] * z + q[9])
+
+
+class _Simplifier:
+    def __init__(self, positions: Sequence[Vec3], groups: Groups, locked: Set[Vec3]):
+        self.positions = positions
+        self.tris: List[List[int]] = []
+        self.tri_group: List[Hashable] = []
+        for key, idx in groups.items():
+            for t in range(0, len(idx) - 2, 3):
+                self.tris.append(list(idx[t:t + 3]))
+                self.tri_group.append(key)
+        self.alive = bytearray(b"\x01") * len(self.tris)
+        self.count = len(self.tris)
+
+        self.pid: Dict[int, int] = {}
+        self.ppos: List[Vec3] = []
+        by_pos: Dict[Vec3, int] = {}
+        self.wedges: List[Set[int]] = []
+        self.vtris: Dict[int, Set[int]] = {}
+        for t, tri in enumerate(self.tris):
+            for v in tri:
+                if v not in self.pid:
+                    p = tuple(positions[v])
+                    i = by_pos.get(p)
+                    if i is None:
+                        i = by_pos[p] = len(self.ppos)
+                        self.ppos.append(p)
+                        self.wedges.append(set())
+                    self.pid[v] = i
+                    self.wedges[i].add(v)
+                self.vtris.setdefault(v, set()).add(t)
+        self.locked = bytearray(len(self.ppos))
+        for p, i in by_pos.items():
+            if p in locked:
+                self.locked[i] = 1
+        self.dead = bytearray(len(self.ppos))
+        self.version = [0] * len(self.ppos)
+
+        self.quadrics = [[0.0] * 10 for _ in self.ppos]
+        self.normals: List[Vec3] = []   # input face normals, for the flip test
+        edge_faces: Dict[Tuple[int, int], List[int]] = {}
+        for t, tri in enumerate(self.tris):
+            ps = [self.pid[v] for v in tri]
+            n = self._normal(ps)
+            self.normals.append(n)
+            ln = math.sqrt(_dot(n, n))
+            if ln > 0.0:
+                q = _plane_quadric((n[0] / ln, n[1] / ln, n[2] / ln), self.ppos[ps[0]])
+                for p in ps:
+                    _q_add(self.quadrics[p], q)
+            for k in range(3):
+                a, b = ps[k], ps[(k + 1) % 3]
+                edge_faces.setdefault((min(a, b), max(a, b)), []).append(t)
+        for (a, b), faces in edge_faces.items():
+            if len(faces) != 1:
+                continue
+            ps = [self.pid[v] for v in self.tris[faces[0]]]
+            e = _sub(self.ppos[b], self.ppos[a])
+            m = _cross(e, self._normal(ps))
+            lm = math.sqrt(_dot(m, m))
+            if lm > 0.0:
+                q = _plane_quadric((m[0] / lm, m[1] / lm, m[2] / lm), self.ppos[a], BOUNDARY_WEIGHT)
+                _q_add(self.quadrics[a], q)
+                _q_add(self.quadrics[b], q)
+
+        self.heap: List[Tuple[float, int, int, int, int]] = []
+        for p in range(len(self.ppos)):
+            for q in self._neighbours(p):
+                self._push(p, q)
+
+    # -- topology helpers --------------------------------------------------
+
+    def _normal(self, ps: Sequence[int]) -> Vec3:
+        a, b, c = (self.ppos[p] for p in ps)
+        return _cross(_sub(b, a), _sub(c, a))
+
+    def _ptris(self, p: int) -> Set[int]:
+        out: Set[int] = set()
+        for w in self.wedges[p]:
+            out |= self.vtris.get(w, set())
+        return out
+
+    def _neighbours(self, p: int) -> Set[int]:
+        out = {self.pid[v] for t in self._ptris(p) for v in self.tris[t]}
+        out.discard(p)
+        return out
+
+    def _push(self, p: int, q: int) -> None:
+        if self.locked[p]:
+            return
+        cost = _q_eval([a + b for a, b in zip(self.quadrics[p], self.quadrics[q])], self.ppos[q])
+        heapq.heappush(self.heap, (cost, self.version[p], self.version[q], p, q))
+
+    # -- collapse ------------------------------------------------------------
+
+    def _plan(self, p: int, q: int) -> Optional[Dict[int, int]]:
+        """Wedge remap for collapsing p into q, or None when not allowed."""
+        tris_p = self._ptris(p)
+        shared = [t for t in tris_p if any(self.pid[v] == q for v in self.tris[t])]
+        if not shared:
+            return None
+
+        # Boundary / manifold: faces per edge around p.
+        edge_count: Dict[int, int] = {}
+        for t in tris_p:
+            for v in self.tris[t]:
+                r = self.pid[v]
+                if r != p:
+                    edge_count[r] = edge_count.get(r, 0) + 1
+        if any(c > 2 for c in edge_count.values()):
+            return None
+        border = [r for r, c in edge_count.items() if c == 1]
+        if border and (len(border) != 2 or edge_count[q] != 1):
+            return None
+
+        # Link condition: p and q only share the apexes of the collapsing faces.
+        apex = {self.pid[v] for t in shared for v in self.tris[t]} - {p, q}
+        if (set(edge_count) & self._neighbours(q)) - {q} != apex:
+            return None
+
+        # Seams: every wedge at p must reach exactly one wedge at q.
+        remap: Dict[int, int] = {}
+        for w in self.wedges[p]:
+            if not self.vtris.get(w):
+                continue
+            targets = {v for t in self.vtris[w] for v in self.tris[t] if self.pid[v] == q}
+            if len(targets) != 1:
+                return None
+            remap[w] = targets.pop()
+
+        # No flips among the faces that stay.
+        qpos = self.ppos[q]
+        for t in tris_p:
+            if t in shared:
+                continue
+            ps = [self.pid[v] for v in self.tris[t]]
+            before = self.normals[t]
+            after_pts = [qpos if r == p else self.ppos[r] for r in ps]
+            after = _cross(_sub(after_pts[1], after_pts[0]), _sub(after_pts[2], after_pts[0]))
+            if _dot(before, after) <= FLIP_COS * math.sqrt(_dot(before, before) * _dot(after, after)):
+                return None
+        return remap
+
+    def _collapse(self, p: int, q: int, remap: Dict[int, int]) -> None:
+        for t in self._ptris(p):
+            tri = self.tris[t]
+            if any(self.pid[v] == q for v in tri):
+                self.alive[t] = 0
+                self.count -= 1
+                for v in tri:
+                    self.vtris[v].discard(t)
+                continue
+            for k, v in enumerate(tri):
+                if v in remap:
+                    tri[k] = remap[v]
+                    self.vtris[v].discard(t)
+                    self.vtris[remap[v]].add(t)
+        _q_add(self.quadrics[q], self.quadrics[p])
+        self.dead[p] = 1
+        self.version[p] += 1
+        self.version[q] += 1
+        for r in self._neighbours(q):
+            self._push(q, r)
+            self._push(r, q)
+
+    def run(self, target: int, max_cost: float) -> bool:
+        """Collapse until ``target`` triangles remain; False if it ran dry."""
+        while self.count > target:
+            if not self.heap:
+                return False
+            cost, vp, vq, p, q = heapq.heappop(self.heap)
+            if cost > max_cost:
+                heapq.heappush(self.heap, (cost, vp, vq, p, q))
+                return False
+            if self.dead[p] or self.dead[q] or vp != self.version[p] or vq != self.version[q]:
+                continue
+            remap = self._plan(p, q)
+            if remap is not None:
+                self._collapse(p, q, remap)
+        return True
+
+    def groups(self, order: Sequence[Hashable]) -> Groups:
+        out: Groups = {k: [] for k in order}
+        for t, tri in enumerate(self.tris):
+            if self.alive[t]:
+                out[self.tri_group[t]].extend(tri)
+        return out
+
+
+def simplify_levels(positions: Sequence[Vec3], groups: Groups, levels: int,
+                    ratio: float = 0.5, max_error: float = 0.05,
+                    locked: Optional[Set[Vec3]] = None) -> List[Groups]:
+    """[groups, coarser groups, ...], at most ``levels`` extra levels.
+
+    Each level aims for ``ratio`` times the previous triangle count.
+    ``max_error`` caps the collapse error (RMS distance over the quadric
+    planes) as a fraction of the input's bounding-box diagonal; ``locked``
+    positions never move. A level that doesn't drop below ``MIN_REDUCTION``
+    of its predecessor ends the chain.
+    """
+    chain = [groups]
+    if levels <= 0:
+        return chain
+    s = _Simplifier(positions, groups, locked or set())
+    if not s.ppos:
+        return chain
+    lo = [min(p[c] for p in s.ppos) for c in range(3)]
+    hi = [max(p[c] for p in s.ppos) for c in range(3)]
+    diag = math.sqrt(sum((b - a) ** 2 for a, b in zip(lo, hi)))
+    max_cost = (max_error * diag) ** 2
+    order = list(groups)
+    prev = s.count
+    for _ in range(levels):
+        more = s.run(int(prev * ratio), max_cost)
+        if s.count > prev * MIN_REDUCTION:
+            break
+        chain.append(s.groups(order))
+        prev = s.count
+        if not more:
+            break
+    return chain
@@ -0,0 +1,155 @@
+"""Vertex welding and index-buffer ordering for the glTF exporters.
+
+``psm2_gltf._build_corners`` and ``psc3_gltf._build_face_groups`` emit one
+vertex per primitive corner so that every corner can carry its own UV.
+Most corners are exact duplicates of a neighbour
+(``scripts/obj_vertex_hub_report.py`` shows the hub degrees). Before
+buffers are written, ``optimize`` runs three passes:
+
+  1. weld      - identical (position, normal, uv[, color]) tuples become
+                 one vertex (exact match; nothing is snapped or merged
+                 across seams);
+  2. tipsify   - triangles of each index group are reordered for the
+                 post-transform vertex cache (Sander, Nehab & Barczak,
+                 "Fast Triangle Reordering for Vertex Locality and
+                 Reduced Overdraw", 2007). Triangle winding is preserved;
+  3. fetch     - vertices are renumbered in first-use order over the
+                 groups as the writer emits them, so the attribute reads
+                 walk memory forwards.
+
+Output is geometrically identical: same triangles, same attributes, per
+group. ``acmr`` (average cache miss ratio on a FIFO cache) is reported
+so the gain can be checked without a GPU.
+"""
+from __future__ import annotations
+
+from typing import Dict, Hashable, List, Sequence, Tuple
+
+CACHE_SIZE = 16     # tipsify target; below most GPUs' post-transform caches
+REPORT_CACHE = 32   # FIFO size used by acmr()
+
+Groups = Dict[Hashable, List[int]]
+
+
+def weld(streams: Sequence[Sequence], groups: Groups) -> Tuple[List[list], Groups]:
+    """Merge vertices whose attributes match in every stream."""
+    remap: List[int] = []
+    seen: Dict[tuple, int] = {}
+    for key in zip(*streams):
+        idx = seen.get(key)
+        if idx is None:
+            idx = seen[key] = len(seen)
+        remap.append(idx)
+    out = [list(s) for s in zip(*seen)] if seen else [[] for _ in streams]
+    return out, {g: [remap[i] for i in idx] for g, idx in groups.items()}
+
+
+def tipsify(indices: Sequence[int], n_verts: int, cache: int = CACHE_SIZE) -> List[int]:
+    """Reorder triangles (flat index list) for vertex-cache locality."""
+    n_tris = len(indices) // 3
+    if n_tris < 2:
+        return list(indices)
+    adj: List[List[int]] = [[] for _ in range(n_verts)]
+    for t in range(n_tris):
+        for v in indices[3 * t:3 * t + 3]:
+            adj[v].append(t)
+    live = [len(a) for a in adj]
+    stamp = [0] * n_verts
+    emitted = bytearray(n_tris)
+    dead_end: List[int] = []
+    out: List[int] = []
+    clock = cache + 1
+    cursor = 0
+    fan = indices[0]
+    while fan >= 0:
+        candidates: List[int] = []
+        for t in adj[fan]:
+            if emitted[t]:
+                continue
+            emitted[t] = 1
+            tri = indices[3 * t:3 * t + 3]
+            out.extend(tri)
+            for v in tri:
+                dead_end.append(v)
+                candidates.append(v)
+                live[v] -= 1
+                if clock - stamp[v] > cache:
+                    stamp[v] = clock
+                    clock += 1
+        # Next fanning vertex: the candidate still in cache with the most
+        # pending triangles that will not push itself out of the cache.
+        fan, best = -1, -1
+        for v in candidates:
+            if live[v] > 0:
+                p = clock - stamp[v] if clock - stamp[v] + 2 * live[v] <= cache else 0
+                if p > best:
+                    fan, best = v, p
+        if fan < 0:
+            while dead_end:
+                v = dead_end.pop()
+                if live[v] > 0:
+                    fan = v
+                    break
+            else:
+                while cursor < n_verts and live[cursor] <= 0:
+                    cursor += 1
+                fan = cursor if cursor < n_verts else -1
+    return out
+
+
+def fetch_order(streams: Sequence[Sequence], groups: Groups,
+                order: Sequence[Hashable]) -> Tuple[List[list], Groups]:
+    """Renumber vertices by first reference, walking groups in `order`."""
+    remap: Dict[int, int] = {}
+    for g in order:
+        for i in groups[g]:
+            if i not in remap:
+                remap[i] = len(remap)
+    old = sorted(remap, key=remap.__getitem__)
+    out = [[s[i] for i in old] for s in streams]
+    return out, {g: [remap[i] for i in idx] for g, idx in groups.items()}
+
+
+def acmr(indices: Sequence[int], cache: int = REPORT_CACHE) -> float:
+    """Average transformed vertices per triangle on a FIFO cache."""
+    if len(indices) < 3:
+        return 0.0
+    fifo: List[int] = []
+    resident = set()
+    misses = 0
+    for v in indices:
+        if v in resident:
+            continue
+        misses += 1
+        fifo.append(v)
+        resident.add(v)
+        if len(fifo) > cache:
+            resident.discard(fifo.pop(0))
+    return misses / (len(indices) // 3)
+
+
+def optimize(streams: Sequence[Sequence], groups: Groups,
+             order: Sequence[Hashable] = None) -> Tuple[List[list], Groups, dict]:
+    """weld -> tipsify each group -> fetch reorder.
+
+    `streams` are parallel per-vertex attribute lists (position, normal,
+    uv, ...); `groups` map a key to a flat triangle index list; `order`
+    is the group emission order (default: sorted keys). Returns the new
+    streams and groups plus before/after stats.
+    """
+    order = list(order) if order is not None else sorted(groups)
+    n_in = len(streams[0]) if streams else 0
+    before = sum(acmr(groups[g]) * (len(groups[g]) // 3) for g in order)
+    welded, groups = weld(streams, groups)
+    n_verts = len(welded[0]) if welded else 0
+    groups = {g: tipsify(idx, n_verts) for g, idx in groups.items()}
+    welded, groups = fetch_order(welded, groups, order)
+    after = sum(acmr(groups[g]) * (len(groups[g]) // 3) for g in order)
+    tris = sum(len(groups[g]) // 3 for g in order) or 1
+    stats = {
+        "vertices_in": n_in,
+        "vertices_out": len(welded[0]) if welded else 0,
+        "acmr_in": round(before / tris, 3),
+        "acmr_out": round(after / tris, 3),
+    }
+    return welded, groups, stats
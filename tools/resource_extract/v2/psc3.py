@@ -41,6 +41,10 @@ Vertex counts are inferred from the gap between sequential section offsets:
 - vertex_count  = (offs_vertex_bytes - offs_vertices) / 10
 - normal_count  = inferred similarly when offs_normals is followed by another
                   known section, otherwise scanned from primitive references.
+
+Usage (from the repo root; the module is part of the package, so run it
+with -m rather than as a script path):
+    python -m tools.resource_extract.v2.psc3 --src FILE_OR_DIR --dst OUT_DIR
 """
 from __future__ import annotations
 
@@ -50,6 +54,7 @@ import struct
 from dataclasses import dataclass, field
 from typing import List, Optional, Tuple
 
+
 MAGIC_PSC3 = 0x33435350
 POS_SCALE = 1.0 / 2048.0  # FUN_002129b8: short * 0.00048828125
 
@@ -188,16 +193,8 @@ def parse_psc3(buf: bytes) -> PSC3Mesh:
 
 
 def find_psc3_offsets(buf: bytes) -> List[int]:
-    out: List[int] = []
-    pos = 0
-    needle = MAGIC_PSC3.to_bytes(4, 'little')
-    while True:
-        i = buf.find(needle, pos)
-        if i == -1:
-            break
-        out.append(i)
-        pos = i + 1
-    return out
+    from .bytescan import find_all
+    return find_all(buf, "PSC3")
 
 
 def write_obj(mesh: PSC3Mesh, path: str, name: str = "mesh") -> Tuple[int, int]:
@@ -5,19 +5,43 @@ Walks ``--src`` (default ``out/target_all``) for ``<scene>/grp_*.psc3``
 files. Identical model bytes that appear under the same basename in
 multiple scenes are exported only once. The output layout is
 
-    <dst>/<grp_name>/aid<N>/<grp_name>.gltf
-                    /aid<N>/<grp_name>.bin
-                    /aid<N>/tex_*.png
+    <dst>/<grp_name>/<grp_name>.gltf  (mesh + skeleton, no animations)
+                    /<grp_name>.bin
+                    /<grp_name>.clips (every anim id, see anim_clips.py)
+                    /tex_*.png
                     /_scenes.json   (manifest of scenes that use this model)
     <dst>/_index.json     (top-level: model -> stats)
 
+``--per-aid`` writes the older layout instead: one full glTF (mesh
+included) per anim id under ``<grp_name>/aid<N>/``.
+
 In the rare case where the same basename has different bytes in
 different scenes, each variant is emitted under
 ``<grp_name>__<hash6>/`` and recorded separately.
 
+Each model is one job; ``--jobs N`` runs them over N worker processes
+(largest PSC3 first). Progress is appended to ``<dst>/_journal.jsonl``:
+
+    {"model": <dir>, "sha6": <sha>, "layout": "per-aid", "aid": N}   one aid written
+    {"model": <dir>, "sha6": <sha>, "layout": <l>, "index": {...}}   model complete
+
+A rerun skips completed models and, inside a partly exported model
+(``--per-aid``), the aids already written; ``--fresh`` discards the journal. The
+journal is keyed by sha6 and layout, so a model whose bytes changed, or
+that was finished in the other layout, is redone.
+``_index.json`` is rewritten (atomically) every few seconds while the
+export runs, so the viewer sees models as they land.
+
+``--incremental`` goes by ``<dst>/_build.json`` (build_graph.py) instead
+of the journal: a model is re-exported only when its PSC3 bytes, its
+bundle's texture pages / ``_manifest.txt``, ``grp_tex_map.json``, the
+layout or the exporter code changed. Up-to-date models keep their index
+entries, and ``_scenes.json`` files are only rewritten when their
+content changes.
+
 CLI:
     python -m tools.resource_extract.v2.psc3_export_all \
-        --src out/target_all --dst out/models
+        --src out/target_all --dst out/models --jobs 0
 """
 from __future__ import annotations
 
@@ -27,12 +51,25 @@ import json
 import sys
 import time
 from collections import defaultdict
+from concurrent.futures import FIRST_COMPLETED, ProcessPoolExecutor, wait
 from pathlib import Path
-from typing import Dict, List, Tuple
+from typing import Dict, List, Set, Tuple
 
+from . import anim_clips
+from .build_graph import BuildState, code_version
 from .psc3_anim_decode import parse_anim_table
 from .psc3_full import MAGIC_PSC3, parse_psc3_full, _u32
-from .psc3_gltf_anim import emit_animated
+from .psc3_gltf import texture_inputs
+from .psc3_gltf_anim import emit_animated, emit_clip_store
+from .psc3_pose import PoseBank
+
+try:
+    import fcntl
+except ImportError:  # Windows: single-writer use only (--jobs 1).
+    fcntl = None  # type: ignore
+
+JOURNAL_NAME = "_journal.jsonl"
+INDEX_FLUSH_S = 5.0
 
 
 def _sha6(data: bytes) -> str:
@@ -71,13 +108,143 @@ def _model_dirname(name: str, sha: str, has_variants: bool) -> str:
     return f"{name}__{sha}" if has_variants else name
 
 
+# ---------------------------------------------------------------------------
+# Journal
+# ---------------------------------------------------------------------------
+
+def _journal_append(path: Path, rec: dict) -> None:
+    """Append one JSON line under an exclusive lock (workers share the file)."""
+    with open(path, "a", encoding="utf-8") as f:
+        if fcntl is not None:
+            fcntl.flock(f, fcntl.LOCK_EX)
+        try:
+            f.write(json.dumps(rec) + "\n")
+            f.flush()
+        finally:
+            if fcntl is not None:
+                fcntl.flock(f, fcntl.LOCK_UN)
+
+
+def _journal_load(path: Path, layout: str) -> Tuple[Dict[Tuple[str, str], Set[int]],
+                                                    Dict[Tuple[str, str], Dict]]:
+    """Finished aids and finished-model index entries of `layout`, keyed by
+    (model dir, sha6). Records of another layout (or none) are ignored."""
+    aids: Dict[Tuple[str, str], Set[int]] = defaultdict(set)
+    models: Dict[Tuple[str, str], Dict] = {}
+    if not path.is_file():
+        return aids, models
+    with open(path, "r", encoding="utf-8") as f:
+        for line in f:
+            try:
+                rec = json.loads(line)
+            except ValueError:
+                continue  # torn final line from an interrupted run
+            if rec.get("layout") != layout:
+                continue
+            key = (rec["model"], rec["sha6"])
+            if "aid" in rec:
+                aids[key].add(rec["aid"])
+            elif "index" in rec:
+                models[key] = rec["index"]
+    return aids, models
+
+
+def _write_if_changed(path: Path, text: str) -> None:
+    try:
+        if path.read_text() == text:
+            return
+    except OSError:
+        pass
+    path.write_text(text)
+
+
+def _outputs(out_dir: Path, name: str, result: Dict, per_aid: bool) -> List[Path]:
+    """Files an exported model must still have to count as up to date."""
+    if per_aid:
+        return [out_dir / f"aid{a}" / f"{name}.gltf" for a in range(result.get("aid_count", 0))]
+    if "clips" in result:
+        return [out_dir / result["mesh"], out_dir / result["clips"]]
+    return []
+
+
+def _write_index(dst: Path, index: Dict[str, Dict]) -> None:
+    tmp = dst / "_index.json.tmp"
+    tmp.write_text(json.dumps(dict(sorted(index.items())), indent=2))
+    tmp.replace(dst / "_index.json")
+
+
+# ---------------------------------------------------------------------------
+# Per-model job
+# ---------------------------------------------------------------------------
+
+def _export_model(canonical: str, out_dir: str, name: str, sha: str, out_name: str,
+                  done_aids: Set[int], journal: str, per_aid: bool = False) -> Dict:
+    """Emit one model: its mesh + clip store, or with ``per_aid`` every
+    aid glTF the journal does not list yet.
+
+    Runs in a worker process; each finished aid is journaled right away so
+    an interrupted model resumes at its next aid. Returns the fields the
+    index entry adds on top of the manifest.
+    """
+    try:
+        data = Path(canonical).read_bytes()
+        mesh = parse_psc3_full(data)
+        h = mesh.header
+        if not h["offs_u0c"]:
+            return {"aid_count": 0, "note": "no anim table"}
+        anim_total = len(parse_anim_table(data, h["offs_u0c"]))
+        bundle_dir = str(Path(canonical).parent)
+        bank = None
+
+        if not per_aid:
+            stats = emit_clip_store(data, mesh, out_dir, name, bundle_dir=bundle_dir)
+            return {
+                "aid_count": anim_total,
+                "mesh": f"{name}.gltf",
+                "clips": f"{name}.clips",
+                "clip_ids": stats["clips"],
+                "clip_bytes": stats["clip_bytes"],
+            }
+
+        for aid in range(anim_total):
+            if aid in done_aids:
+                continue
+            if bank is None:
+                bank = PoseBank(data, mesh)
+            gltf_path = Path(out_dir) / f"aid{aid}" / f"{name}.gltf"
+            emit_animated(
+                data, mesh, str(gltf_path), name,
+                anim_ids=[aid],
+                bundle_dir=bundle_dir,
+                png_override=None,
+                pose_bank=bank,
+            )
+            _journal_append(Path(journal), {"model": out_name, "sha6": sha,
+                                            "layout": "per-aid", "aid": aid})
+        return {"aid_count": anim_total}
+    except Exception as exc:  # noqa: BLE001
+        return {"error": str(exc)}
+
+
 def main() -> int:
     ap = argparse.ArgumentParser()
     ap.add_argument("--src", default="out/target_all", help="Unpacked scene root")
     ap.add_argument("--dst", default="out/models", help="Deduped model output root")
-    ap.add_argument("--limit", type=int, default=0, help="Optional: stop after N models (debug)")
+    ap.add_argument("--limit", type=int, default=0, help="Optional: stop after N models written (debug); "
+                         "skipped, resumed and failed models do not count")
     ap.add_argument("--skip-existing", action="store_true",
-                    help="Skip a model if its destination dir already has a .gltf")
+                    help="Skip a model if its destination dir already has its "
+                         ".clips (or, with --per-aid, an aid glTF)")
+    ap.add_argument("--jobs", "-j", type=int, default=1,
+                    help="Worker processes, one model per task (0 = all cores)")
+    ap.add_argument("--per-aid", action="store_true",
+                    help="Write one full glTF per anim id (aid<N>/) instead of "
+                         "one mesh + <name>.clips per model")
+    ap.add_argument("--fresh", action="store_true",
+                    help=f"Ignore and restart {JOURNAL_NAME} (re-export everything)")
+    ap.add_argument("--incremental", action="store_true",
+                    help="Re-export only models whose inputs or exporter code "
+                         "changed since the last run (<dst>/_build.json)")
     args = ap.parse_args()
 
     src = Path(args.src).resolve()
@@ -86,6 +253,14 @@ def main() -> int:
         print(f"[error] src not found: {src}", file=sys.stderr)
         return 1
     dst.mkdir(parents=True, exist_ok=True)
+    journal = dst / JOURNAL_NAME
+    if args.fresh and journal.exists():
+        journal.unlink()
+    layout = "per-aid" if args.per_aid else "clips"
+    done_aids, done_models = _journal_load(journal, layout)
+    state = BuildState(str(dst), enabled=args.incremental)
+    code = code_version("psc3_export_all") if args.incremental else ""
+    targets: Dict[str, Dict[str, str]] = {}
 
     print(f"[scan] gathering PSC3 files under {src}")
     t0 = time.time()
@@ -102,7 +277,8 @@ def main() -> int:
           f"({len(multi_variant)} basenames with multiple variants) in {time.time()-t0:.1f}s")
 
     index: Dict[str, Dict] = {}
-    processed = 0
+    jobs: List[Tuple[int, str, Dict, tuple]] = []
+    resumed = 0
     for (name, sha), entry in sorted(groups.items()):
         has_variants = name in multi_variant
         out_name = _model_dirname(name, sha, has_variants)
@@ -119,53 +295,127 @@ def main() -> int:
             "scenes": scenes,
             "scene_count": len(scenes),
         }
-        (out_dir / "_scenes.json").write_text(json.dumps(manifest, indent=2))
+        _write_if_changed(out_dir / "_scenes.json", json.dumps(manifest, indent=2))
+
+        if args.incremental:
+            targets[out_name] = {"src": state.file_digest(str(canonical)), "code": code,
+                                 "layout": layout,
+                                 **texture_inputs(state, str(canonical.parent))}
+            fresh = state.check(out_name, targets[out_name])
+            if fresh is not None:
+                index[out_name] = {**manifest, **fresh}
+                resumed += 1
+                continue
+            # Stale: redo it whole, whatever the journal says.
+            task = (str(canonical), str(out_dir), name, sha, out_name,
+                    set(), str(journal), args.per_aid)
+            jobs.append((canonical.stat().st_size, out_name, manifest, task))
+            continue
+
+        finished = done_models.get((out_name, sha))
+        if finished is not None:
+            index[out_name] = {**manifest, **finished}
+            resumed += 1
+            continue
 
         existing_gltfs = list(out_dir.glob("aid*/*.gltf"))
-        if args.skip_existing and existing_gltfs:
+        existing_clips = out_dir / f"{name}.clips"
+        if args.skip_existing and args.per_aid and existing_gltfs:
             index[out_name] = {
                 **manifest,
                 "aid_count": len({p.parent.name for p in existing_gltfs}),
                 "skipped": True,
             }
             continue
-
-        # Parse + emit.
-        try:
-            data = canonical.read_bytes()
-            mesh = parse_psc3_full(data)
-            h = mesh.header
-            if not h["offs_u0c"]:
-                index[out_name] = {**manifest, "aid_count": 0, "note": "no anim table"}
-                continue
-            anim_total = len(parse_anim_table(data, h["offs_u0c"]))
-            bundle_dir = str(canonical.parent)
-
-            for aid in range(anim_total):
-                aid_dir = out_dir / f"aid{aid}"
-                gltf_path = aid_dir / f"{name}.gltf"
-                emit_animated(
-                    data, mesh, str(gltf_path), name,
-                    anim_ids=[aid],
-                    bundle_dir=bundle_dir,
-                    png_override=None,
-                )
+        if args.skip_existing and not args.per_aid and existing_clips.is_file():
             index[out_name] = {
                 **manifest,
-                "aid_count": anim_total,
+                "aid_count": len(anim_clips.parse(existing_clips.read_bytes())[1]),
+                "mesh": f"{name}.gltf",
+                "clips": existing_clips.name,
+                "skipped": True,
             }
-            processed += 1
-            if processed % 25 == 0:
-                print(f"[emit] {processed} models written...")
-            if args.limit and processed >= args.limit:
-                print(f"[stop] hit --limit {args.limit}")
-                break
-        except Exception as exc:  # noqa: BLE001
-            print(f"[warn] {name} ({sha}): {exc}", file=sys.stderr)
-            index[out_name] = {**manifest, "error": str(exc)}
-
-    (dst / "_index.json").write_text(json.dumps(index, indent=2))
-    print(f"[done] {processed}/{len(groups)} unique models emitted into {dst}")
+            continue
+
+        task = (str(canonical), str(out_dir), name, sha, out_name,
+                done_aids.get((out_name, sha), set()), str(journal), args.per_aid)
+        jobs.append((canonical.stat().st_size, out_name, manifest, task))
+
+    # Largest models first so the long exports start early and small ones
+    # fill the tail; sequential and --limit runs keep the sorted name order.
+    if args.jobs != 1 and not args.limit:
+        jobs.sort(key=lambda j: -j[0])
+    if resumed:
+        print(f"[resume] {resumed} models already complete in "
+              f"{'_build.json' if args.incremental else JOURNAL_NAME}")
+    _write_index(dst, index)
+
+    processed = 0
+    written = 0
+    last_write = time.time()
+
+    def finish(out_name: str, manifest: Dict, result: Dict, sha: str) -> None:
+        nonlocal processed, written, last_write
+        index[out_name] = {**manifest, **result}
+        if "error" in result:
+            print(f"[warn] {out_name} ({sha}): {result['error']}", file=sys.stderr)
+        else:
+            written += 1
+            _journal_append(journal, {"model": out_name, "sha6": sha, "layout": layout,
+                                      "index": result})
+            if args.incremental:
+                state.record(out_name, targets[out_name],
+                             [str(p) for p in _outputs(dst / out_name, manifest["name"],
+                                                       result, args.per_aid)], result)
+        processed += 1
+        if processed % 25 == 0:
+            print(f"[emit] {processed}/{len(jobs)} models written...")
+        if time.time() - last_write >= INDEX_FLUSH_S:
+            _write_index(dst, index)
+            state.save()
+            last_write = time.time()
+
+    try:
+        if args.jobs == 1:
+            for _size, out_name, manifest, task in jobs:
+                if args.limit and written >= args.limit:
+                    break
+                finish(out_name, manifest, _export_model(*task), task[3])
+        else:
+            # With --limit, keep no more models in flight than could still
+            # count towards it, so failures are replaced and none overshoot.
+            queue = iter(jobs)
+            with ProcessPoolExecutor(max_workers=args.jobs or None) as pool:
+                running: Dict = {}
+
+                def fill() -> None:
+                    while not args.limit or written + len(running) < args.limit:
+                        job = next(queue, None)
+                        if job is None:
+                            return
+                        _size, out_name, manifest, task = job
+                        running[pool.submit(_export_model, *task)] = (out_name, manifest, task[3])
+
+                fill()
+                while running:
+                    done, _ = wait(running, return_when=FIRST_COMPLETED)
+                    for fut in done:
+                        out_name, manifest, sha = running.pop(fut)
+                        finish(out_name, manifest, fut.result(), sha)
+                    fill()
+    except KeyboardInterrupt:
+        _write_index(dst, index)
+        state.save()
+        print(f"[stop] interrupted after {processed} models; rerun to resume", file=sys.stderr)
+        return 130
+
+    if args.limit and written >= args.limit:
+        print(f"[stop] hit --limit {args.limit}")
+    _write_index(dst, index)
+    state.save()
+    print(f"[done] {processed}/{len(jobs)} models emitted into {dst} "
+          f"({resumed} {'up to date' if args.incremental else 'resumed from journal'}) "
+          f"in {time.time()-t0:.1f}s")
     return 0
 
 
@@ -36,10 +36,11 @@ from __future__ import annotations
 import argparse
 import json
 import os
-import struct
 import sys
-from typing import Dict, List, Optional, Tuple
+from typing import TYPE_CHECKING, Dict, List, Optional, Tuple
 
+from . import mesh_opt
+from .glb import GlbBuilder, PositionGrid, pack_f32, pack_index
 from .psc3_full import (
     MAGIC_PSC3,
     PSC3FullMesh,
@@ -53,6 +54,9 @@ from .psc3_full import (
     parse_psc3_full,
 )
 
+if TYPE_CHECKING:
+    from .build_graph import BuildState
+
 
 # ---------------------------------------------------------------------------
 # Buffer accumulator
@@ -86,24 +90,15 @@ class _BinBuf:
 
 
 def _f32_vec3(seq: List[Tuple[float, float, float]]) -> bytes:
-    out = bytearray()
-    for x, y, z in seq:
-        out += struct.pack('<fff', x, y, z)
-    return bytes(out)
+    return pack_f32(seq)
 
 
 def _f32_vec2(seq: List[Tuple[float, float]]) -> bytes:
-    out = bytearray()
-    for u, v in seq:
-        out += struct.pack('<ff', u, v)
-    return bytes(out)
+    return pack_f32(seq)
 
 
 def _u16_idx(seq: List[int]) -> bytes:
-    out = bytearray()
-    for i in seq:
-        out += struct.pack('<H', i)
-    return bytes(out)
+    return pack_index(seq, wide=False)[0]
 
 
 def _bbox(seq: List[Tuple[float, float, float]]) -> Tuple[List[float], List[float]]:
@@ -237,39 +232,65 @@ def _bundle_pngs(bundle_dir: str) -> List[str]:
 _GRP_TEX_MAP_CACHE: dict = {}
 
 
-def _load_grp_tex_map(bundle_dir: Optional[str]) -> dict:
-    """Look up <bundle_dir>/grp_tex_map.json (or repo-root out/grp_tex_map.json
-    as a fallback) and return the parsed mapping. Returns {} if not found.
-    Result is cached per directory."""
+def _grp_tex_map_path(bundle_dir: Optional[str]) -> Optional[str]:
+    """Path of the grp_tex_map.json that applies to ``bundle_dir``:
+    <bundle_dir>/grp_tex_map.json, else the nearest out/grp_tex_map.json
+    up the tree (repo-root convention). None if there is none."""
     if not bundle_dir:
-        return {}
+        return None
     bundle_dir = os.path.abspath(bundle_dir)
-    if bundle_dir in _GRP_TEX_MAP_CACHE:
-        return _GRP_TEX_MAP_CACHE[bundle_dir]
-
     candidates = [os.path.join(bundle_dir, 'grp_tex_map.json')]
-    # Walk upwards looking for an out/grp_tex_map.json (repo-root convention).
     cur = bundle_dir
     for _ in range(6):
         cur = os.path.dirname(cur)
         if not cur or cur == os.path.dirname(cur):
             break
         candidates.append(os.path.join(cur, 'out', 'grp_tex_map.json'))
-
-    data: dict = {}
     for path in candidates:
         if os.path.isfile(path):
-            try:
-                import json
-                with open(path, 'r') as f:
-                    data = json.load(f)
-                break
-            except (OSError, ValueError):
-                continue
+            return path
+    return None
+
+
+def _load_grp_tex_map(bundle_dir: Optional[str]) -> dict:
+    """Parsed grp_tex_map.json for ``bundle_dir`` (see _grp_tex_map_path);
+    {} if not found or unreadable. Result is cached per directory."""
+    if not bundle_dir:
+        return {}
+    bundle_dir = os.path.abspath(bundle_dir)
+    if bundle_dir in _GRP_TEX_MAP_CACHE:
+        return _GRP_TEX_MAP_CACHE[bundle_dir]
+
+    data: dict = {}
+    path = _grp_tex_map_path(bundle_dir)
+    if path:
+        try:
+            import json
+            with open(path, 'r') as f:
+                data = json.load(f)
+        except (OSError, ValueError):
+            pass
     _GRP_TEX_MAP_CACHE[bundle_dir] = data
     return data
 
 
+def texture_inputs(state: "BuildState", bundle_dir: str) -> Dict[str, str]:
+    """build_graph inputs covering every file the texture binding reads:
+    the bundle's tex_* pages (PNG + BMPA), its _manifest.txt and the
+    grp_tex_map.json that applies to it."""
+    try:
+        pages = [os.path.join(bundle_dir, fn) for fn in os.listdir(bundle_dir)
+                 if fn.startswith('tex_') and fn.endswith(('.png', '.bmpa'))]
+    except OSError:
+        pages = []
+    tex_map = _grp_tex_map_path(bundle_dir)
+    return {
+        "tex": state.files_digest(pages),
+        "manifest": state.file_digest(os.path.join(bundle_dir, '_manifest.txt')),
+        "tex_map": state.file_digest(tex_map) if tex_map else "-",
+    }
+
+
 def _authoritative_png(name: str, pngs: List[str],
                        bundle_dir: Optional[str]) -> Optional[str]:
     """Return the PNG mandated by either the SLUS-derived
@@ -455,7 +476,16 @@ def _preferred_png(name: str, pngs: List[str],
 def write_gltf(mesh: PSC3FullMesh, gltf_path: str, name: str,
                apply_rest_pose: bool = False,
                bundle_dir: Optional[str] = None,
-               png_override: Optional[str] = None) -> dict:
+               png_override: Optional[str] = None,
+               glb: bool = False,
+               optimize: bool = True) -> dict:
+    """Write ``gltf_path`` + .bin, or with ``glb`` a single .glb with
+    quantized vertices, u16/u32 indices and the PNG embedded (glb.py).
+
+    ``optimize`` welds each primitive's corner stream and reorders it
+    for cache locality (mesh_opt.py).
+    """
+    builder = GlbBuilder() if glb else None
     bin_path = os.path.splitext(gltf_path)[0] + ".bin"
     bin_uri = os.path.basename(bin_path)
 
@@ -475,7 +505,10 @@ def write_gltf(mesh: PSC3FullMesh, gltf_path: str, name: str,
     ]
     base_tex_index: Optional[int] = None
     if preferred:
-        images.append({"uri": preferred})
+        if builder is not None:
+            images.append(builder.add_image(os.path.join(bundle_dir or "", preferred), preferred))
+        else:
+            images.append({"uri": preferred})
         textures.append({"sampler": 0, "source": 0})
         base_tex_index = 0
 
@@ -538,6 +571,8 @@ def write_gltf(mesh: PSC3FullMesh, gltf_path: str, name: str,
         return len(accessors) - 1
 
     # Stable iteration order (sm_idx, then mat_key insertion order).
+    streams = []
+    vert_in = 0
     for (sm_idx, mat_key) in sorted(groups.keys(),
                                     key=lambda k: (k[0], mat_order.index(k[1]))):
         tris = groups[(sm_idx, mat_key)]
@@ -553,21 +588,42 @@ def write_gltf(mesh: PSC3FullMesh, gltf_path: str, name: str,
                 uvs.append(uv)
         if not positions:
             continue
+        if optimize:
+            (positions, normals, uvs), idx_groups, st = mesh_opt.optimize(
+                [positions, normals, uvs], {0: indices})
+            indices = idx_groups[0]
+            vert_in += st['vertices_in']
+        streams.append((sm_idx, mat_key, positions, normals, uvs, indices))
+
+    # GLB: every primitive shares one position grid, dequantized by the node.
+    grid = PositionGrid([p for st in streams for p in st[2]]) if builder is not None else None
+    for sm_idx, mat_key, positions, normals, uvs, indices in streams:
+        if builder is not None:
+            primitives_json.append({
+                "attributes": builder.add_vertex_stream(grid, positions, normals, uvs),
+                "indices": builder.add_indices(indices),
+                "material": mat_key_to_index[mat_key],
+                "mode": 4,  # TRIANGLES
+                "extras": {"submesh": sm_idx},
+            })
+            continue
         pos_off = binbuf.append(_f32_vec3(positions))
         nrm_off = binbuf.append(_f32_vec3(normals))
         uv_off = binbuf.append(_f32_vec2(uvs))
-        idx_off = binbuf.append(_u16_idx(indices), align=2)
+        # u16 unless the stream is too long for it (then u32).
+        idx_bytes, idx_type = pack_index(indices)
+        idx_off = binbuf.append(idx_bytes, align=2 if idx_type == 5123 else 4)
 
         bv_pos = _add_bufview(pos_off, len(positions) * 12, target=34962)  # ARRAY_BUFFER
         bv_nrm = _add_bufview(nrm_off, len(normals) * 12, target=34962)
         bv_uv = _add_bufview(uv_off, len(uvs) * 8, target=34962)
-        bv_idx = _add_bufview(idx_off, len(indices) * 2, target=34963)  # ELEMENT_ARRAY_BUFFER
+        bv_idx = _add_bufview(idx_off, len(idx_bytes), target=34963)  # ELEMENT_ARRAY_BUFFER
 
         mn, mx = _bbox(positions)
         a_pos = _add_accessor(bv_pos, len(positions), "VEC3", 5126, mn, mx)  # FLOAT
         a_nrm = _add_accessor(bv_nrm, len(normals), "VEC3", 5126)
         a_uv = _add_accessor(bv_uv, len(uvs), "VEC2", 5126)
-        a_idx = _add_accessor(bv_idx, len(indices), "SCALAR", 5123)  # UNSIGNED_SHORT
+        a_idx = _add_accessor(bv_idx, len(indices), "SCALAR", idx_type)
 
         primitives_json.append({
             "attributes": {"POSITION": a_pos, "NORMAL": a_nrm, "TEXCOORD_0": a_uv},
@@ -587,8 +643,11 @@ def write_gltf(mesh: PSC3FullMesh, gltf_path: str, name: str,
             "scene": 0,
             "scenes": [{"nodes": []}],
         }
-        with open(gltf_path, 'w', encoding='utf-8') as fg:
-            json.dump(gltf, fg, indent=2)
+        if builder is not None:
+            GlbBuilder().write(gltf_path, gltf)
+        else:
+            with open(gltf_path, 'w', encoding='utf-8') as fg:
+                json.dump(gltf, fg, indent=2)
         # Don't write a 0-byte buffer.
         return {
             'submeshes': len(mesh.submeshes), 'primitives': 0,
@@ -597,20 +656,33 @@ def write_gltf(mesh: PSC3FullMesh, gltf_path: str, name: str,
             'preferred_png': preferred,
         }
 
-    with open(bin_path, 'wb') as fb:
-        fb.write(bin_blob)
-
-    gltf: dict = {
-        "asset": {"version": "2.0", "generator": "psc3_gltf.py"},
-        "scene": 0,
-        "scenes": [{"nodes": [0]}],
-        "nodes": [{"mesh": 0, "name": name}],
-        "meshes": [{"name": name, "primitives": primitives_json}],
-        "buffers": [{"uri": bin_uri, "byteLength": len(bin_blob)}],
-        "bufferViews": buffer_views,
-        "accessors": accessors,
-        "materials": materials,
-    }
+    if builder is not None:
+        gltf = {
+            "asset": {"version": "2.0", "generator": "psc3_gltf.py"},
+            "scene": 0,
+            "scenes": [{"nodes": [0]}],
+            "nodes": [{"mesh": 0, "name": name, **grid.node_transform()}],
+            "meshes": [{"name": name, "primitives": primitives_json}],
+            "materials": materials,
+        }
+        builder.finish(gltf)
+        bin_bytes = builder.length
+    else:
+        with open(bin_path, 'wb') as fb:
+            fb.write(bin_blob)
+        bin_bytes = len(bin_blob)
+
+        gltf = {
+            "asset": {"version": "2.0", "generator": "psc3_gltf.py"},
+            "scene": 0,
+            "scenes": [{"nodes": [0]}],
+            "nodes": [{"mesh": 0, "name": name}],
+            "meshes": [{"name": name, "primitives": primitives_json}],
+            "buffers": [{"uri": bin_uri, "byteLength": len(bin_blob)}],
+            "bufferViews": buffer_views,
+            "accessors": accessors,
+            "materials": materials,
+        }
     if textures:
         gltf["textures"] = textures
     if images:
@@ -618,17 +690,22 @@ def write_gltf(mesh: PSC3FullMesh, gltf_path: str, name: str,
     if samplers and textures:
         gltf["samplers"] = samplers
 
-    with open(gltf_path, 'w', encoding='utf-8') as fg:
-        json.dump(gltf, fg, indent=2)
+    if builder is not None:
+        builder.write(gltf_path, gltf)
+    else:
+        with open(gltf_path, 'w', encoding='utf-8') as fg:
+            json.dump(gltf, fg, indent=2)
 
     return {
         'submeshes': len(mesh.submeshes),
         'primitives': len(primitives_json),
         'materials': len(materials),
-        'bin_bytes': len(bin_blob),
+        'bin_bytes': bin_bytes,
         'gltf_path': gltf_path,
-        'bin_path': bin_path,
+        'bin_path': None if builder is not None else bin_path,
         'preferred_png': preferred,
+        'vertices': sum(len(st[2]) for st in streams),
+        'vertices_in': vert_in if optimize else None,
     }
 
 
@@ -639,7 +716,9 @@ def write_gltf(mesh: PSC3FullMesh, gltf_path: str, name: str,
 def export_file(src_path: str, dst_dir: str, verbose: bool = False,
                 apply_pose: bool = False,
                 png_override: Optional[str] = None,
-                pose_frame: int = 0) -> Optional[dict]:
+                pose_frame: int = 0,
+                glb: bool = False,
+                optimize: bool = True) -> Optional[dict]:
     data = open(src_path, 'rb').read()
     if len(data) < 4 or _u32(data, 0) != MAGIC_PSC3:
         if verbose:
@@ -653,14 +732,15 @@ def export_file(src_path: str, dst_dir: str, verbose: bool = False,
         if verbose:
             print(f"[err]  {src_path}: {e}")
         return None
-    gltf_path = os.path.join(dst_dir, base + ".gltf")
+    gltf_path = os.path.join(dst_dir, base + (".glb" if glb else ".gltf"))
     bundle_dir = os.path.dirname(os.path.abspath(src_path))
 
     # Copy referenced PNG into the dst dir so the .gltf URI resolves
-    # without needing the user to ship the bundle dir alongside.
+    # without needing the user to ship the bundle dir alongside (a .glb
+    # embeds it instead).
     pngs = _bundle_pngs(bundle_dir)
     preferred = png_override if png_override else _preferred_png(base, pngs, bundle_dir)
-    if preferred:
+    if preferred and not glb:
         src_png = os.path.join(bundle_dir, preferred)
         dst_png = os.path.join(dst_dir, preferred)
         if os.path.abspath(src_png) != os.path.abspath(dst_png):
@@ -673,11 +753,15 @@ def export_file(src_path: str, dst_dir: str, verbose: bool = False,
     stats = write_gltf(mesh, gltf_path, name=base,
                        apply_rest_pose=apply_pose,
                        bundle_dir=bundle_dir,
-                       png_override=png_override)
+                       png_override=png_override,
+                       glb=glb,
+                       optimize=optimize)
     if verbose:
         print(f"[ok]   {gltf_path}  prims={stats['primitives']}  "
               f"mats={stats['materials']}  bin={stats['bin_bytes']}B  "
               f"png={stats['preferred_png']}")
+        if stats.get('vertices_in'):
+            print(f"       weld {stats['vertices_in']} -> {stats['vertices']} verts")
     return stats
 
 
@@ -701,6 +785,12 @@ def main(argv=None) -> int:
                     help="Override the auto-picked BMPA PNG basename "
                          "(e.g. --png tex_0178.png). Must exist in the "
                          "same directory as --src.")
+    ap.add_argument('--glb', action='store_true',
+                    help="Write one self-contained .glb per input (quantized "
+                         "vertices, embedded PNG) instead of .gltf + .bin + PNG.")
+    ap.add_argument('--no-optimize', action='store_true',
+                    help="Keep one vertex per corner in source order (skip "
+                         "welding and cache reordering).")
     args = ap.parse_args(argv)
 
     inputs: List[str] = []
@@ -732,7 +822,8 @@ def main(argv=None) -> int:
     ok = 0
     for p in inputs:
         if export_file(p, args.dst, verbose=args.verbose, apply_pose=args.pose,
-                       png_override=args.png, pose_frame=args.pose_frame):
+                       png_override=args.png, pose_frame=args.pose_frame,
+                       glb=args.glb, optimize=not args.no_optimize):
             ok += 1
     print(f"Processed {len(inputs)} file(s); {ok} extracted to {args.dst}")
     return 0
@@ -19,12 +19,14 @@ CLI:
         --src out/target/s00_e000/grp_0183.psc3 \
         --dst out/anim/grp_0183 \
         --anim-id 1
+
+``--clips`` writes the shared mesh + skeleton once and packs every
+selected anim id into one ``<name>.clips`` file (``emit_clip_store``).
 """
 from __future__ import annotations
 
 import argparse
 import json
-import math
 import os
 import struct
 import sys
@@ -35,7 +37,6 @@ from .psc3_full import (
     PSC3FullMesh,
     UV_SCALE,
     parse_psc3_full,
-    sample_pose_v2,
     _norm_for,
     _u32,
 )
@@ -51,7 +52,9 @@ from .psc3_gltf import (
     _u16_idx,
     _build_face_groups,
 )
-from .psc3_anim_decode import parse_anim_table, parse_timeline
+from . import anim_clips
+from .psc3_anim_decode import AnimRecord, parse_anim_table, parse_timeline
+from .psc3_pose import PoseBank
 
 
 def _f32_vec4(items: List[Tuple[float, float, float, float]]) -> bytes:
@@ -65,79 +68,51 @@ def _f32_scalar(items: List[float]) -> bytes:
     return b"".join(struct.pack("<f", v) for v in items)
 
 
-def _swap_trans(t):
-    """PS2 Z-up -> glTF Y-up: (x, y, z) -> (x, z, -y)."""
-    x, y, z = t
-    return (x, z, -y)
-
-
-def _euler_to_quat(ex: float, ey: float, ez: float) -> Tuple[float, float, float, float]:
-    """Convert PS2 euler triple to a unit quaternion in glTF Y-up space.
-
-    Empirically verified convention (validated against in-game capture
-    of grp_0001 aid2): YXZ with positive signs and the standard Z-up ->
-    Y-up axis-component swap.
-
-        q = q_y(ey) * q_x(ex) * q_z(ez)
-
-    Derivation: per-bone runtime build path
-    ``FUN_0020cf28`` (param_10==0, called from ``FUN_0020d618``)
-    constructs the matrix as
-        M = I -> diag(s) -> *R_z(-ez) -> *R_x(-ex) -> *R_y(-ey) -> *T
-    where each per-axis cell function (FUN_0020ba30/ba88/bae0) writes
-    four entries of the working buffer and a VU0 microprogram at
-    ``_vcallms 0x60`` composes it with the running matrix. The PS2
-    runtime uses row-vector convention (v' = v * M), so the per-bone
-    rotation applied to a row vector is equivalent to a column-vector
-    rotation by R_y(ey) * R_x(ex) * R_z(ez) -- hence the YXZ order with
-    POSITIVE signs in the column-vector quaternion form glTF uses.
-
-    The Z-up -> Y-up axis component swap (x, y, z) -> (x, z, -y) is
-    applied after composition to match the translation swap.
-
-    The entity-root caller (``FUN_0020cdc0``) passes ``param_10 = 1``
-    which selects the XYZ branch; that is the world transform of the
-    entity, not a per-bone transform, and is irrelevant to PSC3 bone
-    poses.
-    """
-    def axis(theta: float, ax: int) -> Tuple[float, float, float, float]:
-        s = math.sin(theta * 0.5)
-        c = math.cos(theta * 0.5)
-        v = [0.0, 0.0, 0.0]
-        v[ax] = s
-        return (v[0], v[1], v[2], c)
-
-    def qmul(a, b):
-        ax, ay, az, aw = a
-        bx, by, bz, bw = b
-        return (
-            aw * bx + ax * bw + ay * bz - az * by,
-            aw * by - ax * bz + ay * bw + az * bx,
-            aw * bz + ax * by - ay * bx + az * bw,
-            aw * bw - ax * bx - ay * by - az * bz,
-        )
-
-    qy = axis(ey, 1)
-    qx = axis(ex, 0)
-    qz = axis(ez, 2)
-    q = qmul(qmul(qy, qx), qz)
-    qx_, qy_, qz_, qw_ = q
-    # Z-up -> Y-up axis component swap (x, y, z) -> (x, z, -y).
-    return (qx_, qz_, -qy_, qw_)
+def anim_timeline(buf: bytes, recs: List[AnimRecord], aid: int,
+                  anim_table_off: int) -> Tuple[List[float], List[int]]:
+    """(key times in seconds, pose targets) for one anim record."""
+    rec = recs[aid]
+    if aid + 1 < len(recs):
+        end_off = recs[aid + 1].timeline_off
+    elif 0 < rec.lod_param < 0x200:
+        end_off = rec.timeline_off + rec.lod_param
+    else:
+        end_off = anim_table_off
+    entries = parse_timeline(buf, rec.timeline_off, end_off)
+    if not entries:
+        return [], []
+    # Each entry says "interpolate to target N over duration D frames".
+    # In-game, entry[0]'s duration is the blend-in window from
+    # whatever pose the previous animation left, so for an isolated
+    # export we treat target[0] as the start pose at t=0 and only
+    # advance time for entries 1..N-1.
+    times: List[float] = [0.0]
+    targets: List[int] = [entries[0].target]
+    t = 0.0
+    for e in entries[1:]:
+        t += e.duration / 60.0
+        times.append(t)
+        targets.append(e.target)
+    return times, targets
 
 
 def emit_animated(buf: bytes, mesh: PSC3FullMesh, gltf_path: str, name: str,
                   anim_ids: Optional[List[int]] = None,
                   bundle_dir: Optional[str] = None,
                   png_override: Optional[str] = None,
-                  bind_anim_id: int = 0) -> dict:
+                  bind_anim_id: int = 0,
+                  pose_bank: Optional[PoseBank] = None) -> dict:
     """Emit a single glTF containing one or more animations.
 
     The mesh, nodes, and materials are shared across all animations;
     each PSC3 anim record becomes a separate glTF Animation entry.
     ``bind_anim_id`` selects which record's target=0 pose is used as
-    the static node TRS (defaults to anim 0).
+    the static node TRS (defaults to anim 0). Callers emitting several
+    files for one model pass the same ``pose_bank`` so the keyframe
+    pool is decoded once.
     """
+    if pose_bank is None:
+        pose_bank = PoseBank(buf, mesh)
     bin_path = os.path.splitext(gltf_path)[0] + ".bin"
     bin_uri = os.path.basename(bin_path)
 
@@ -155,31 +130,6 @@ def emit_animated(buf: bytes, mesh: PSC3FullMesh, gltf_path: str, name: str,
         if aid < 0 or aid >= len(recs):
             raise ValueError(f"anim_id {aid} out of range; got {len(recs)} records")
 
-    def _timeline_for(aid: int) -> Tuple[List[float], List[int]]:
-        rec = recs[aid]
-        if aid + 1 < len(recs):
-            end_off = recs[aid + 1].timeline_off
-        elif 0 < rec.lod_param < 0x200:
-            end_off = rec.timeline_off + rec.lod_param
-        else:
-            end_off = anim_table_off
-        entries = parse_timeline(buf, rec.timeline_off, end_off)
-        if not entries:
-            return [], []
-        # Each entry says "interpolate to target N over duration D frames".
-        # In-game, entry[0]'s duration is the blend-in window from
-        # whatever pose the previous animation left, so for an isolated
-        # export we treat target[0] as the start pose at t=0 and only
-        # advance time for entries 1..N-1.
-        times: List[float] = [0.0]
-        targets: List[int] = [entries[0].target]
-        t = 0.0
-        for e in entries[1:]:
-            t += e.duration / 60.0
-            times.append(t)
-            targets.append(e.target)
-        return times, targets
-
     # ---- geometry ----
     # Use the static face builder to get material info & ordering, but
     # we discard its per-submesh grouping: PSC3 uses per-vertex skinning
@@ -429,9 +379,7 @@ def emit_animated(buf: bytes, mesh: PSC3FullMesh, gltf_path: str, name: str,
     nodes: List[dict] = [{"name": name, "children": []}]
     sm_to_node_index: Dict[int, int] = {}
     for sm in mesh.submeshes:
-        tr_raw, eu_raw, _scale = sample_pose_v2(buf, mesh, sm.index, 0)
-        tx, ty, tz = _swap_trans(tr_raw)
-        qx, qy, qz, qw = _euler_to_quat(*eu_raw)
+        (tx, ty, tz), (qx, qy, qz, qw) = pose_bank.node_trs(sm.index, 0)
         node: dict = {
             "name": f"{name}_sm{sm.index:02d}",
             "translation": [tx, ty, tz],
@@ -490,7 +438,7 @@ def emit_animated(buf: bytes, mesh: PSC3FullMesh, gltf_path: str, name: str,
     animations_json: List[dict] = []
     anim_summaries: List[dict] = []
     for aid in anim_ids:
-        times, targets = _timeline_for(aid)
+        times, targets = anim_timeline(buf, recs, aid, anim_table_off)
         if not times:
             continue
         anim_samplers: List[dict] = []
@@ -503,29 +451,13 @@ def emit_animated(buf: bytes, mesh: PSC3FullMesh, gltf_path: str, name: str,
             sm_idx = sm.index
             if sm_idx not in sm_to_node_index:
                 continue
-            trans_kf: List[Tuple[float, float, float]] = []
-            rot_kf: List[Tuple[float, float, float, float]] = []
-            for tgt in targets:
-                tr, eu, _scale = sample_pose_v2(buf, mesh, sm_idx, tgt)
-                trans_kf.append(_swap_trans(tr))
-                q = _euler_to_quat(*eu)
-                # Hemisphere-correct successive quats so that LINEAR
-                # interpolation in glTF doesn't take the long way around
-                # the 4-sphere. q and -q represent the same rotation; we
-                # negate q whenever its dot with the previous keyframe is
-                # negative.
-                if rot_kf:
-                    pq = rot_kf[-1]
-                    dot = q[0]*pq[0] + q[1]*pq[1] + q[2]*pq[2] + q[3]*pq[3]
-                    if dot < 0.0:
-                        q = (-q[0], -q[1], -q[2], -q[3])
-                rot_kf.append(q)
-            t_off = binbuf.append(_f32_vec3(trans_kf))
-            r_off = binbuf.append(_f32_vec4(rot_kf))
-            bv_t = _add_bv(t_off, len(trans_kf) * 12)
-            bv_r = _add_bv(r_off, len(rot_kf) * 16)
-            a_t = _add_acc(bv_t, len(trans_kf), "VEC3", 5126)
-            a_r = _add_acc(bv_r, len(rot_kf), "VEC4", 5126)
+            trans_bytes, rot_bytes = pose_bank.tracks(sm_idx, targets)
+            t_off = binbuf.append(trans_bytes)
+            r_off = binbuf.append(rot_bytes)
+            bv_t = _add_bv(t_off, len(targets) * 12)
+            bv_r = _add_bv(r_off, len(targets) * 16)
+            a_t = _add_acc(bv_t, len(targets), "VEC3", 5126)
+            a_r = _add_acc(bv_r, len(targets), "VEC4", 5126)
             s_t = len(anim_samplers)
             anim_samplers.append({"input": a_time, "output": a_t, "interpolation": "LINEAR"})
             s_r = len(anim_samplers)
@@ -556,8 +488,9 @@ def emit_animated(buf: bytes, mesh: PSC3FullMesh, gltf_path: str, name: str,
         "bufferViews": buffer_views,
         "accessors": accessors,
         "materials": materials,
-        "animations": animations_json,
     }
+    if animations_json:
+        gltf["animations"] = animations_json
     if skins_json:
         gltf["skins"] = skins_json
     if textures:
@@ -594,6 +527,69 @@ def emit_animated(buf: bytes, mesh: PSC3FullMesh, gltf_path: str, name: str,
     }
 
 
+def emit_clip_store(buf: bytes, mesh: PSC3FullMesh, out_dir: str, name: str,
+                    anim_ids: Optional[List[int]] = None,
+                    bundle_dir: Optional[str] = None,
+                    png_override: Optional[str] = None,
+                    pose_bank: Optional[PoseBank] = None,
+                    pos_tol: float = anim_clips.POS_TOL,
+                    rot_tol: float = anim_clips.ROT_TOL) -> dict:
+    """Write ``<out_dir>/<name>.gltf`` (mesh + skeleton, no animations) and
+    ``<out_dir>/<name>.clips`` holding every selected anim id.
+
+    Clip tracks follow the skin's joint order (``mesh.submeshes``) and go
+    through ``anim_clips`` keyframe reduction: translations within
+    ``pos_tol`` times the skeleton's extent, rotations within ``rot_tol``
+    radians.
+    """
+    if pose_bank is None:
+        pose_bank = PoseBank(buf, mesh)
+    stats = emit_animated(buf, mesh, os.path.join(out_dir, f"{name}.gltf"), name,
+                          anim_ids=[], bundle_dir=bundle_dir,
+                          png_override=png_override, pose_bank=pose_bank)
+    table_off = mesh.header['offs_u0c']
+    recs = parse_anim_table(buf, table_off)
+    if anim_ids is None:
+        anim_ids = list(range(len(recs)))
+
+    # Tolerance scale: the rest skeleton's largest translation component.
+    extent = max((abs(v) for sm in mesh.submeshes
+                  for v in pose_bank.node_trs(sm.index, 0)[0]), default=1.0) or 1.0
+    clips: List[anim_clips.Clip] = []
+    keys_in = keys_out = 0
+    for aid in anim_ids:
+        times, targets = anim_timeline(buf, recs, aid, table_off)
+        if not times:
+            continue
+        clip = anim_clips.Clip(aid, times)
+        k = len(targets)
+        for sm in mesh.submeshes:
+            trans_bytes, rot_bytes = pose_bank.tracks(sm.index, targets)
+            t = struct.unpack(f'<{3 * k}f', trans_bytes)
+            r = struct.unpack(f'<{4 * k}f', rot_bytes)
+            trans = anim_clips.reduce_track(
+                times, [t[3 * i:3 * i + 3] for i in range(k)], pos_tol * extent)
+            rot = anim_clips.reduce_track(
+                times, [r[4 * i:4 * i + 4] for i in range(k)], rot_tol, rotation=True)
+            clip.tracks.append((trans, rot))
+            keys_in += 2 * k
+            keys_out += len(trans.keys) + len(rot.keys)
+        clips.append(clip)
+
+    data = anim_clips.encode(clips, len(mesh.submeshes))
+    clips_path = os.path.join(out_dir, f"{name}.clips")
+    with open(clips_path, 'wb') as fc:
+        fc.write(data)
+    stats.update({
+        'clips_path': clips_path,
+        'clips': [c.anim_id for c in clips],
+        'clip_bytes': len(data),
+        'keys_in': keys_in,
+        'keys_out': keys_out,
+    })
+    return stats
+
+
 def _parse_anim_ids(spec: str, total: int) -> List[int]:
     """Parse 'all', '0,2,3', or '0-3' into an ordered list of ids."""
     spec = spec.strip().lower()
@@ -633,6 +629,10 @@ def main() -> int:
     ap.add_argument('--flat-aids', action='store_true',
                     help="Use legacy sibling layout <dst>_aid<N>/ "
                          "instead of nested <dst>/aid<N>/.")
+    ap.add_argument('--clips', action='store_true',
+                    help="Write the mesh once as <dst>/<name>.gltf and pack the "
+                         "selected anim ids into <dst>/<name>.clips (quantized, "
+                         "keyframe-reduced; see anim_clips.py).")
     args = ap.parse_args()
     data = open(args.src, 'rb').read()
     if len(data) < 4 or _u32(data, 0) != MAGIC_PSC3:
@@ -648,6 +648,14 @@ def main() -> int:
     name = os.path.splitext(os.path.basename(args.src))[0]
     bundle_dir = os.path.dirname(os.path.abspath(args.src))
 
+    if args.clips:
+        stats = emit_clip_store(data, mesh, args.dst, name, anim_ids=anim_ids,
+                                bundle_dir=bundle_dir, png_override=args.png)
+        print(f"Wrote {stats['gltf_path']}")
+        print(f"Wrote {stats['clips_path']}  clips={len(stats['clips'])}  "
+              f"keys {stats['keys_in']} -> {stats['keys_out']}  {stats['clip_bytes']}B")
+        return 0
+
     if args.multi_anim:
         out_gltf = os.path.join(args.dst, f"{name}.gltf")
         stats = emit_animated(data, mesh, out_gltf, name, anim_ids=anim_ids,
@@ -666,6 +674,7 @@ def main() -> int:
     # together in one folder. Pass --flat-aids to fall back to the
     # legacy sibling layout (<dst>_aid<N>/).
     parent = args.dst.rstrip('/\\')
+    bank = PoseBank(data, mesh)
     for aid in anim_ids:
         if args.flat_aids:
             out_dir = f"{parent}_aid{aid}"
@@ -673,7 +682,8 @@ def main() -> int:
             out_dir = os.path.join(parent, f"aid{aid}")
         out_gltf = os.path.join(out_dir, f"{name}.gltf")
         stats = emit_animated(data, mesh, out_gltf, name, anim_ids=[aid],
-                              bundle_dir=bundle_dir, png_override=args.png)
+                              bundle_dir=bundle_dir, png_override=args.png,
+                              pose_bank=bank)
         print(f"Wrote {stats['gltf_path']}")
         a = stats['animations'][0] if stats['animations'] else None
         info = (f"channels={a['channels']} keyframes={a['keyframes']} "
@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+"""Batched PSC3 pose engine — keyframe pool decoded once per model.
+
+`psc3_full.sample_pose_v2` resolves one (submesh, pose) pair per call:
+it re-reads the pose slab word and the keyframe-pool shorts with
+`struct.unpack_from`, and `psc3_gltf_anim` then runs the Euler -> quat
+conversion on the result. Exporting every anim id of a model repeats
+that work for every keyframe of every track.
+
+`PoseBank` does it once per model:
+
+  1. each submesh's pose slab (u32 per pose, at psc3 + sec_a_off) is
+     read with a single `unpack_from`;
+  2. every distinct keyframe-pool entry it references (section B,
+     header +0x2C) is decoded once — trans+scale records and Euler
+     records are cached by pool index, so the trig in `_euler_to_quat`
+     runs once per distinct rotation rather than once per keyframe;
+  3. the results are laid out structure-of-arrays: one `array('d')`
+     column per channel, one row per (submesh, pose), row 0 = identity.
+
+Lookups and glTF track packing (`tracks`) then work on whole columns.
+Values are bit-identical to `sample_pose_v2` + `_euler_to_quat` /
+`_swap_trans` (same float operations, same fallbacks), so switching
+callers changes no output.
+
+CLI (self-check against sample_pose_v2, plus timings):
+    python -m tools.resource_extract.v2.psc3_pose grp_0183.psc3 --check
+"""
+from __future__ import annotations
+
+import argparse
+import math
+import struct
+import sys
+import time
+from array import array
+from typing import Dict, List, Optional, Sequence, Tuple
+
+from .psc3_full import (
+    EULER_DIVISOR,
+    MAGIC_PSC3,
+    QUAT_SENTINEL,
+    SCALE_DENOM,
+    PSC3FullMesh,
+    _u32,
+    parse_psc3_full,
+    sample_pose_v2,
+)
+
+Vec3 = Tuple[float, float, float]
+Quat = Tuple[float, float, float, float]
+
+
+def _swap_trans(t):
+    """PS2 Z-up -> glTF Y-up: (x, y, z) -> (x, z, -y)."""
+    x, y, z = t
+    return (x, z, -y)
+
+
+def _euler_to_quat(ex: float, ey: float, ez: float) -> Tuple[float, float, float, float]:
+    """Convert PS2 euler triple to a unit quaternion in glTF Y-up space.
+
+    Empirically verified convention (validated against in-game capture
+    of grp_0001 aid2): YXZ with positive signs and the standard Z-up ->
+    Y-up axis-component swap.
+
+        q = q_y(ey) * q_x(ex) * q_z(ez)
+
+    Derivation: per-bone runtime build path
+    ``FUN_0020cf28`` (param_10==0, called from ``FUN_0020d618``)
+    constructs the matrix as
+        M = I -> diag(s) -> *R_z(-ez) -> *R_x(-ex) -> *R_y(-ey) -> *T
+    where each per-axis cell function (FUN_0020ba30/ba88/bae0) writes
+    four entries of the working buffer and a VU0 microprogram at
+    ``_vcallms 0x60`` composes it with the running matrix. The PS2
+    runtime uses row-vector convention (v' = v * M), so the per-bone
+    rotation applied to a row vector is equivalent to a column-vector
+    rotation by R_y(ey) * R_x(ex) * R_z(ez) -- hence the YXZ order with
+    POSITIVE signs in the column-vector quaternion form glTF uses.
+
+    The Z-up -> Y-up axis component swap (x, y, z) -> (x, z, -y) is
+    applied after composition to match the translation swap.
+
+    The entity-root caller (``FUN_0020cdc0``) passes ``param_10 = 1``
+    which selects the XYZ branch; that is the world transform of the
+    entity, not a per-bone transform, and is irrelevant to PSC3 bone
+    poses.
+    """
+    def axis(theta: float, ax: int) -> Tuple[float, float, float, float]:
+        s = math.sin(theta * 0.5)
+        c = math.cos(theta * 0.5)
+        v = [0.0, 0.0, 0.0]
+        v[ax] = s
+        return (v[0], v[1], v[2], c)
+
+    def qmul(a, b):
+        ax, ay, az, aw = a
+        bx, by, bz, bw = b
+        return (
+            aw * bx + ax * bw + ay * bz - az * by,
+            aw * by - ax * bz + ay * bw + az * bx,
+            aw * bz + ax * by - ay * bx + az * bw,
+            aw * bw - ax * bx - ay * by - az * bz,
+        )
+
+    qy = axis(ey, 1)
+    qx = axis(ex, 0)
+    qz = axis(ez, 2)
+    q = qmul(qmul(qy, qx), qz)
+    qx_, qy_, qz_, qw_ = q
+    # Z-up -> Y-up axis component swap (x, y, z) -> (x, z, -y).
+    return (qx_, qz_, -qy_, qw_)
+
+
+# Raw channels (as sample_pose_v2 returns them) and glTF-space channels.
+_RAW = ("tx", "ty", "tz", "scale", "ex", "ey", "ez")
+_GLTF = ("gx", "gy", "gz", "qx", "qy", "qz", "qw")
+_IDENT_RAW = (0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0)
+
+
+def _gltf_row(raw: Sequence[float]) -> Tuple[float, ...]:
+    return _swap_trans(raw[0:3]) + _euler_to_quat(raw[4], raw[5], raw[6])
+
+
+class PoseBank:
+    """Every submesh pose of one PSC3, decoded into column arrays."""
+
+    def __init__(self, buf: bytes | memoryview, mesh: PSC3FullMesh):
+        self.mesh = mesh
+        n = len(buf)
+        secB = mesh.header['offs_section_b']
+        cols: Dict[str, array] = {c: array('d') for c in _RAW + _GLTF}
+        ident = _IDENT_RAW + _gltf_row(_IDENT_RAW)
+        self._ident = ident
+
+        # Pool caches: index -> decoded record.
+        trs_cache: Dict[int, Optional[Tuple[float, float, float, float]]] = {}
+        eul_cache: Dict[int, Tuple[float, float, float]] = {}
+        row_cache: Dict[Tuple[int, int], Tuple[float, ...]] = {}
+
+        def trs(idx: int):
+            # None = 0x7fff sentinel (whole pose collapses to identity).
+            rec = trs_cache.get(idx, ())
+            if rec == ():
+                rec = (0.0, 0.0, 0.0, 1.0)
+                base = secB + idx * 2
+                if base + 8 <= n:
+                    s = struct.unpack_from('<4h', buf, base)
+                    if s[0] == QUAT_SENTINEL:
+                        rec = None
+                    else:
+                        rec = (s[0] / 2048.0, s[1] / 2048.0, s[2] / 2048.0, s[3] / SCALE_DENOM)
+                trs_cache[idx] = rec
+            return rec
+
+        def euler(idx: int) -> Tuple[float, float, float]:
+            rec = eul_cache.get(idx)
+            if rec is None:
+                rec = (0.0, 0.0, 0.0)
+                base = secB + idx * 2
+                if base + 6 <= n:
+                    s = struct.unpack_from('<3h', buf, base)
+                    rec = (s[0] / EULER_DIVISOR, s[1] / EULER_DIVISOR, s[2] / EULER_DIVISOR)
+                eul_cache[idx] = rec
+            return rec
+
+        def row_for(packed: int) -> Tuple[float, ...]:
+            rot_idx = packed & 0xFFFF
+            trans_idx = (packed >> 16) & 0xFFFF
+            key = (rot_idx, trans_idx)
+            row = row_cache.get(key)
+            if row is not None:
+                return row
+            t: Optional[Tuple[float, float, float, float]] = (0.0, 0.0, 0.0, 1.0)
+            if rot_idx != 0xFFFF and secB:
+                t = trs(rot_idx)
+            if t is None:
+                row = ident
+            else:
+                e = (0.0, 0.0, 0.0)
+                if trans_idx != 0xFFFF and secB:
+                    e = euler(trans_idx)
+                raw = t + e
+                row = raw + _gltf_row(raw)
+            row_cache[key] = row
+            return row
+
+        rows: List[Tuple[float, ...]] = [ident]
+        self.base: List[int] = []
+        self.count: List[int] = []
+        for sm in mesh.submeshes:
+            poses = sm.byte_len // 4 if sm.section_a_off != 0 and sm.byte_len > 0 else 0
+            self.base.append(len(rows))
+            self.count.append(poses)
+            if not poses:
+                continue
+            avail = max(0, min(poses, (n - sm.section_a_off) // 4))
+            for packed in struct.unpack_from(f'<{avail}I', buf, sm.section_a_off):
+                rows.append(row_for(packed))
+            rows.extend([ident] * (poses - avail))
+
+        for i, c in enumerate(_RAW + _GLTF):
+            cols[c].extend(r[i] for r in rows)
+        self.cols = cols
+        self.rows = len(rows)
+        self.distinct_trs = len(trs_cache)
+        self.distinct_euler = len(eul_cache)
+
+    # ---- lookups -----------------------------------------------------
+
+    def row(self, sm_id: int, pose_idx: int) -> int:
+        """Row index with sample_pose_v2's fallbacks (0 = identity)."""
+        if sm_id < 0 or sm_id >= len(self.base) or pose_idx < 0:
+            return 0
+        count = self.count[sm_id]
+        if count <= 0:
+            return 0
+        if pose_idx >= count:
+            pose_idx = 0
+        return self.base[sm_id] + pose_idx
+
+    def sample(self, sm_id: int, pose_idx: int) -> Tuple[Vec3, Vec3, float]:
+        """Same result as `sample_pose_v2(buf, mesh, sm_id, pose_idx)`."""
+        r = self.row(sm_id, pose_idx)
+        c = self.cols
+        return ((c['tx'][r], c['ty'][r], c['tz'][r]),
+                (c['ex'][r], c['ey'][r], c['ez'][r]), c['scale'][r])
+
+    def node_trs(self, sm_id: int, pose_idx: int) -> Tuple[Vec3, Quat]:
+        """glTF-space (translation, rotation) for one pose."""
+        r = self.row(sm_id, pose_idx)
+        c = self.cols
+        return ((c['gx'][r], c['gy'][r], c['gz'][r]),
+                (c['qx'][r], c['qy'][r], c['qz'][r], c['qw'][r]))
+
+    def tracks(self, sm_id: int, targets: Sequence[int]) -> Tuple[bytes, bytes]:
+        """Packed little-endian f32 (VEC3 translation, VEC4 rotation) keyframes.
+
+        Successive quats are hemisphere-corrected (q and -q are the same
+        rotation) so glTF LINEAR interpolation takes the short way.
+        """
+        c = self.cols
+        gx, gy, gz = c['gx'], c['gy'], c['gz']
+        qx, qy, qz, qw = c['qx'], c['qy'], c['qz'], c['qw']
+        rows = [self.row(sm_id, t) for t in targets]
+        trans: List[float] = []
+        rot: List[float] = []
+        px = py = pz = pw = None
+        for r in rows:
+            trans += (gx[r], gy[r], gz[r])
+            x, y, z, w = qx[r], qy[r], qz[r], qw[r]
+            if px is not None and x * px + y * py + z * pz + w * pw < 0.0:
+                x, y, z, w = -x, -y, -z, -w
+            rot += (x, y, z, w)
+            px, py, pz, pw = x, y, z, w
+        k = len(rows)
+        return struct.pack(f'<{3 * k}f', *trans), struct.pack(f'<{4 * k}f', *rot)
+
+
+# ---------------------------------------------------------------------------
+# CLI
+# ---------------------------------------------------------------------------
+
+def main(argv: list[str] | None = None) -> int:
+    ap = argparse.ArgumentParser(description="PSC3 pose bank: self-check and timings")
+    ap.add_argument('src', help="PSC3 file")
+    ap.add_argument('--check', action='store_true',
+                    help="Compare every (submesh, pose) against sample_pose_v2")
+    args = ap.parse_args(argv)
+
+    with open(args.src, 'rb') as f:
+        data = f.read()
+    if len(data) < 4 or _u32(data, 0) != MAGIC_PSC3:
+        print(f"Not a PSC3: {args.src}", file=sys.stderr)
+        return 1
+    mesh = parse_psc3_full(data)
+
+    t0 = time.perf_counter()
+    bank = PoseBank(data, mesh)
+    t1 = time.perf_counter()
+    print(f"{args.src}: {len(mesh.submeshes)} submeshes, {bank.rows - 1} pose rows, "
+          f"{bank.distinct_trs} trans+scale / {bank.distinct_euler} euler pool entries, "
+          f"decoded in {(t1 - t0) * 1e3:.1f} ms")
+
+    pairs = [(sm.index, p) for sm in mesh.submeshes for p in range(bank.count[sm.index] + 1)]
+    if args.check:
+        bad = 0
+        t0 = time.perf_counter()
+        for sm_id, p in pairs:
+            if bank.sample(sm_id, p) != sample_pose_v2(data, mesh, sm_id, p):
+                bad += 1
+        t1 = time.perf_counter()
+        print(f"check: {len(pairs)} samples, {bad} mismatches ({(t1 - t0) * 1e3:.1f} ms incl. reference)")
+        if bad:
+            return 1
+
+    frames = max(bank.count, default=0)
+    t0 = time.perf_counter()
+    for sm in mesh.submeshes:
+        bank.tracks(sm.index, range(frames))
+    t1 = time.perf_counter()
+    print(f"tracks: {len(mesh.submeshes)} x {frames} keyframes in {(t1 - t0) * 1e3:.1f} ms")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -17,8 +17,12 @@ passes FUN_0022c6e8 / FUN_00211230):
   axis-aligned values like (0,1,0), (0,0,1), (-1,0,0).
 
 - Section A (header +0x04): per-mesh records, 0x20 stride, six dwords each.
-  Used by Section J construction; not directly relevant for offline mesh
-  extraction.
+  Used by Section J construction: the low shorts of dwords 0/1 are the
+  start and length of the record's Section C slice.
+
+- Section J (header +0x1C): s16 count, 13 shorts per record; short 0 is
+  the Section A index. FUN_00211230 emits geometry per A/J record, so the
+  C slices are the engine's draw groups (``j_slices``).
 
 - Section D (header +0x0C): primitives. Each on-disk record is exactly
   16 u16 (32 bytes). Only the first four matter for geometry:
@@ -34,15 +38,22 @@ Notes:
 - The "extra A triplet" appended to per-J vertex buffers at runtime is a
   difference vector used internally; it does not extend the C index domain
   for D-records, so we ignore it for OBJ export.
+
+Usage (from the repo root; the module is part of the package, so run it
+with -m rather than as a script path):
+    python -m tools.resource_extract.v2.psm2 --src FILE_OR_DIR --dst OUT_DIR
 """
 from __future__ import annotations
 
 import argparse
 import os
 import struct
+import sys
+from array import array
 from dataclasses import dataclass, field
 from typing import List, Tuple
 
+
 MAGIC_PSM2 = 0x324D5350
 
 
@@ -73,6 +84,11 @@ class PSM2Mesh:
     runtime loader. We keep them raw so consumers can pick out whichever
     fields they need (UVs at bytes [0..3] as little-endian u16, etc.)."""
 
+    j_slices: List[Tuple[int, int]] = field(default_factory=list)
+    """Per Section J record: (first C index, count) of its Section C slice,
+    resolved through the owning Section A record; (-1, 0) when the A index
+    is out of range."""
+
     header_offsets: dict = field(default_factory=dict)
 
 
@@ -92,6 +108,123 @@ def _f32(buf: bytes, off: int) -> float:
     return struct.unpack_from('<f', buf, off)[0]
 
 
+# ---------------------------------------------------------------------------
+# Columnar section decode
+# ---------------------------------------------------------------------------
+
+@dataclass
+class PSM2Columns:
+    """Every fixed-stride section of one PSM2 chunk as flat typed arrays.
+
+    Each section is copied out of the chunk once and reinterpreted as an
+    ``array`` of its element type; fields are strided slices of that
+    array, so decoding costs a handful of C-level copies however many
+    records there are. Little-endian on every host.
+    """
+    xyz: array = field(default_factory=lambda: array('f'))
+    """Section C positions, 3 floats per record."""
+
+    b_index: array = field(default_factory=lambda: array('H'))
+    """Section C u16 at +0x0C, one per record."""
+
+    b_normals: array = field(default_factory=lambda: array('f'))
+    """Section B, 3 floats per record (unresolved)."""
+
+    prims: array = field(default_factory=lambda: array('H'))
+    """Section D u16[0..3], 4 per record."""
+
+    prim_e: array = field(default_factory=lambda: array('H'))
+    """Section D u16[6], one per record."""
+
+    uv: bytes = b''
+    """Section E, 12 raw bytes per record."""
+
+    a_slices: array = field(default_factory=lambda: array('H'))
+    """Section A (start, count) pairs: u16 at +0 and +4 of each record."""
+
+    j_a: array = field(default_factory=lambda: array('h'))
+    """Section J short 0 (Section A index), one per record."""
+
+
+def _fit(buf: bytes, off: int, cnt: int, stride: int, need: int) -> int:
+    """How many of ``cnt`` records at ``off`` have their first ``need`` bytes
+    inside ``buf``; the rest are dropped, as a truncated chunk's tail."""
+    room = len(buf) - off - need
+    return 0 if cnt <= 0 or room < 0 else min(cnt, room // stride + 1)
+
+
+def _rows(buf: bytes, off: int, n: int, stride: int, typecode: str) -> array:
+    """``n`` records of ``stride`` bytes at ``off`` as one flat array; a last
+    record cut short by the end of ``buf`` is zero-filled."""
+    raw = bytes(buf[off:off + n * stride])
+    out = array(typecode, raw + b'\0' * (n * stride - len(raw)))
+    if sys.byteorder != 'little':
+        out.byteswap()
+    return out
+
+
+def decode_columns(buf: bytes, offs: dict) -> PSM2Columns:
+    """Decode sections A/B/C/D/E/J at ``offs`` (``parse_psm2`` header
+    offsets) into a :class:`PSM2Columns`.
+
+    Counts and record strides are the ones ``FUN_0022b5a8`` reads (see
+    the per-section notes in ``parse_psm2``); FUN_0022b4e0 / FUN_0022b520
+    are plain read-and-advance helpers, so every section here is
+    fixed-stride and nothing has to be walked record by record.
+    """
+    col = PSM2Columns()
+
+    if offs['C']:
+        base = offs['C']
+        cnt = max(0, _s16(buf, base))
+        if _fit(buf, base + 2, cnt, 16, 14) < cnt:
+            raise ValueError("PSM2 section C runs past the end of the chunk")
+        rows = _rows(buf, base + 2, cnt, 16, 'f')
+        col.xyz = array('f', bytes(12 * cnt))
+        for c in range(3):
+            col.xyz[c::3] = rows[c::4]
+        col.b_index = _rows(buf, base + 2, cnt, 16, 'H')[6::8]
+
+    if offs['B']:
+        base = offs['B']
+        cnt = _u32(buf, base) & 0xFFFF
+        if cnt >= 0x8000:
+            cnt = 0
+        col.b_normals = _rows(buf, base + 4, _fit(buf, base + 4, cnt, 12, 12), 12, 'f')
+
+    if offs['D']:
+        base = offs['D']
+        n = _fit(buf, base + 4, _s16(buf, base), 32, 14)
+        rows = _rows(buf, base + 4, n, 32, 'H')
+        col.prims = array('H', bytes(8 * n))
+        for c in range(4):
+            col.prims[c::4] = rows[c::16]
+        col.prim_e = rows[6::16]
+
+    if offs['E']:
+        base = offs['E']
+        cnt = _u16(buf, base)
+        if cnt >= 0x8000:
+            cnt = 0
+        n = _fit(buf, base + 2, cnt, 12, 12)
+        col.uv = bytes(buf[base + 2:base + 2 + 12 * n])
+
+    if offs['A']:
+        base = offs['A']
+        n = _fit(buf, base + 4, _s16(buf, base), 24, 24)
+        rows = _rows(buf, base + 4, n, 24, 'H')
+        col.a_slices = array('H', bytes(4 * n))
+        col.a_slices[0::2] = rows[0::12]
+        col.a_slices[1::2] = rows[2::12]
+
+    if offs['J']:
+        base = offs['J']
+        n = _fit(buf, base + 2, _s16(buf, base), 26, 26)
+        col.j_a = _rows(buf, base + 2, n, 26, 'h')[0::13]
+
+    return col
+
+
 def parse_psm2(buf: bytes) -> PSM2Mesh:
     if len(buf) < 0x3C or _u32(buf, 0) != MAGIC_PSM2:
         raise ValueError("not a PSM2 chunk")
@@ -101,80 +234,51 @@ def parse_psm2(buf: bytes) -> PSM2Mesh:
         'C': _u32(buf, 0x08),
         'D': _u32(buf, 0x0C),
         'E': _u32(buf, 0x14),
+        'J': _u32(buf, 0x1C),
         'B': _u32(buf, 0x30),
     }
+    col = decode_columns(buf, offs)
     mesh = PSM2Mesh(header_offsets=offs)
 
-    # Section C — positions (+ b_index per vertex)
-    if offs['C']:
-        base = offs['C']
-        cnt = _s16(buf, base)
-        p = base + 2
-        for _ in range(max(0, cnt)):
-            x, y, z = _f32(buf, p), _f32(buf, p + 4), _f32(buf, p + 8)
-            b_index = _u16(buf, p + 12)
-            mesh.positions.append((x, y, z))
-            mesh.c_to_b.append(b_index)
-            p += 16
+    # Section C — positions (+ b_index per vertex). 16 bytes per record
+    # after the s16 count; the trailing style byte is not decoded.
+    xyz = col.xyz
+    mesh.positions = list(zip(xyz[0::3], xyz[1::3], xyz[2::3]))
+    mesh.c_to_b = col.b_index.tolist()
 
     # Section B — normals. The on-disk layout is:
     #   +0  : u32 count (the loader truncates this to a signed short)
     #   +4  : 3 dwords (= 3 floats) per record, no padding in the file
     # In memory each record is widened to 0x10 bytes by zeroing a 4th dword,
-    # but on disk the stride is 12 bytes.
-    bvals: List[Tuple[float, float, float]] = []
-    if offs['B']:
-        base = offs['B']
-        cnt = _u32(buf, base) & 0xFFFF
-        # Treat as signed short — negative means "no records".
-        if cnt >= 0x8000:
-            cnt = 0
-        p = base + 4
-        for _ in range(cnt):
-            if p + 12 > len(buf):
-                break
-            bvals.append((_f32(buf, p), _f32(buf, p + 4), _f32(buf, p + 8)))
-            p += 12
-
-    # Resolve per-position normals through the C->B map.
-    for bi in mesh.c_to_b:
-        if 0 <= bi < len(bvals):
-            mesh.normals.append(bvals[bi])
-        else:
-            mesh.normals.append((0.0, 0.0, 1.0))
+    # but on disk the stride is 12 bytes. Resolved per position through
+    # the C->B map.
+    bn = col.b_normals
+    bvals = list(zip(bn[0::3], bn[1::3], bn[2::3]))
+    nb = len(bvals)
+    up = (0.0, 0.0, 1.0)
+    mesh.normals = [bvals[bi] if bi < nb else up for bi in mesh.c_to_b]
 
     # Section D — primitives (32 bytes per record; first 4 u16 are indices).
     # The loader reads `count` from the section start, but records begin 4
     # bytes in (`&DAT_01849a04 + iVar22` in FUN_0022b5a8), not 2 bytes in —
     # the 2-byte slot after the count is reserved/unused header.
-    if offs['D']:
-        base = offs['D']
-        cnt = _s16(buf, base)
-        p = base + 4
-        for _ in range(max(0, cnt)):
-            if p + 8 > len(buf):
-                break
-            s0 = _u16(buf, p + 0)
-            s1 = _u16(buf, p + 2)
-            s2 = _u16(buf, p + 4)
-            s3 = _u16(buf, p + 6)
-            mesh.primitives.append((s0, s1, s2, s3))
-            # Per-prim attribute index. The loader writes u16[6..9] to four
-            # corner slots, but in real maps only u16[6] holds a non-sentinel
-            # value; u16[7..9] are 0xFFFF (invalid stubs) for every prim.
-            # The renderer fetches all 4 corner UVs from the SINGLE E record
-            # at u16[6] (see byte layout in `uv_records`).
-            #
-            # Encoding of u16[6]:
-            #   0x0000..0x7FFE  -> index into Section E (textured prim).
-            #   0x8000..0xFFFE  -> palette colour (low 15 bits = palette idx).
-            #   0xFFFF          -> invalid / fully-stubbed prim.
-            #
-            # We keep four parallel slots in `prim_uv_indices` to match the
-            # 4-corner geometry, but they all point at the same E record.
-            prim_e = _u16(buf, p + 12)
-            mesh.prim_uv_indices.append((prim_e, prim_e, prim_e, prim_e))
-            p += 32
+    pr = col.prims
+    mesh.primitives = list(zip(pr[0::4], pr[1::4], pr[2::4], pr[3::4]))
+    # Per-prim attribute index. The loader writes u16[6..9] to four
+    # corner slots, but in real maps only u16[6] holds a non-sentinel
+    # value; u16[7..9] are 0xFFFF (invalid stubs) for every prim.
+    # The renderer fetches all 4 corner UVs from the SINGLE E record
+    # at u16[6] (see byte layout in `uv_records`).
+    #
+    # Encoding of u16[6]:
+    #   0x0000..0x7FFE  -> index into Section E (textured prim).
+    #   0x8000..0xFFFE  -> palette colour (low 15 bits = palette idx).
+    #   0xFFFF          -> invalid / fully-stubbed prim.
+    #
+    # We keep four parallel slots in `prim_uv_indices` to match the
+    # 4-corner geometry, but they all point at the same E record.
+    pe = col.prim_e
+    mesh.prim_uv_indices = list(zip(pe, pe, pe, pe))
 
     # Section E — per-corner attribute records (UVs + tag bytes). On disk:
     #   +0x00 : u16 count (FUN_0022b520 returns this as the first short).
@@ -187,34 +291,24 @@ def parse_psm2(buf: bytes) -> PSM2Mesh:
     #   byte[10..11]: flags.
     # The runtime widens each row to 16 bytes by zero-padding (see the
     # loader's "for cols 6..7 zero" branch). We only need the original 12.
-    if offs['E']:
-        base = offs['E']
-        cnt = _u16(buf, base)
-        if cnt >= 0x8000:
-            cnt = 0
-        p = base + 2
-        for _ in range(cnt):
-            if p + 12 > len(buf):
-                break
-            mesh.uv_records.append(bytes(buf[p:p + 12]))
-            p += 12
+    uv = col.uv
+    mesh.uv_records = [uv[i:i + 12] for i in range(0, len(uv), 12)]
+
+    # Sections A + J — draw-group slices of Section C. A: s16 count, one
+    # reserved short, then 6 dwords per record. J: s16 count, then 13
+    # shorts per record, short 0 = A index (FUN_0022b5a8).
+    sl = col.a_slices
+    a_slices = list(zip(sl[0::2], sl[1::2]))
+    na = len(a_slices)
+    mesh.j_slices = [a_slices[a] if 0 <= a < na else (-1, 0) for a in col.j_a]
 
     return mesh
 
 
 def find_psm2_offsets(buf: bytes) -> List[int]:
     """Locate every PSM2 magic in `buf` (whole-file or embedded)."""
-    out: List[int] = []
-    pos = 0
-    needle = MAGIC_PSM2.to_bytes(4, 'little')
-    while True:
-        i = buf.find(needle, pos)
-        if i == -1:
-            break
-        if _u32(buf, i) == MAGIC_PSM2:
-            out.append(i)
-        pos = i + 1
-    return out
+    from .bytescan import find_all
+    return find_all(buf, "PSM2")
 
 
 def write_obj(mesh: PSM2Mesh, path: str, name: str = "mesh") -> Tuple[int, int]:
@@ -322,5 +416,4 @@ def main(argv=None) -> int:
 
 
 if __name__ == '__main__':
-    import sys
     raise SystemExit(main(sys.argv[1:]))
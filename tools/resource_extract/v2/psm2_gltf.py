@@ -58,13 +58,16 @@ from __future__ import annotations
 import argparse
 import json
 import os
-import struct
 import sys
+from dataclasses import replace
 from typing import Dict, List, Optional, Tuple
 
+from . import ktx2, mesh_lod, mesh_opt, tex_atlas
+from .build_graph import BuildState, code_version
+from .glb import GlbBuilder, PositionGrid, pack_f32, pack_index
 from .psm2 import MAGIC_PSM2, PSM2Mesh, parse_psm2, _u32
 from .psc3_gltf import (_bundle_pngs, _preferred_png, _authoritative_png,
-                        _adjacency_pngs)
+                        _adjacency_pngs, texture_inputs)
 
 
 # UV scale: each component is an unsigned byte where 0..255 maps to
@@ -100,24 +103,15 @@ class _BinBuf:
 
 
 def _f32_vec3(seq: List[Tuple[float, float, float]]) -> bytes:
-    out = bytearray()
-    for x, y, z in seq:
-        out += struct.pack('<fff', x, y, z)
-    return bytes(out)
+    return pack_f32(seq)
 
 
 def _f32_vec2(seq: List[Tuple[float, float]]) -> bytes:
-    out = bytearray()
-    for u, v in seq:
-        out += struct.pack('<ff', u, v)
-    return bytes(out)
+    return pack_f32(seq)
 
 
 def _u32_idx(seq: List[int]) -> bytes:
-    out = bytearray()
-    for i in seq:
-        out += struct.pack('<I', i)
-    return bytes(out)
+    return pack_index(seq, wide=True)[0]
 
 
 def _bbox(seq: List[Tuple[float, float, float]]):
@@ -233,7 +227,7 @@ def _prim_tex_page(mesh: PSM2Mesh, prim_idx: int) -> int:
 # Triangle expansion
 # ---------------------------------------------------------------------------
 
-def _build_corners(mesh: PSM2Mesh) -> Tuple[
+def _build_corners(mesh: PSM2Mesh, corner_prims: Optional[List[int]] = None) -> Tuple[
         List[Tuple[float, float, float]],   # positions
         List[Tuple[float, float, float]],   # normals
         List[Tuple[float, float]],          # uvs
@@ -257,6 +251,8 @@ def _build_corners(mesh: PSM2Mesh) -> Tuple[
         else:
             nx, ny, nz = (0.0, 0.0, 1.0)
         u, v = _corner_uv(mesh, prim_i, corner)
+        if corner_prims is not None:
+            corner_prims.append(prim_i)
         # Z-up -> Y-up: (x, y, z) -> (x, z, -y)
         positions.append((x, z, -y))
         normals.append((nx, nz, -ny))
@@ -299,30 +295,145 @@ def _build_corners(mesh: PSM2Mesh) -> Tuple[
     return positions, normals, uvs, groups
 
 
+def _prim_clusters(mesh: PSM2Mesh) -> List[int]:
+    """Per primitive: the first J record whose C slice holds all its
+    indices (FUN_00211230 draws per A/J record), else -1."""
+    owners: Dict[int, List[int]] = {}
+    for j, (start, count) in enumerate(mesh.j_slices):
+        if start >= 0:
+            for c in range(start, start + count):
+                owners.setdefault(c, []).append(j)
+    out = []
+    for prim in mesh.primitives:
+        for j in owners.get(prim[0], ()):
+            start, count = mesh.j_slices[j]
+            if all(start <= c < start + count for c in prim):
+                out.append(j)
+                break
+        else:
+            out.append(-1)
+    return out
+
+
+def _lod_chains(positions, clusters: List[int], groups: Dict[int, List[int]],
+                levels: int, locked: Optional[set] = None
+                ) -> Dict[int, List[Dict[int, List[int]]]]:
+    """J group -> [page groups per LOD level], finest first.
+
+    Positions shared by two J groups are locked (on top of ``locked``) so
+    the independently simplified groups keep meeting edge to edge.
+    """
+    per_cluster: Dict[int, Dict[int, List[int]]] = {}
+    for page in sorted(groups):
+        idx_list = groups[page]
+        for t in range(0, len(idx_list), 3):
+            per_cluster.setdefault(clusters[idx_list[t]], {}).setdefault(page, []).extend(
+                idx_list[t:t + 3])
+    owners: Dict[Tuple[float, float, float], int] = {}
+    locked = set(locked or ())
+    for c, pages in per_cluster.items():
+        for idx_list in pages.values():
+            for i in idx_list:
+                if owners.setdefault(positions[i], c) != c:
+                    locked.add(positions[i])
+    chains = {}
+    for c, pages in sorted(per_cluster.items()):
+        chain = mesh_lod.simplify_levels(positions, pages, levels, locked=locked)
+        chains[c] = chain[:1] + [
+            {page: mesh_opt.tipsify(idx, len(positions)) for page, idx in lvl.items()}
+            for lvl in chain[1:]]
+    return chains
+
+
+# Screen coverage below which the next coarser level takes over (MSFT_lod).
+LOD_COVERAGE = (0.25, 0.08, 0.02, 0.005)
+
+
+# Group key for the primitives merged into the texture atlas; above every
+# real page id (byte 8 of a section-E record, see _corner_tex_page).
+ATLAS_PAGE = 0x100
+
+
+def _atlas_groups(groups: Dict[int, List[int]], uvs: List[Tuple[float, float]],
+                  page_to_png, bundle_dir: str):
+    """Pack the groups' page PNGs into one atlas and merge those groups.
+
+    Corners are per primitive (``_build_corners``), so each UV belongs to
+    exactly one page and is remapped in place. Pages whose pixels can't be
+    loaded keep their own group and PNG.
+    """
+    pages = [p for p in sorted(groups) if p >= 0 and groups[p] and page_to_png(p)]
+    atlas, _missing = tex_atlas.build_from_files(
+        [(p, os.path.join(bundle_dir, page_to_png(p))) for p in pages])
+    if atlas is None:
+        return None, groups, uvs
+    uvs = list(uvs)
+    merged: List[int] = []
+    for page in sorted(atlas.cells):
+        idx_list = groups.pop(page)
+        for i in set(idx_list):
+            uvs[i] = atlas.uv(page, *uvs[i])
+        merged.extend(idx_list)
+    groups[ATLAS_PAGE] = merged
+    return atlas, groups, uvs
+
+
 # ---------------------------------------------------------------------------
 # glTF assembly
 # ---------------------------------------------------------------------------
 
 def write_gltf(mesh: PSM2Mesh, gltf_path: str, name: str,
                bundle_dir: Optional[str] = None,
-               png_override: Optional[str] = None) -> dict:
+               png_override: Optional[str] = None,
+               glb: bool = False,
+               optimize: bool = True,
+               atlas: bool = False,
+               ktx2_format: Optional[str] = None,
+               lod: int = 0,
+               label: Optional[str] = None,
+               embed_images: bool = True,
+               lod_locked: Optional[set] = None) -> dict:
+    """Write ``gltf_path`` (+ .bin + PNG copies), or with ``glb`` a single
+    self-contained .glb with quantized vertices (see glb.py).
+
+    ``optimize`` welds duplicate corners and reorders triangles/vertices
+    for cache locality first (mesh_opt.py). ``atlas`` packs the texture
+    pages into ``<name>_atlas.png`` and draws them as one primitive
+    (tex_atlas.py); ``ktx2_format`` also writes ``<name>_atlas.ktx2``.
+
+    ``lod`` adds up to that many simplified levels per J-record group
+    (mesh_lod.py). Each group becomes a node whose coarser meshes hang
+    off it as an MSFT_lod chain; all levels share one vertex stream.
+
+    ``name`` is the PSM2's bundle entry (texture adjacency); ``label``
+    (default ``name``) names the meshes, nodes and atlas files. With
+    ``embed_images`` off a .glb references its PNGs by URI like a .gltf,
+    so split outputs can share one copy. ``lod_locked`` positions (glTF
+    space) never move during simplification.
+    """
+    label = label or name
     binbuf = _BinBuf()
+    builder = GlbBuilder() if glb else None
     bin_path = os.path.splitext(gltf_path)[0] + ".bin"
     bin_uri = os.path.basename(bin_path)
 
-    positions, normals, uvs, groups = _build_corners(mesh)
+    corner_prims: Optional[List[int]] = [] if lod > 0 else None
+    positions, normals, uvs, groups = _build_corners(mesh, corner_prims)
     if not positions:
         gltf: dict = {
             "asset": {"version": "2.0", "generator": "psm2_gltf.py"},
             "scene": 0,
             "scenes": [{"nodes": []}],
         }
-        with open(gltf_path, 'w', encoding='utf-8') as fg:
-            json.dump(gltf, fg, indent=2)
+        if builder is not None:
+            builder.write(gltf_path, gltf)
+        else:
+            with open(gltf_path, 'w', encoding='utf-8') as fg:
+                json.dump(gltf, fg, indent=2)
         return {
             'positions': 0, 'indices': 0, 'bin_bytes': 0,
             'gltf_path': gltf_path, 'bin_path': None,
-            'preferred_png': None, 'pngs': [],
+            'preferred_png': None, 'pngs': [], 'outputs': [gltf_path],
         }
 
     # ---- Texture page resolution (one PNG per group) ------------------
@@ -341,29 +452,66 @@ def write_gltf(mesh: PSM2Mesh, gltf_path: str, name: str,
             return adjacency_list[page] or None
         return None
 
+    # ---- Atlas (before welding: UVs are remapped per page) ------------
+    tex_atlas_img = None
+    atlas_png = f"{label}_atlas.png"
+    atlas_ktx2 = None
+    # Files written besides the .gltf/.glb and .bin (build_graph outputs).
+    side_files: List[str] = []
+    if atlas and not forced_png and bundle_dir:
+        tex_atlas_img, groups, uvs = _atlas_groups(groups, uvs, page_to_png, bundle_dir)
+    if tex_atlas_img is not None and ktx2_format:
+        atlas_ktx2 = f"{label}_atlas.ktx2"
+        os.makedirs(os.path.dirname(os.path.abspath(gltf_path)), exist_ok=True)
+        with open(os.path.join(os.path.dirname(gltf_path), atlas_ktx2), 'wb') as fk:
+            fk.write(tex_atlas_img.ktx2(ktx2_format))
+        side_files.append(os.path.join(os.path.dirname(gltf_path), atlas_ktx2))
+
+    # The J group rides along as a fourth vertex stream so welding never
+    # merges corners of different groups.
+    streams = [positions, normals, uvs]
+    if corner_prims is not None:
+        prim_cluster = _prim_clusters(mesh)
+        streams.append([prim_cluster[i] for i in corner_prims])
+    opt_stats = None
+    if optimize:
+        streams, groups, opt_stats = mesh_opt.optimize(streams, groups)
+    elif lod > 0:
+        streams, groups = mesh_opt.weld(streams, groups)
+    positions, normals, uvs = streams[:3]
+    lod_chains = (_lod_chains(positions, streams[3], groups, lod, lod_locked)
+                  if lod > 0 else None)
+
     # ---- Vertex attribute buffer views --------------------------------
-    pos_off = binbuf.append(_f32_vec3(positions))
-    nrm_off = binbuf.append(_f32_vec3(normals))
-    uv_off = binbuf.append(_f32_vec2(uvs))
-
-    buffer_views: List[dict] = [
-        {"buffer": 0, "byteOffset": pos_off, "byteLength": len(positions) * 12,
-         "target": 34962},
-        {"buffer": 0, "byteOffset": nrm_off, "byteLength": len(normals) * 12,
-         "target": 34962},
-        {"buffer": 0, "byteOffset": uv_off, "byteLength": len(uvs) * 8,
-         "target": 34962},
-    ]
-
-    mn, mx = _bbox(positions)
-    accessors: List[dict] = [
-        {"bufferView": 0, "componentType": 5126, "count": len(positions),
-         "type": "VEC3", "min": mn, "max": mx},
-        {"bufferView": 1, "componentType": 5126, "count": len(normals),
-         "type": "VEC3"},
-        {"bufferView": 2, "componentType": 5126, "count": len(uvs),
-         "type": "VEC2"},
-    ]
+    buffer_views: List[dict] = []
+    accessors: List[dict] = []
+    if builder is not None:
+        grid = PositionGrid(positions)
+        attributes = builder.add_vertex_stream(grid, positions, normals, uvs)
+    else:
+        pos_off = binbuf.append(_f32_vec3(positions))
+        nrm_off = binbuf.append(_f32_vec3(normals))
+        uv_off = binbuf.append(_f32_vec2(uvs))
+
+        buffer_views = [
+            {"buffer": 0, "byteOffset": pos_off, "byteLength": len(positions) * 12,
+             "target": 34962},
+            {"buffer": 0, "byteOffset": nrm_off, "byteLength": len(normals) * 12,
+             "target": 34962},
+            {"buffer": 0, "byteOffset": uv_off, "byteLength": len(uvs) * 8,
+             "target": 34962},
+        ]
+
+        mn, mx = _bbox(positions)
+        accessors = [
+            {"bufferView": 0, "componentType": 5126, "count": len(positions),
+             "type": "VEC3", "min": mn, "max": mx},
+            {"bufferView": 1, "componentType": 5126, "count": len(normals),
+             "type": "VEC3"},
+            {"bufferView": 2, "componentType": 5126, "count": len(uvs),
+             "type": "VEC2"},
+        ]
+        attributes = {"POSITION": 0, "NORMAL": 1, "TEXCOORD_0": 2}
 
     # ---- Per-group materials/textures/images --------------------------
     materials: List[dict] = []
@@ -387,23 +535,45 @@ def write_gltf(mesh: PSM2Mesh, gltf_path: str, name: str,
             })
             return mat_idx
         if png not in png_to_image_idx:
+            img_i = len(images)
+            if page == ATLAS_PAGE:
+                # Generated here rather than copied from the bundle.
+                data = tex_atlas_img.png()
+                if builder is not None and embed_images:
+                    images.append(builder.add_image_data(data, png))
+                else:
+                    with open(os.path.join(os.path.dirname(gltf_path), png), 'wb') as fo:
+                        fo.write(data)
+                    side_files.append(os.path.join(os.path.dirname(gltf_path), png))
+            elif builder is not None and embed_images:
+                # GLB: embed the PNG in the BIN chunk.
+                images.append(builder.add_image(os.path.join(bundle_dir or "", png), png))
             # Copy the PNG next to the .gltf so the URI resolves.
-            if bundle_dir:
+            elif bundle_dir:
                 src_png = os.path.join(bundle_dir, png)
                 dst_png = os.path.join(os.path.dirname(gltf_path), png)
                 try:
                     if os.path.abspath(src_png) != os.path.abspath(dst_png):
                         with open(src_png, 'rb') as fi, open(dst_png, 'wb') as fo:
                             fo.write(fi.read())
+                    side_files.append(dst_png)
                 except OSError:
                     pass
-            img_i = len(images)
-            images.append({"uri": png, "name": png})
+            if builder is None or not embed_images:
+                images.append({"uri": png, "name": png})
             if not samplers:
                 samplers.append({"magFilter": 9729, "minFilter": 9987,
                                  "wrapS": 10497, "wrapT": 10497})
             tex_i = len(textures)
-            textures.append({"source": img_i, "sampler": 0})
+            texture = {"source": img_i, "sampler": 0}
+            if page == ATLAS_PAGE:
+                # Pages sit inside gutters; nothing may wrap across the atlas.
+                texture["sampler"] = len(samplers)
+                samplers.append({"magFilter": 9729, "minFilter": 9987,
+                                 "wrapS": 33071, "wrapT": 33071})
+                if atlas_ktx2:
+                    texture["extras"] = {"ktx2": atlas_ktx2, "ktx2_format": ktx2_format}
+            textures.append(texture)
             png_to_image_idx[png] = tex_i
             bound_pngs.append(png)
         tex_i = png_to_image_idx[png]
@@ -420,32 +590,77 @@ def write_gltf(mesh: PSM2Mesh, gltf_path: str, name: str,
         })
         return mat_idx
 
-    primitives_json: List[dict] = []
+    page_material: Dict[int, int] = {}
     total_indices = 0
-    for page in sorted(groups.keys()):
-        idx_list = groups[page]
-        if not idx_list:
-            continue
-        idx_off = binbuf.append(_u32_idx(idx_list))
-        bv_i = len(buffer_views)
-        buffer_views.append({
-            "buffer": 0, "byteOffset": idx_off,
-            "byteLength": len(idx_list) * 4, "target": 34963,
-        })
-        acc_i = len(accessors)
-        accessors.append({
-            "bufferView": bv_i, "componentType": 5125,
-            "count": len(idx_list), "type": "SCALAR",
-        })
-        png = page_to_png(page)
-        mat_idx = get_or_add_material(png, page)
-        primitives_json.append({
-            "attributes": {"POSITION": 0, "NORMAL": 1, "TEXCOORD_0": 2},
+
+    def emit_primitives(page_groups: Dict[int, List[int]]) -> List[dict]:
+        nonlocal total_indices
+        prims: List[dict] = []
+        for page in sorted(page_groups.keys()):
+            idx_list = page_groups[page]
+            if idx_list:
+                prims.append(emit_primitive(page, idx_list))
+                total_indices += len(idx_list)
+        return prims
+
+    def emit_primitive(page: int, idx_list: List[int]) -> dict:
+        if builder is not None:
+            acc_i = builder.add_indices(idx_list)
+        else:
+            idx_off = binbuf.append(_u32_idx(idx_list))
+            bv_i = len(buffer_views)
+            buffer_views.append({
+                "buffer": 0, "byteOffset": idx_off,
+                "byteLength": len(idx_list) * 4, "target": 34963,
+            })
+            acc_i = len(accessors)
+            accessors.append({
+                "bufferView": bv_i, "componentType": 5125,
+                "count": len(idx_list), "type": "SCALAR",
+            })
+        if page not in page_material:
+            png = atlas_png if page == ATLAS_PAGE else page_to_png(page)
+            page_material[page] = get_or_add_material(png, page)
+        return {
+            "attributes": dict(attributes),
             "indices": acc_i,
-            "material": mat_idx,
+            "material": page_material[page],
             "mode": 4,  # TRIANGLES
-        })
-        total_indices += len(idx_list)
+        }
+
+    node_xform = grid.node_transform() if builder is not None else {}
+    meshes: List[dict] = []
+    nodes: List[dict] = []
+    if lod_chains is None:
+        primitives_json = emit_primitives(groups)
+        meshes.append({"name": label, "primitives": primitives_json})
+        nodes.append({"mesh": 0, "name": label, **node_xform})
+        scene_nodes = [0]
+    else:
+        # One node per J group; its coarser levels are extra nodes that
+        # only the MSFT_lod chain references (not part of the scene).
+        primitives_json = []
+        scene_nodes = []
+        for c, chain in lod_chains.items():
+            group_label = f"{label}_j{c}" if c >= 0 else f"{label}_loose"
+            ids = []
+            for level, page_groups in enumerate(chain):
+                prims = emit_primitives(page_groups)
+                if not prims:
+                    continue
+                primitives_json.extend(prims)
+                meshes.append({"name": f"{group_label}_lod{level}", "primitives": prims})
+                ids.append(len(nodes))
+                nodes.append({"mesh": len(meshes) - 1, "name": f"{group_label}_lod{level}",
+                              **node_xform})
+            if not ids:
+                continue
+            scene_nodes.append(ids[0])
+            if len(ids) > 1:
+                nodes[ids[0]]["extensions"] = {"MSFT_lod": {"ids": ids[1:]}}
+                # Minimum coverage per level, finest first; the last never culls.
+                nodes[ids[0]]["extras"] = {
+                    "MSFT_screencoverage": list(LOD_COVERAGE[:len(ids) - 1]) + [0.0]}
 
     if not primitives_json:
         # Fall back: no groups produced any geometry.
@@ -459,21 +674,36 @@ def write_gltf(mesh: PSM2Mesh, gltf_path: str, name: str,
             "doubleSided": True,
         })
 
-    bin_blob = binbuf.bytes()
-    with open(bin_path, 'wb') as fb:
-        fb.write(bin_blob)
-
-    gltf = {
-        "asset": {"version": "2.0", "generator": "psm2_gltf.py"},
-        "scene": 0,
-        "scenes": [{"nodes": [0]}],
-        "nodes": [{"mesh": 0, "name": name}],
-        "meshes": [{"name": name, "primitives": primitives_json}],
-        "buffers": [{"uri": bin_uri, "byteLength": len(bin_blob)}],
-        "bufferViews": buffer_views,
-        "accessors": accessors,
-        "materials": materials,
-    }
+    if builder is not None:
+        gltf = {
+            "asset": {"version": "2.0", "generator": "psm2_gltf.py"},
+            "scene": 0,
+            "scenes": [{"nodes": scene_nodes}],
+            "nodes": nodes,
+            "meshes": meshes,
+            "materials": materials,
+        }
+        builder.finish(gltf)
+        bin_bytes = builder.length
+    else:
+        bin_blob = binbuf.bytes()
+        bin_bytes = len(bin_blob)
+        with open(bin_path, 'wb') as fb:
+            fb.write(bin_blob)
+
+        gltf = {
+            "asset": {"version": "2.0", "generator": "psm2_gltf.py"},
+            "scene": 0,
+            "scenes": [{"nodes": scene_nodes}],
+            "nodes": nodes,
+            "meshes": meshes,
+            "buffers": [{"uri": bin_uri, "byteLength": len(bin_blob)}],
+            "bufferViews": buffer_views,
+            "accessors": accessors,
+            "materials": materials,
+        }
+    if any("extensions" in n for n in nodes):
+        gltf.setdefault("extensionsUsed", []).append("MSFT_lod")
     if textures:
         gltf["textures"] = textures
     if images:
@@ -481,27 +711,162 @@ def write_gltf(mesh: PSM2Mesh, gltf_path: str, name: str,
     if samplers and textures:
         gltf["samplers"] = samplers
 
-    with open(gltf_path, 'w', encoding='utf-8') as fg:
-        json.dump(gltf, fg, indent=2)
+    if builder is not None:
+        builder.write(gltf_path, gltf)
+    else:
+        with open(gltf_path, 'w', encoding='utf-8') as fg:
+            json.dump(gltf, fg, indent=2)
 
     return {
         'positions': len(positions),
         'indices': total_indices,
-        'bin_bytes': len(bin_blob),
+        'bin_bytes': bin_bytes,
         'gltf_path': gltf_path,
-        'bin_path': bin_path,
+        'bin_path': None if builder is not None else bin_path,
         'preferred_png': bound_pngs[0] if bound_pngs else None,
         'pngs': bound_pngs,
+        'outputs': [gltf_path] + ([bin_path] if builder is None else []) + side_files,
         'pages': sorted(groups.keys()),
+        'optimize': opt_stats,
+        'atlas': tex_atlas_img.layout() if tex_atlas_img is not None else None,
+        'lod': ({c: [sum(len(i) for i in lvl.values()) // 3 for lvl in chain]
+                 for c, chain in lod_chains.items()} if lod_chains is not None else None),
     }
 
 
+# ---------------------------------------------------------------------------
+# Spatial chunks
+# ---------------------------------------------------------------------------
+
+def _chunk_grid(mesh: PSM2Mesh, chunks: int):
+    """Bucket primitives into square XZ cells, ``chunks`` along the longer
+    axis. Returns (cell, (x0, z0), (nx, nz), {(ix, iz): [prim indices]}).
+
+    A primitive goes to the cell holding its centroid (glTF space:
+    X = x, Z = -y), so each one is written exactly once.
+    """
+    n_pos = len(mesh.positions)
+    cents: List[Tuple[int, float, float]] = []
+    for i, prim in enumerate(mesh.primitives):
+        if not all(0 <= ix < n_pos for ix in prim):
+            continue
+        corners = prim[:3] if prim[2] == prim[3] else prim
+        cx = sum(mesh.positions[ix][0] for ix in corners) / len(corners)
+        cz = -sum(mesh.positions[ix][1] for ix in corners) / len(corners)
+        cents.append((i, cx, cz))
+    if not cents:
+        return 1.0, (0.0, 0.0), (1, 1), {}
+    x0, x1 = min(c[1] for c in cents), max(c[1] for c in cents)
+    z0, z1 = min(c[2] for c in cents), max(c[2] for c in cents)
+    cell = max(x1 - x0, z1 - z0) / max(1, chunks) or 1.0
+    nx = max(1, min(chunks, int((x1 - x0) / cell) + 1))
+    nz = max(1, min(chunks, int((z1 - z0) / cell) + 1))
+    cells: Dict[Tuple[int, int], List[int]] = {}
+    for i, cx, cz in cents:
+        key = (min(nx - 1, int((cx - x0) / cell)), min(nz - 1, int((cz - z0) / cell)))
+        cells.setdefault(key, []).append(i)
+    return cell, (x0, z0), (nx, nz), cells
+
+
+def write_chunks(mesh: PSM2Mesh, dst_dir: str, name: str, chunks: int,
+                 glb: bool = False, lod: int = 0, **kwargs) -> dict:
+    """Split ``mesh`` into a ``_chunk_grid`` and write one glTF per cell.
+
+    Layout (relative to ``dst_dir``):
+
+        <name>.chunks.json             manifest (grid, per-chunk bounds)
+        <name>_chunks/cIX_IZ.glb       one file per non-empty cell
+        <name>_chunks/tex_*.png        page PNGs, shared by every chunk
+
+    Chunks reference the PNGs by URI even as .glb, so a page is stored and
+    fetched once however many chunks draw it. With ``lod``, positions on
+    cell borders are locked so neighbouring chunks keep meeting at every
+    level. ``kwargs`` go to ``write_gltf`` (one atlas per chunk with
+    ``atlas``).
+    """
+    cell, origin, grid, cells = _chunk_grid(mesh, chunks)
+    sub_dir = f"{name}_chunks"
+    os.makedirs(os.path.join(dst_dir, sub_dir), exist_ok=True)
+
+    border: set = set()
+    if lod > 0:
+        owner: Dict[int, Tuple[int, int]] = {}
+        for key, prims in cells.items():
+            for i in prims:
+                for ix in set(mesh.primitives[i]):
+                    if owner.setdefault(ix, key) != key:
+                        x, y, z = mesh.positions[ix]
+                        border.add((x, z, -y))
+
+    n_uv = len(mesh.prim_uv_indices)
+    entries: List[dict] = []
+    totals = {'positions': 0, 'indices': 0, 'bin_bytes': 0}
+    pngs: List[str] = []
+    outputs: List[str] = []
+    pages: set = set()
+    lo: List[float] = []
+    hi: List[float] = []
+    for (ix, iz), prims in sorted(cells.items(), key=lambda kv: (kv[0][1], kv[0][0])):
+        sub = replace(mesh,
+                      primitives=[mesh.primitives[i] for i in prims],
+                      prim_uv_indices=[mesh.prim_uv_indices[i] if i < n_uv
+                                       else (0xFFFF,) * 4 for i in prims])
+        rel = f"{sub_dir}/c{ix:02d}_{iz:02d}" + (".glb" if glb else ".gltf")
+        path = os.path.join(dst_dir, rel)
+        stats = write_gltf(sub, path, name, glb=glb, lod=lod,
+                           label=f"{name}_c{ix:02d}_{iz:02d}",
+                           embed_images=False, lod_locked=border, **kwargs)
+        if not stats['indices']:
+            continue
+        pts = [(x, z, -y) for p in sub.primitives for x, y, z in
+               (mesh.positions[i] for i in set(p))]
+        mn, mx = _bbox(pts)
+        lo = [min(a, b) for a, b in zip(lo, mn)] if lo else mn
+        hi = [max(a, b) for a, b in zip(hi, mx)] if hi else mx
+        size = os.path.getsize(path)
+        if stats.get('bin_path'):
+            size += os.path.getsize(stats['bin_path'])
+        tris = (sum(chain[0] for chain in stats['lod'].values()) if stats.get('lod')
+                else stats['indices'] // 3)
+        entries.append({"file": rel, "ix": ix, "iz": iz, "min": mn, "max": mx,
+                        "triangles": tris, "bytes": size})
+        for k in totals:
+            totals[k] += stats[k]
+        pngs.extend(p for p in stats['pngs'] if p not in pngs)
+        outputs.extend(o for o in stats['outputs'] if o not in outputs)
+        pages.update(stats.get('pages') or ())
+
+    manifest = {
+        "version": 1,
+        "name": name,
+        "format": "glb" if glb else "gltf",
+        "cell": cell,
+        "origin": list(origin),
+        "grid": list(grid),
+        "bounds": {"min": lo or [0.0] * 3, "max": hi or [0.0] * 3},
+        "chunks": entries,
+    }
+    manifest_path = os.path.join(dst_dir, f"{name}.chunks.json")
+    with open(manifest_path, 'w', encoding='utf-8') as fm:
+        json.dump(manifest, fm, indent=1)
+    return {**totals, 'gltf_path': manifest_path, 'bin_path': None,
+            'preferred_png': pngs[0] if pngs else None, 'pngs': pngs,
+            'outputs': [manifest_path] + outputs,
+            'pages': sorted(pages), 'chunks': len(entries)}
+
+
 # ---------------------------------------------------------------------------
 # CLI
 # ---------------------------------------------------------------------------
 
 def export_file(src_path: str, dst_dir: str, verbose: bool = False,
-                png_override: Optional[str] = None) -> Optional[dict]:
+                png_override: Optional[str] = None,
+                glb: bool = False,
+                optimize: bool = True,
+                atlas: bool = False,
+                ktx2_format: Optional[str] = None,
+                lod: int = 0,
+                chunks: int = 0) -> Optional[dict]:
     data = open(src_path, 'rb').read()
     if len(data) < 4 or _u32(data, 0) != MAGIC_PSM2:
         if verbose:
@@ -515,15 +880,46 @@ def export_file(src_path: str, dst_dir: str, verbose: bool = False,
         if verbose:
             print(f"[err]  {src_path}: {e}")
         return None
-    gltf_path = os.path.join(dst_dir, base + ".gltf")
+    gltf_path = os.path.join(dst_dir, base + (".glb" if glb else ".gltf"))
     bundle_dir = os.path.dirname(os.path.abspath(src_path))
-    stats = write_gltf(mesh, gltf_path, name=base,
-                       bundle_dir=bundle_dir,
-                       png_override=png_override)
+    if chunks > 0:
+        stats = write_chunks(mesh, dst_dir, base, chunks,
+                             bundle_dir=bundle_dir,
+                             png_override=png_override,
+                             glb=glb,
+                             optimize=optimize,
+                             atlas=atlas,
+                             ktx2_format=ktx2_format,
+                             lod=lod)
+        gltf_path = stats['gltf_path']
+    else:
+        stats = write_gltf(mesh, gltf_path, name=base,
+                           bundle_dir=bundle_dir,
+                           png_override=png_override,
+                           glb=glb,
+                           optimize=optimize,
+                           atlas=atlas,
+                           ktx2_format=ktx2_format,
+                           lod=lod)
     if verbose:
         print(f"[ok]   {gltf_path}  verts={stats['positions']}  "
               f"idx={stats['indices']}  bin={stats['bin_bytes']}B  "
               f"pages={stats.get('pages')}  pngs={stats.get('pngs')}")
+        if stats.get('chunks'):
+            print(f"       {stats['chunks']} chunks")
+        if stats.get('optimize'):
+            o = stats['optimize']
+            print(f"       weld {o['vertices_in']} -> {o['vertices_out']} verts  "
+                  f"acmr {o['acmr_in']} -> {o['acmr_out']}")
+        if stats.get('atlas'):
+            a = stats['atlas']
+            print(f"       atlas {len(a['cells'])} pages  {a['width']}x{a['height']}")
+        if stats.get('lod'):
+            tris = [0] * max(len(v) for v in stats['lod'].values())
+            for chain in stats['lod'].values():
+                for k, n in enumerate(chain):
+                    tris[k] += n
+            print(f"       lod {len(stats['lod'])} groups  tris/level {tris}")
     return stats
 
 
@@ -536,6 +932,28 @@ def main(argv=None) -> int:
     ap.add_argument('--png', default=None,
                     help="Override the auto-picked BMPA PNG basename "
                          "(must exist in the same directory as --src).")
+    ap.add_argument('--glb', action='store_true',
+                    help="Write one self-contained .glb per input (quantized "
+                         "vertices, embedded PNGs) instead of .gltf + .bin + PNGs.")
+    ap.add_argument('--no-optimize', action='store_true',
+                    help="Keep one vertex per corner in source order (skip "
+                         "welding and cache reordering).")
+    ap.add_argument('--atlas', action='store_true',
+                    help="Pack the scene's texture pages into one <name>_atlas.png "
+                         "and draw them as a single primitive.")
+    ap.add_argument('--ktx2', choices=ktx2.FORMATS, default=None,
+                    help="With --atlas, also write <name>_atlas.ktx2 (mipmapped, "
+                         "BC1/BC3 or RGBA8) next to the output.")
+    ap.add_argument('--lod', type=int, default=0, metavar='N',
+                    help="Add up to N simplified levels per J-record group "
+                         "(MSFT_lod chain, ~half the triangles per level).")
+    ap.add_argument('--chunks', type=int, default=0, metavar='N',
+                    help="Split each map into square XZ cells, N along the longer "
+                         "side: <name>_chunks/cIX_IZ.* plus a <name>.chunks.json "
+                         "manifest the map viewer streams from.")
+    ap.add_argument('--incremental', action='store_true',
+                    help="Skip inputs whose PSM2 bytes, textures, options and "
+                         "exporter code match <dst>/_build.json")
     args = ap.parse_args(argv)
 
     inputs: List[str] = []
@@ -549,12 +967,34 @@ def main(argv=None) -> int:
     if args.limit is not None:
         inputs = inputs[:args.limit]
 
+    state = BuildState(args.dst, enabled=args.incremental)
+    opts = json.dumps({'png': args.png, 'glb': args.glb, 'optimize': not args.no_optimize,
+                       'atlas': args.atlas, 'ktx2': args.ktx2, 'lod': args.lod,
+                       'chunks': args.chunks}, sort_keys=True)
     ok = 0
     for p in inputs:
-        if export_file(p, args.dst, verbose=args.verbose,
-                       png_override=args.png):
+        key = os.path.basename(p)
+        target = None
+        if state.enabled:
+            target = {'src': state.file_digest(p), 'code': code_version('psm2_gltf'),
+                      'opts': opts,
+                      **texture_inputs(state, os.path.dirname(os.path.abspath(p)))}
+            if state.check(key, target) is not None:
+                ok += 1
+                continue
+        stats = export_file(p, args.dst, verbose=args.verbose,
+                            png_override=args.png, glb=args.glb,
+                            optimize=not args.no_optimize,
+                            atlas=args.atlas, ktx2_format=args.ktx2,
+                            lod=args.lod, chunks=args.chunks)
+        if stats:
             ok += 1
-    print(f"Wrote glTF for {ok}/{len(inputs)} PSM2 file(s) into {args.dst}")
+            state.record(key, target, stats['outputs'])
+        else:
+            state.forget(key)
+    state.save()
+    print(f"Wrote glTF for {ok}/{len(inputs)} PSM2 file(s) into {args.dst}"
+          + (f" ({state.summary()})" if args.incremental else ""))
     return 0
 
 
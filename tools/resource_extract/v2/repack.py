@@ -0,0 +1,339 @@
+"""Write replaced entries back into a flat-TOC BIN or the MCB0/MCB1 pair,
+rewriting as little of the archive as possible.
+
+Flat TOC (bin_toc.py / archive.py): u32 count, then one u32 per entry,
+low 17 bits = size in 32-bit words, top 15 bits = 2048-byte sector.
+MCB (mcb.py): MCB0 is 15 x 100 (u32 byte_offset, u32 byte_size) slots
+into MCB1, whose bundles are linked lists of (u32 id, u32 size, payload)
+records ending at id 0xFFFFFFFF (mcb_bundle.py).
+
+An entry's *extent* runs from its start to the next entry's start (or to
+the end of the file). A replacement is written:
+
+  in place   when it fits the extent and no other entry shares its start;
+             only the sectors it covers (plus the zeroed remainder of the
+             old payload) are written
+  appended   otherwise, at the next sector boundary past the end of file;
+             the old bytes become slack in the entry before them, which a
+             later replacement of that entry can grow into
+
+and then only the changed TOC words / MCB0 slots are patched. The last
+entry of a file always fits: it just grows the file.
+
+`--out` writes to a copy instead of editing the archive. The copy is a
+reflink (FICLONE) where the filesystem supports it, else an in-kernel
+`os.copy_file_range`, so the ~295 MB MCB1 is never read through Python.
+For quick iteration make the copy once, then repack that copy in place.
+
+MCB replacements name a whole bundle (`s01_e011=bundle.bin`) or one
+record inside it (`s01_e011/0x10003=record.bin`, id = category<<16 |
+resource id, see mcb_bundle.CATEGORY_NAMES). Record payloads are
+substituted in the bundle and the bundle is then placed as above; an id
+the bundle doesn't have is appended before the terminator, as
+FUN_00222c50 does.
+
+`--encode` LZ-compresses the replacement files first (lz_encode.py), for
+decoded payloads such as an edited SCR chunk.
+"""
+from __future__ import annotations
+
+import argparse
+import os
+import re
+import shutil
+import struct
+import sys
+from dataclasses import dataclass, field
+from typing import Callable, Dict, List, Optional, Sequence, Tuple
+
+from .archive import SECTOR
+from .lz_encode import encode_many
+from .mcb import MCB0_SIZE, N_ENTRIES, N_SECTIONS
+from .mcb_bundle import iter_records
+
+TERMINATOR = struct.pack("<II", 0xFFFFFFFF, 0)
+MAX_WORDS = 0x1FFFF
+MAX_SECTOR = 0x7FFF
+_FICLONE = 0x40049409  # _IOW(0x94, 9, int)
+
+
+def _round_up(n: int, align: int) -> int:
+    return -(-n // align) * align
+
+
+# ---------------------------------------------------------------------------
+# Copying
+# ---------------------------------------------------------------------------
+
+def clone_file(src: str, dst: str) -> str:
+    """Copy `src` to `dst` without reading it through Python where possible.
+    Returns the method used: "reflink", "copy_file_range" or "copy"."""
+    with open(src, "rb") as fi, open(dst, "wb") as fo:
+        try:
+            import fcntl
+            fcntl.ioctl(fo.fileno(), _FICLONE, fi.fileno())
+            return "reflink"
+        except (ImportError, OSError):
+            pass
+        if hasattr(os, "copy_file_range"):
+            size = os.fstat(fi.fileno()).st_size
+            done = 0
+            try:
+                while done < size:
+                    n = os.copy_file_range(fi.fileno(), fo.fileno(), size - done)
+                    if n == 0:
+                        break
+                    done += n
+                if done == size:
+                    return "copy_file_range"
+            except OSError:
+                pass
+            fi.seek(0)
+            fo.seek(0)
+            fo.truncate()
+        shutil.copyfileobj(fi, fo, 1 << 20)
+    return "copy"
+
+
+# ---------------------------------------------------------------------------
+# Placement
+# ---------------------------------------------------------------------------
+
+@dataclass
+class RepackReport:
+    path: str
+    in_place: List[int] = field(default_factory=list)
+    appended: List[int] = field(default_factory=list)
+    bytes_written: int = 0
+    copied_by: Optional[str] = None
+
+    def summary(self) -> str:
+        s = (f"{self.path}: {len(self.in_place)} in place, {len(self.appended)} appended, "
+             f"{self.bytes_written:,} bytes written")
+        return s + (f" (copied by {self.copied_by})" if self.copied_by else "")
+
+
+def _extents(starts: Sequence[int]) -> Dict[int, Tuple[int, bool]]:
+    """start -> (room up to the next start, shared) for the non-empty
+    entries' starts. The last start's room is unbounded."""
+    counts: Dict[int, int] = {}
+    for s in starts:
+        counts[s] = counts.get(s, 0) + 1
+    order = sorted(counts)
+    out = {}
+    for a, b in zip(order, order[1:] + [None]):
+        out[a] = (b - a if b is not None else 1 << 62, counts[a] > 1)
+    return out
+
+
+def _place(f, slots: List[Tuple[int, int]], index: int, data: bytes,
+           file_size: int, align: int, report: RepackReport,
+           check_start: Callable[[int], None]) -> Tuple[int, int]:
+    """Write `data` for slot `index` of `slots` ((start, size) pairs, size 0 =
+    empty). Returns (start, new file size). `check_start` vets the chosen
+    start before anything is written; it raises to reject it."""
+    live = [s for s, n in slots if n]
+    ext = _extents(live)
+    start, old = slots[index]
+    room, shared = ext.get(start, (0, True)) if old else (0, True)
+    if len(data) <= room and not shared:
+        check_start(start)
+        # Cover the new payload's sectors and zero what is left of the old
+        # payload's, never past the next entry or (for the last) the file end.
+        end = max(min(start + _round_up(len(data), align), start + room),
+                  min(start + _round_up(old, align), start + room, file_size))
+        f.seek(start)
+        f.write(data + bytes(end - start - len(data)))
+        report.in_place.append(index)
+        report.bytes_written += end - start
+        return start, max(file_size, end)
+    start = _round_up(file_size, align)
+    check_start(start)
+    f.seek(file_size)
+    f.write(bytes(start - file_size) + data + bytes(_round_up(len(data), align) - len(data)))
+    report.appended.append(index)
+    report.bytes_written += start - file_size + _round_up(len(data), align)
+    return start, start + _round_up(len(data), align)
+
+
+def _prepare(path: str, out: Optional[str], report: RepackReport) -> str:
+    if out and os.path.abspath(out) != os.path.abspath(path):
+        report.copied_by = clone_file(path, out)
+        return out
+    return path
+
+
+# ---------------------------------------------------------------------------
+# Flat TOC
+# ---------------------------------------------------------------------------
+
+def _check_sector(index: int, start: int) -> None:
+    if start // SECTOR > MAX_SECTOR:
+        raise ValueError(f"entry {index}: sector {start // SECTOR:#x} exceeds the 15-bit field")
+
+
+def repack_flat(path: str, replacements: Dict[int, bytes],
+                out: Optional[str] = None) -> RepackReport:
+    """Put `replacements` (entry index -> packed payload) into a flat-TOC BIN."""
+    report = RepackReport(out or path)
+    target = _prepare(path, out, report)
+    with open(target, "r+b") as f:
+        (count,) = struct.unpack("<I", f.read(4))
+        words = list(struct.unpack(f"<{count}I", f.read(4 * count)))
+        f.seek(0, os.SEEK_END)
+        file_size = f.tell()
+        slots = [(((w >> 17) & MAX_SECTOR) * SECTOR, (w & MAX_WORDS) * 4) for w in words]
+        for index in sorted(replacements):
+            if not 0 <= index < count:
+                raise IndexError(f"{path}: no entry {index} (count {count})")
+            data = bytes(replacements[index])
+            data += bytes(-len(data) % 4)
+            if len(data) // 4 > MAX_WORDS:
+                raise ValueError(f"entry {index}: {len(data):,} bytes exceeds the 17-bit size field")
+            start, file_size = _place(f, slots, index, data, file_size, SECTOR, report,
+                                      lambda start: _check_sector(index, start))
+            slots[index] = (start, len(data))
+            word = (start // SECTOR) << 17 | len(data) // 4
+            f.seek(4 + 4 * index)
+            f.write(struct.pack("<I", word))
+            report.bytes_written += 4
+    return report
+
+
+# ---------------------------------------------------------------------------
+# MCB0 / MCB1
+# ---------------------------------------------------------------------------
+
+def bundle_with(blob, records: Dict[int, bytes]) -> bytes:
+    """Bundle bytes with the payloads of `records` (id -> payload) swapped
+    in; ids not in the bundle are appended before the terminator. A bundle
+    without one (an empty slot, or a list cut short) gets a terminator."""
+    out = bytearray()
+    todo = dict(records)
+    end = 0
+    for idv, _cat, _rid, off, payload in iter_records(blob):
+        end = off + 8 + len(payload)
+        payload = todo.pop(idv, payload)
+        out += struct.pack("<II", idv, len(payload)) + bytes(payload)
+    for idv, payload in todo.items():
+        out += struct.pack("<II", idv, len(payload)) + bytes(payload)
+    tail = bytes(blob[end:])
+    if tail[:4] != TERMINATOR[:4]:
+        out += TERMINATOR
+    # Terminator and anything after it, as they were.
+    return bytes(out) + tail
+
+
+def _check_offset(key: Tuple[int, int], start: int) -> None:
+    if start > 0xFFFFFFFF:
+        raise ValueError(f"s{key[0]:02d}_e{key[1]:03d}: offset {start:#x} exceeds u32")
+
+
+def repack_mcb(mcb0: str, mcb1: str, replacements: Dict[Tuple[int, int], bytes],
+               records: Optional[Dict[Tuple[int, int], Dict[int, bytes]]] = None,
+               out_dir: Optional[str] = None) -> Tuple[RepackReport, RepackReport]:
+    """Put whole-bundle `replacements` ((section, entry) -> bundle bytes) and
+    per-record `records` ((section, entry) -> {id: payload}) into MCB1 and
+    patch their MCB0 slots."""
+    records = records or {}
+    out0 = os.path.join(out_dir, os.path.basename(mcb0)) if out_dir else None
+    out1 = os.path.join(out_dir, os.path.basename(mcb1)) if out_dir else None
+    if out_dir:
+        os.makedirs(out_dir, exist_ok=True)
+    rep0, rep1 = RepackReport(out0 or mcb0), RepackReport(out1 or mcb1)
+    t0 = _prepare(mcb0, out0, rep0)
+    t1 = _prepare(mcb1, out1, rep1)
+    with open(t0, "r+b") as f0, open(t1, "r+b") as f1:
+        table = f0.read()
+        if len(table) != MCB0_SIZE:
+            raise ValueError(f"expected MCB0.BIN of {MCB0_SIZE} bytes, got {len(table)}")
+        slots = list(struct.iter_unpack("<II", table))
+        f1.seek(0, os.SEEK_END)
+        file_size = f1.tell()
+        for key in sorted(set(replacements) | set(records)):
+            s, e = key
+            if not (0 <= s < N_SECTIONS and 0 <= e < N_ENTRIES):
+                raise IndexError(f"no MCB slot s{s:02d}_e{e:03d}")
+            index = s * N_ENTRIES + e
+            blob = replacements.get(key)
+            if blob is None:
+                off, size = slots[index]
+                f1.seek(off)
+                blob = f1.read(size)
+            if key in records:
+                blob = bundle_with(blob, records[key])
+            start, file_size = _place(f1, slots, index, bytes(blob), file_size, SECTOR, rep1,
+                                      lambda start: _check_offset(key, start))
+            slots[index] = (start, len(blob))
+            f0.seek(8 * index)
+            f0.write(struct.pack("<II", start, len(blob)))
+            rep0.bytes_written += 8
+    return rep0, rep1
+
+
+# ---------------------------------------------------------------------------
+# CLI
+# ---------------------------------------------------------------------------
+
+_MCB_KEY = re.compile(r"s(\d+)_e(\d+)(?:/(0x[0-9a-fA-F]+|\d+))?$")
+
+
+def _read_specs(specs: Sequence[str], encode: bool, optimal: bool,
+                jobs: int) -> List[Tuple[str, bytes]]:
+    pairs = []
+    for spec in specs:
+        key, sep, path = spec.partition("=")
+        if not sep:
+            raise SystemExit(f"expected KEY=FILE, got {spec!r}")
+        with open(path, "rb") as f:
+            pairs.append((key, f.read()))
+    if encode:
+        packed = encode_many([d for _, d in pairs], optimal=optimal, jobs=jobs)
+        pairs = [(k, p) for (k, _), p in zip(pairs, packed)]
+    return pairs
+
+
+def main(argv: List[str] | None = None) -> int:
+    ap = argparse.ArgumentParser(description="Write replaced entries back into a BIN archive")
+    sub = ap.add_subparsers(dest="kind", required=True)
+    fl = sub.add_parser("flat", help="flat-TOC BIN (SCR / MAP / GRP / ...)")
+    fl.add_argument("archive")
+    fl.add_argument("entries", nargs="+", metavar="INDEX=FILE")
+    fl.add_argument("--out", default=None, help="write to this copy instead of editing ARCHIVE")
+    mc = sub.add_parser("mcb", help="MCB0.BIN + MCB1.BIN pair")
+    mc.add_argument("entries", nargs="+", metavar="sNN_eNNN[/ID]=FILE")
+    mc.add_argument("--mcb0", default="MCB0.BIN")
+    mc.add_argument("--mcb1", default="MCB1.BIN")
+    mc.add_argument("--out", default=None, help="write copies of both files into this directory")
+    for p in (fl, mc):
+        p.add_argument("--encode", action="store_true", help="LZ-compress the files first")
+        p.add_argument("--optimal", action="store_true", help="with --encode: optimal parse")
+        p.add_argument("--jobs", type=int, default=1, help="encode workers (0 = all cores)")
+    args = ap.parse_args(argv)
+
+    pairs = _read_specs(args.entries, args.encode, args.optimal, args.jobs)
+    if args.kind == "flat":
+        repl = {int(k, 0): d for k, d in pairs}
+        reports = [repack_flat(args.archive, repl, args.out)]
+    else:
+        bundles: Dict[Tuple[int, int], bytes] = {}
+        recs: Dict[Tuple[int, int], Dict[int, bytes]] = {}
+        for k, d in pairs:
+            m = _MCB_KEY.match(k)
+            if not m:
+                raise SystemExit(f"bad MCB key {k!r} (expected sNN_eNNN or sNN_eNNN/ID)")
+            slot = (int(m.group(1)), int(m.group(2)))
+            if m.group(3):
+                recs.setdefault(slot, {})[int(m.group(3), 0)] = d
+            else:
+                bundles[slot] = d
+        rep0, rep1 = repack_mcb(args.mcb0, args.mcb1, bundles, recs, args.out)
+        print(f"{rep0.path}: {rep0.bytes_written // 8} slots patched")
+        reports = [rep1]
+    for r in reports:
+        print(r.summary())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
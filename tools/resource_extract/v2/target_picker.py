@@ -28,9 +28,9 @@ import os
 import struct
 import sys
 from collections import Counter
-from typing import Iterator, List, Tuple
+from typing import List, Tuple
 
-from ..baseline.lz_decoder import decode_bytes as lz_decode
+from .decode_cache import decoder
 from . import mcb as mcb_mod
 from . import mcb_bundle
 
@@ -89,21 +89,11 @@ def simplicity_score(s: dict) -> float:
     return (s["size"] / 1000.0) + s["submeshes"] * 5 + s["subdraws"] * 1.5 + s["distinct_flags"] * 2
 
 
-def _mcb1_iter_bundles(mcb0_path: str, mcb1_path: str) -> Iterator[Tuple[str, bytes]]:
-    """Yield (bundle_name, bundle_bytes) for every non-empty section."""
-    sections = mcb_mod.load_mcb0(mcb0_path)
-    with open(mcb1_path, "rb") as fh:
-        for s_idx, section in enumerate(sections):
-            for e_idx, (off, size) in enumerate(section):
-                if size == 0:
-                    continue
-                fh.seek(off)
-                yield f"s{s_idx:02d}_e{e_idx:03d}", fh.read(size)
-
-
-def scan(mcb0_path: str, mcb1_path: str) -> List[dict]:
+def scan(mcb0_path: str, mcb1_path: str, cache_dir: str | None = None) -> List[dict]:
+    lz_decode = decoder(cache_dir)
     candidates: List[dict] = []
-    for bname, bbuf in _mcb1_iter_bundles(mcb0_path, mcb1_path):
+    for s_idx, e_idx, _off, bbuf in mcb_mod.iter_bundles(mcb0_path, mcb1_path):
+        bname = f"s{s_idx:02d}_e{e_idx:03d}"
         # First pass: collect BMPA rids in this bundle (texture pool).
         tex_rids: List[int] = []
         psc3_records: List[Tuple[int, bytes]] = []
@@ -146,6 +136,8 @@ def main(argv: List[str] | None = None) -> int:
     ap.add_argument("--mcb0", default="MCB0.BIN")
     ap.add_argument("--mcb1", default="MCB1.BIN")
     ap.add_argument("--top", type=int, default=20)
+    ap.add_argument("--cache", default=None,
+                    help="Decoded-payload cache directory (see decode_cache.py)")
     args = ap.parse_args(argv)
 
     if not os.path.isfile(args.mcb0) or not os.path.isfile(args.mcb1):
@@ -153,7 +145,7 @@ def main(argv: List[str] | None = None) -> int:
         return 2
 
     print(f"Scanning {args.mcb1} via {args.mcb0}...", file=sys.stderr)
-    candidates = scan(args.mcb0, args.mcb1)
+    candidates = scan(args.mcb0, args.mcb1, cache_dir=args.cache)
     print(f"Found {len(candidates)} textured PSC3 candidates.\n")
     print(f"{'#':>3}  {'bundle':<10}  {'rid':>6}  {'size':>6}  "
           f"{'sm':>3}  {'sd':>3}  {'mat':>3}  {'tex':>3}  {'score':>7}  texs")
@@ -0,0 +1,169 @@
+"""Pack a scene's BMPA texture pages into one atlas texture.
+
+A PSM2 map binds one 256x256 BMPA page per texture-page group (see
+``psm2_gltf._corner_tex_page``), so a scene loads, and the viewer
+decodes, one PNG per page. ``build`` places every page in a grid cell
+of one RGBA image instead:
+
+    cell = gutter + 256 + gutter        (edge texels repeated into the gutter)
+    cols = ceil(sqrt(pages)), rows = ceil(pages / cols)
+
+and ``Atlas.uv`` maps a page-local UV (glTF convention, top-left origin,
+the same space as the page PNG) into the atlas. PSM2 UVs are texel
+positions inside their page (U/256, V/256, no flip), so they never wrap
+and the remap is exact. The gutter keeps bilinear filtering and the first
+log2(gutter) mip levels from bleeding neighbouring pages in.
+
+Page pixels come from the ``.bmpa`` that ``mcb_unpack_all`` saves next
+to each PNG (palette expansion in ``bmpa.to_png_rgba``), or from the PNG
+itself when it is in the form ``bmpa.encode_png`` writes.
+
+``ktx2.encode`` produces the optional GPU-ready copy (BC1/BC3/RGBA8 with
+a mip chain). glTF core only references PNG/JPEG images, so the glTF
+keeps the PNG atlas and names the .ktx2 in the texture's ``extras``.
+
+CLI:
+    python -m tools.resource_extract.v2.tex_atlas \
+        --src out/mcb_unpacked/<scene> --dst out/atlas/<scene>.png --ktx2 bc3
+"""
+from __future__ import annotations
+
+import argparse
+import json
+import math
+import os
+import sys
+from dataclasses import dataclass, field
+from typing import Dict, Hashable, List, Optional, Sequence, Tuple
+
+from . import bmpa, ktx2
+
+PAGE = 256
+GUTTER = 8
+
+
+def load_page(path: str) -> Optional[bytes]:
+    """RGBA8888 (PNG row order) of a 256x256 page PNG, or None."""
+    stem = os.path.splitext(path)[0]
+    try:
+        with open(stem + ".bmpa", "rb") as f:
+            return bmpa.to_png_rgba(bmpa.parse(f.read()))
+    except (OSError, ValueError):
+        pass
+    try:
+        with open(path, "rb") as f:
+            decoded = bmpa.read_png_rgba(f.read())
+    except OSError:
+        return None
+    if decoded is None or decoded[:2] != (PAGE, PAGE):
+        return None
+    return decoded[2]
+
+
+@dataclass
+class Atlas:
+    width: int
+    height: int
+    rgba: bytes
+    gutter: int
+    cells: Dict[Hashable, Tuple[int, int]] = field(default_factory=dict)  # key -> page origin (px)
+
+    def uv(self, key: Hashable, u: float, v: float) -> Tuple[float, float]:
+        x, y = self.cells[key]
+        return (x + u * PAGE) / self.width, (y + v * PAGE) / self.height
+
+    def png(self) -> bytes:
+        return bmpa.encode_png(self.width, self.height, self.rgba)
+
+    def ktx2(self, fmt: str) -> bytes:
+        # Mips stop while a page's gutter still covers one texel.
+        levels = min(self.gutter.bit_length(), ktx2.max_levels(self.width, self.height))
+        return ktx2.encode(ktx2.mip_chain(self.width, self.height, self.rgba, levels), fmt)
+
+    def layout(self) -> dict:
+        return {"width": self.width, "height": self.height, "gutter": self.gutter,
+                "page": PAGE, "cells": {str(k): list(v) for k, v in self.cells.items()}}
+
+
+def build(pages: Sequence[Tuple[Hashable, bytes]], gutter: int = GUTTER) -> Atlas:
+    """Grid-pack (key, 256x256 RGBA) pages with edge-extended gutters."""
+    n = len(pages)
+    cols = max(1, math.ceil(math.sqrt(n)))
+    rows = max(1, math.ceil(n / cols))
+    cell = PAGE + 2 * gutter
+    width, height = cols * cell, rows * cell
+    out = bytearray(width * height * 4)
+    stride = width * 4
+    cells: Dict[Hashable, Tuple[int, int]] = {}
+    for i, (key, rgba) in enumerate(pages):
+        cx, cy = (i % cols) * cell, (i // cols) * cell
+        cells[key] = (cx + gutter, cy + gutter)
+        padded = []
+        for y in range(PAGE):
+            row = rgba[y * PAGE * 4:(y + 1) * PAGE * 4]
+            padded.append(row[:4] * gutter + row + row[-4:] * gutter)
+        padded = [padded[0]] * gutter + padded + [padded[-1]] * gutter
+        o = cy * stride + cx * 4
+        for row in padded:
+            out[o:o + len(row)] = row
+            o += stride
+    return Atlas(width, height, bytes(out), gutter, cells)
+
+
+def build_from_files(paths: Sequence[Tuple[Hashable, str]],
+                     gutter: int = GUTTER) -> Tuple[Optional[Atlas], List[Hashable]]:
+    """Atlas of every (key, png path) that loads; also returns keys left out."""
+    loaded, missing = [], []
+    for key, path in paths:
+        rgba = load_page(path)
+        if rgba is None:
+            missing.append(key)
+        else:
+            loaded.append((key, rgba))
+    return (build(loaded, gutter) if loaded else None), missing
+
+
+# ---------------------------------------------------------------------------
+# CLI
+# ---------------------------------------------------------------------------
+
+def main(argv: Optional[List[str]] = None) -> int:
+    ap = argparse.ArgumentParser(description="Pack BMPA page PNGs into one atlas")
+    ap.add_argument("--src", required=True, nargs="+",
+                    help="Page PNGs, or directories whose tex_*.png are packed")
+    ap.add_argument("--dst", required=True, help="Output atlas .png (layout goes to .json)")
+    ap.add_argument("--gutter", type=int, default=GUTTER,
+                    help="Edge texels repeated around each page (even, for BC blocks)")
+    ap.add_argument("--ktx2", choices=ktx2.FORMATS, default=None,
+                    help="Also write a .ktx2 with mipmaps in this format")
+    args = ap.parse_args(argv)
+
+    paths: List[str] = []
+    for s in args.src:
+        if os.path.isdir(s):
+            paths.extend(os.path.join(s, n) for n in sorted(os.listdir(s))
+                         if n.startswith("tex_") and n.endswith(".png"))
+        else:
+            paths.append(s)
+    atlas, missing = build_from_files([(os.path.basename(p), p) for p in paths], args.gutter)
+    for key in missing:
+        print(f"  SKIP  {key}: not a 256x256 BMPA page", file=sys.stderr)
+    if atlas is None:
+        print("No pages packed", file=sys.stderr)
+        return 1
+    os.makedirs(os.path.dirname(os.path.abspath(args.dst)), exist_ok=True)
+    with open(args.dst, "wb") as f:
+        f.write(atlas.png())
+    stem = os.path.splitext(args.dst)[0]
+    with open(stem + ".json", "w", encoding="utf-8") as f:
+        json.dump(atlas.layout(), f, indent=2)
+    if args.ktx2:
+        with open(stem + ".ktx2", "wb") as f:
+            f.write(atlas.ktx2(args.ktx2))
+    print(f"{args.dst}: {len(atlas.cells)} pages, {atlas.width}x{atlas.height}"
+          + (f", {stem}.ktx2 ({args.ktx2})" if args.ktx2 else ""))
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())